@@ -0,0 +1,82 @@
+#ifndef BENCH_HISTOGRAM_H
+#define BENCH_HISTOGRAM_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+// httpbench 与 stressbench 共用的延迟直方图（只有头文件）
+
+/*
+ * 对数-线性直方图（HdrHistogram 的简化版），记录微秒值：
+ * 小于 2048 的值逐个计数；更大的值按 2 的幂分段，每段 1024 个等宽子桶，相对误差不超过 1/1024
+ */
+class Histogram {
+public:
+    Histogram() : counts_(SUB_COUNT + MAX_SHIFT * HALF_COUNT, 0), total_(0), min_(UINT64_MAX), max_(0), sum_(0) {}
+
+    void Record(uint64_t v) {
+        counts_[Index_(v)]++;
+        total_++;
+        sum_ += v;
+        min_ = std::min(min_, v);
+        max_ = std::max(max_, v);
+    }
+
+    void Merge(const Histogram& other) {
+        for (size_t i = 0; i < counts_.size(); i++) {
+            counts_[i] += other.counts_[i];
+        }
+        total_ += other.total_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    // 百分位对应的值（取所在桶的上界，与 HdrHistogram 的 highestEquivalentValue 一致）
+    uint64_t ValueAt(double percentile) const {
+        if (total_ == 0) { return 0; }
+        uint64_t target = static_cast<uint64_t>(percentile / 100.0 * total_ + 0.5);
+        target = std::max<uint64_t>(1, std::min(target, total_));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); i++) {
+            seen += counts_[i];
+            if (seen >= target) {
+                return std::min(Highest_(i), max_);
+            }
+        }
+        return max_;
+    }
+
+    uint64_t Count() const { return total_; }
+    uint64_t Min() const { return total_ ? min_ : 0; }
+    uint64_t Max() const { return max_; }
+    double Mean() const { return total_ ? static_cast<double>(sum_) / total_ : 0; }
+
+private:
+    static const int SUB_BITS = 11;
+    static const uint64_t SUB_COUNT = 1ULL << SUB_BITS;     // 2048
+    static const uint64_t HALF_COUNT = SUB_COUNT / 2;       // 1024
+    static const int MAX_SHIFT = 64 - SUB_BITS;
+
+    static size_t Index_(uint64_t v) {
+        if (v < SUB_COUNT) { return v; }
+        int shift = 64 - __builtin_clzll(v) - SUB_BITS;     // v >> shift 落在 [1024, 2048)
+        return SUB_COUNT + (shift - 1) * HALF_COUNT + ((v >> shift) - HALF_COUNT);
+    }
+
+    static uint64_t Highest_(size_t idx) {
+        if (idx < SUB_COUNT) { return idx; }
+        uint64_t shift = (idx - SUB_COUNT) / HALF_COUNT + 1;
+        uint64_t sub = (idx - SUB_COUNT) % HALF_COUNT + HALF_COUNT;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    std::vector<uint64_t> counts_;
+    uint64_t total_;
+    uint64_t min_;
+    uint64_t max_;
+    uint64_t sum_;
+};
+
+#endif //BENCH_HISTOGRAM_H
@@ -0,0 +1,625 @@
+/*
+ * httpbench：多线程、基于 epoll 的 HTTP 压测工具（替代 webbench-1.5）
+ *
+ *  - 每个线程一个 epoll，管理若干非阻塞连接；支持 keep-alive、流水线（每个连接同时在途的请求数）
+ *  - 闭环模式（默认）：连接上一个响应回来就发下一个请求，测最大吞吐
+ *  - 开环模式（-r RPS）：按固定速率发请求，延迟从“计划发送时间”算起，
+ *    服务端变慢时排队等待的时间也计入延迟（避免 coordinated omission）
+ *  - URL 按权重混合（-u 或 -f 文件），用来模拟线上流量结构
+ *  - 延迟用 HdrHistogram 式的对数-线性直方图统计（精度约 0.1%），输出 p50/p90/p99/p99.9 与吞吐，
+ *    -j 另外输出一行 JSON 便于脚本比较
+ *
+ * 用法示例：
+ *   httpbench -c 200 -t 4 -d 30 -f mix.txt           闭环，200 个 keep-alive 连接
+ *   httpbench -c 64 -p 8 -u /index.html              每个连接流水线 8 个请求
+ *   httpbench -c 100 -r 20000 -d 60 -f mix.txt -j    开环 2 万 RPS
+ *   httpbench -C -c 50 -u /                          每个请求一个连接（webbench 的方式）
+ */
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <signal.h>
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "histogram.h"
+
+namespace {
+
+int64_t NowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+struct Options {
+    std::string host = "127.0.0.1";
+    std::string port = "1316";
+    int threads = 2;
+    int conns = 50;
+    int duration = 10;      // 秒
+    int warmup = 0;         // 秒，预热期间的请求不计入统计
+    int pipeline = 1;
+    double rps = 0;         // >0 为开环模式
+    int timeoutMs = 5000;
+    bool keepAlive = true;
+    bool json = false;
+    std::vector<std::pair<std::string, unsigned>> urls;     // 路径与权重
+};
+
+struct Stats {
+    Histogram hist;
+    uint64_t requests = 0;
+    uint64_t bytes = 0;
+    uint64_t status[6] = {0};   // 按 1xx..5xx 分类，0 为无法识别
+    uint64_t connectErrors = 0;
+    uint64_t readErrors = 0;
+    uint64_t writeErrors = 0;
+    uint64_t timeouts = 0;
+    uint64_t backlog = 0;       // 开环模式：测试结束时仍未发出的计划请求数
+
+    void Merge(const Stats& o) {
+        hist.Merge(o.hist);
+        requests += o.requests;
+        bytes += o.bytes;
+        for (int i = 0; i < 6; i++) { status[i] += o.status[i]; }
+        connectErrors += o.connectErrors;
+        readErrors += o.readErrors;
+        writeErrors += o.writeErrors;
+        timeouts += o.timeouts;
+        backlog += o.backlog;
+    }
+};
+
+// 按权重选择请求，请求报文预先拼好
+class UrlMix {
+public:
+    UrlMix(const Options& opt) : total_(0) {
+        for (const auto& url : opt.urls) {
+            std::string req = "GET " + url.first + " HTTP/1.1\r\nHost: " + opt.host + "\r\n";
+            req += opt.keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+            total_ += url.second;
+            reqs_.push_back(req);
+            cum_.push_back(total_);
+        }
+    }
+
+    const std::string& Pick(uint64_t rnd) const {
+        uint64_t r = rnd % total_;
+        size_t i = std::upper_bound(cum_.begin(), cum_.end(), r) - cum_.begin();
+        return reqs_[i];
+    }
+
+private:
+    std::vector<std::string> reqs_;
+    std::vector<uint64_t> cum_;
+    uint64_t total_;
+};
+
+class Worker {
+public:
+    Worker(const Options& opt, const UrlMix& mix, const addrinfo* addr, int conns, double rate, int seed)
+        : opt_(opt), mix_(mix), addr_(addr), conns_(conns), rate_(rate), rng_(0x9E3779B97F4A7C15ULL * (seed + 1)),
+          epfd_(-1), sent_(0), measureFrom_(0) {}
+
+    void Run(int64_t start, int64_t measureFrom, int64_t end, const std::atomic<bool>& stop);
+    const Stats& GetStats() const { return stats_; }
+
+private:
+    struct Pending {
+        int64_t intended;   // 计划发送时间（闭环模式等于实际发送时间）
+        int64_t sent;
+    };
+    struct Conn {
+        int fd = -1;
+        uint32_t gen = 0;           // 每次建立连接加一，丢弃同一批事件中属于旧连接的事件
+        bool connected = false;
+        std::string out;            // 尚未写出的请求
+        size_t outOff = 0;
+        std::deque<Pending> inflight;
+        std::string head;           // 正在接收的响应头
+        bool inBody = false;
+        uint64_t bodyLeft = 0;
+        int status = 0;
+        bool closeAfter = false;    // 响应带 Connection: close
+    };
+
+    bool Connect_(Conn& c);
+    void Close_(Conn& c, bool reconnect);
+    void Send_(Conn& c, int64_t intended, int64_t now);
+    bool Flush_(Conn& c);
+    void OnReadable_(Conn& c);
+    bool Feed_(Conn& c, const char* data, size_t len);
+    void ParseHead_(Conn& c);
+    bool Complete_(Conn& c);
+    void Fill_(Conn& c);
+    void CheckTimeouts_(int64_t now);
+    uint64_t Rand_() {
+        rng_ ^= rng_ << 13;
+        rng_ ^= rng_ >> 7;
+        rng_ ^= rng_ << 17;
+        return rng_;
+    }
+
+    static const size_t MAX_HEAD = 64 * 1024;
+
+    const Options& opt_;
+    const UrlMix& mix_;
+    const addrinfo* addr_;
+    int conns_;
+    double rate_;               // 开环：本线程每秒请求数
+    uint64_t rng_;
+    int epfd_;
+    std::vector<Conn> pool_;
+    size_t next_ = 0;           // 开环：轮询选择连接
+    uint64_t sent_;             // 开环：已发出的计划请求数
+    int64_t measureFrom_;
+    Stats stats_;
+};
+
+bool Worker::Connect_(Conn& c) {
+    uint32_t gen = c.gen + 1;
+    c = Conn();
+    c.gen = gen;
+    c.fd = socket(addr_->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c.fd < 0) {
+        stats_.connectErrors++;
+        return false;
+    }
+    int one = 1;
+    setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(c.fd, addr_->ai_addr, addr_->ai_addrlen) < 0 && errno != EINPROGRESS) {
+        stats_.connectErrors++;
+        close(c.fd);
+        c.fd = -1;
+        return false;
+    }
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP;
+    ev.data.u64 = (static_cast<uint64_t>(&c - pool_.data()) << 32) | c.gen;
+    epoll_ctl(epfd_, EPOLL_CTL_ADD, c.fd, &ev);
+    return true;
+}
+
+// reconnect：闭环模式下重新建立连接继续压测；在途的请求算作读错误
+void Worker::Close_(Conn& c, bool reconnect) {
+    if (c.fd >= 0) {
+        close(c.fd);    // close 会把 fd 从 epoll 中移除
+    }
+    c.fd = -1;
+    if (reconnect) {
+        Connect_(c);
+    }
+}
+
+void Worker::Send_(Conn& c, int64_t intended, int64_t now) {
+    c.out += mix_.Pick(Rand_());
+    c.inflight.push_back({intended, now});
+    if (c.connected && !Flush_(c)) {
+        stats_.writeErrors++;
+        Close_(c, true);
+    }
+}
+
+// 写到 EAGAIN 为止，出错返回 false
+bool Worker::Flush_(Conn& c) {
+    while (c.outOff < c.out.size()) {
+        ssize_t n = send(c.fd, c.out.data() + c.outOff, c.out.size() - c.outOff, MSG_NOSIGNAL);
+        if (n < 0) {
+            return errno == EAGAIN;
+        }
+        c.outOff += n;
+    }
+    c.out.clear();
+    c.outOff = 0;
+    return true;
+}
+
+// 闭环模式：把连接上的在途请求补满
+void Worker::Fill_(Conn& c) {
+    if (rate_ > 0 || c.fd < 0) { return; }
+    int depth = opt_.keepAlive ? opt_.pipeline : 1;
+    int64_t now = NowNs();
+    while (c.fd >= 0 && static_cast<int>(c.inflight.size()) < depth) {
+        Send_(c, now, now);
+    }
+}
+
+void Worker::ParseHead_(Conn& c) {
+    const std::string& h = c.head;
+    c.status = h.size() > 12 ? atoi(h.c_str() + 9) : 0;
+    c.bodyLeft = 0;
+    c.closeAfter = false;
+    size_t pos = 0;
+    while ((pos = h.find("\r\n", pos)) != std::string::npos) {
+        pos += 2;
+        const char* line = h.c_str() + pos;
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            c.bodyLeft = strtoull(line + 15, nullptr, 10);
+        } else if (strncasecmp(line, "Connection:", 11) == 0) {
+            const char* v = line + 11;
+            while (*v == ' ') { v++; }
+            c.closeAfter = strncasecmp(v, "close", 5) == 0;
+        }
+    }
+    if (c.status == 304 || c.status == 204 || (c.status >= 100 && c.status < 200)) {
+        c.bodyLeft = 0;
+    }
+}
+
+// 一个完整响应：记录延迟并发下一个请求；连接被关闭时返回 false
+bool Worker::Complete_(Conn& c) {
+    int64_t now = NowNs();
+    Pending p = c.inflight.front();
+    c.inflight.pop_front();
+    if (p.intended >= measureFrom_) {
+        stats_.requests++;
+        stats_.status[(c.status >= 100 && c.status < 600) ? c.status / 100 : 0]++;
+        stats_.hist.Record(static_cast<uint64_t>(now - p.intended) / 1000);
+    }
+    c.inBody = false;
+    if (c.closeAfter || !opt_.keepAlive) {
+        stats_.readErrors += c.inflight.size();  // 服务端关闭后剩下的流水线请求不会有响应
+        Close_(c, true);
+        Fill_(c);
+        return false;
+    }
+    Fill_(c);
+    return true;
+}
+
+// 解析收到的数据：响应头缓存在 head 中，正文只计数不保存
+bool Worker::Feed_(Conn& c, const char* data, size_t len) {
+    while (len > 0) {
+        if (c.inflight.empty()) {
+            stats_.readErrors++;    // 没有请求却收到数据
+            Close_(c, true);
+            Fill_(c);
+            return false;
+        }
+        if (c.inBody) {
+            size_t take = static_cast<size_t>(std::min<uint64_t>(c.bodyLeft, len));
+            c.bodyLeft -= take;
+            data += take;
+            len -= take;
+            if (c.bodyLeft == 0 && !Complete_(c)) {
+                return false;
+            }
+            continue;
+        }
+        size_t old = c.head.size();
+        c.head.append(data, len);
+        size_t pos = c.head.find("\r\n\r\n", old >= 3 ? old - 3 : 0);
+        if (pos == std::string::npos) {
+            if (c.head.size() > MAX_HEAD) {
+                stats_.readErrors++;
+                Close_(c, true);
+                Fill_(c);
+                return false;
+            }
+            return true;
+        }
+        size_t used = pos + 4 - old;
+        c.head.resize(pos + 2);
+        ParseHead_(c);
+        c.head.clear();
+        data += used;
+        len -= used;
+        c.inBody = true;
+        if (c.bodyLeft == 0 && !Complete_(c)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Worker::OnReadable_(Conn& c) {
+    static thread_local char buf[64 * 1024];
+    while (c.fd >= 0) {
+        ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            stats_.bytes += n;
+            if (!Feed_(c, buf, n)) {
+                return;
+            }
+        } else if (n < 0 && errno == EAGAIN) {
+            return;
+        } else {
+            // 对端关闭：有在途请求时算作错误
+            stats_.readErrors += c.inflight.size();
+            Close_(c, true);
+            Fill_(c);
+            return;
+        }
+    }
+}
+
+void Worker::CheckTimeouts_(int64_t now) {
+    int64_t limit = static_cast<int64_t>(opt_.timeoutMs) * 1000000;
+    for (Conn& c : pool_) {
+        if (c.fd >= 0 && !c.inflight.empty() && now - c.inflight.front().sent > limit) {
+            stats_.timeouts += c.inflight.size();
+            Close_(c, true);
+            Fill_(c);
+        } else if (c.fd < 0) {
+            Connect_(c);    // 之前连接失败，重试
+            Fill_(c);
+        }
+    }
+}
+
+void Worker::Run(int64_t start, int64_t measureFrom, int64_t end, const std::atomic<bool>& stop) {
+    epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    measureFrom_ = measureFrom;
+    pool_.resize(conns_);
+    for (Conn& c : pool_) {
+        Connect_(c);
+        Fill_(c);
+    }
+    std::vector<struct epoll_event> events(std::max(conns_, 16));
+    int64_t lastCheck = start;
+    while (!stop) {
+        int64_t now = NowNs();
+        if (now >= end) { break; }
+        int timeoutMs = 10;
+        if (rate_ > 0) {
+            // 开环：发出所有已到计划时间的请求，没有空闲连接时留作积压
+            int64_t due;
+            while ((due = start + static_cast<int64_t>(sent_ * 1e9 / rate_)) <= now) {
+                Conn* target = nullptr;
+                for (size_t i = 0; i < pool_.size(); i++) {
+                    Conn& c = pool_[(next_ + i) % pool_.size()];
+                    if (c.connected && static_cast<int>(c.inflight.size()) < opt_.pipeline) {
+                        target = &c;
+                        next_ = (next_ + i + 1) % pool_.size();
+                        break;
+                    }
+                }
+                if (!target) { break; }
+                Send_(*target, due, now);
+                sent_++;
+            }
+            if (due > now) {
+                timeoutMs = static_cast<int>(std::min<int64_t>((due - now) / 1000000, 10));
+            } else {
+                timeoutMs = 1;
+            }
+        }
+        int n = epoll_wait(epfd_, events.data(), static_cast<int>(events.size()), timeoutMs);
+        for (int i = 0; i < n; i++) {
+            Conn& c = pool_[events[i].data.u64 >> 32];
+            if (c.fd < 0 || c.gen != static_cast<uint32_t>(events[i].data.u64)) { continue; }
+            if (!c.connected && (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0) {
+                    stats_.connectErrors++;
+                    size_t lost = c.inflight.size();
+                    Close_(c, false);   // 下一次 CheckTimeouts_ 重连，避免服务端不可用时空转
+                    stats_.writeErrors += lost;
+                    continue;
+                }
+                c.connected = true;
+            }
+            if (events[i].events & EPOLLOUT) {
+                if (!Flush_(c)) {
+                    stats_.writeErrors++;
+                    Close_(c, true);
+                    Fill_(c);
+                    continue;
+                }
+            }
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                OnReadable_(c);
+            }
+        }
+        now = NowNs();
+        if (now - lastCheck > 100000000) {
+            CheckTimeouts_(now);
+            lastCheck = now;
+        }
+    }
+    if (rate_ > 0) {
+        uint64_t planned = static_cast<uint64_t>((std::min(NowNs(), end) - start) / 1e9 * rate_);
+        stats_.backlog = planned > sent_ ? planned - sent_ : 0;
+    }
+    for (Conn& c : pool_) {
+        Close_(c, false);
+    }
+    close(epfd_);
+}
+
+void Usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -H host        server address (default 127.0.0.1)\n"
+            "  -P port        server port (default 1316)\n"
+            "  -t threads     worker threads (default 2)\n"
+            "  -c conns       total connections (default 50)\n"
+            "  -d seconds     test duration (default 10)\n"
+            "  -w seconds     warmup excluded from the results (default 0)\n"
+            "  -p depth       pipelined requests per connection (default 1)\n"
+            "  -r rps         open-loop mode at a fixed total request rate\n"
+            "  -u path[:w]    URL with optional weight, repeatable (default /)\n"
+            "  -f file        URL mix file, one \"weight path\" per line\n"
+            "  -T ms          request timeout (default 5000)\n"
+            "  -C             one request per connection (Connection: close)\n"
+            "  -j             also print the results as one JSON line\n",
+            prog);
+}
+
+bool LoadMix(const char* file, Options* opt) {
+    std::ifstream in(file);
+    if (!in) { return false; }
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        unsigned weight;
+        std::string path;
+        if (line.empty() || line[0] == '#' || !(ss >> weight >> path)) { continue; }
+        opt->urls.push_back({path, weight});
+    }
+    return true;
+}
+
+void Report(const Options& opt, const Stats& s, double seconds) {
+    const Histogram& h = s.hist;
+    double rps = s.requests / seconds;
+    double mbps = s.bytes / seconds / (1024.0 * 1024.0);
+    printf("%s:%s  %d threads, %d connections, pipeline %d, %s, %s\n",
+           opt.host.c_str(), opt.port.c_str(), opt.threads, opt.conns, opt.pipeline,
+           opt.keepAlive ? "keep-alive" : "close", opt.rps > 0 ? "open-loop" : "closed-loop");
+    if (opt.rps > 0) {
+        printf("  target %.0f req/s\n", opt.rps);
+    }
+    printf("  requests %llu in %.2fs, %.1f req/s, %.2f MB/s\n",
+           (unsigned long long)s.requests, seconds, rps, mbps);
+    printf("  latency(us)  min %llu  p50 %llu  p90 %llu  p99 %llu  p99.9 %llu  max %llu  mean %.1f\n",
+           (unsigned long long)h.Min(), (unsigned long long)h.ValueAt(50), (unsigned long long)h.ValueAt(90),
+           (unsigned long long)h.ValueAt(99), (unsigned long long)h.ValueAt(99.9),
+           (unsigned long long)h.Max(), h.Mean());
+    printf("  status 2xx %llu  3xx %llu  4xx %llu  5xx %llu  other %llu\n",
+           (unsigned long long)s.status[2], (unsigned long long)s.status[3], (unsigned long long)s.status[4],
+           (unsigned long long)s.status[5], (unsigned long long)(s.status[0] + s.status[1]));
+    printf("  errors connect %llu  read %llu  write %llu  timeout %llu  backlog %llu\n",
+           (unsigned long long)s.connectErrors, (unsigned long long)s.readErrors,
+           (unsigned long long)s.writeErrors, (unsigned long long)s.timeouts, (unsigned long long)s.backlog);
+    if (opt.json) {
+        printf("{\"threads\":%d,\"connections\":%d,\"pipeline\":%d,\"keepalive\":%s,\"target_rps\":%.0f,"
+               "\"seconds\":%.3f,\"requests\":%llu,\"rps\":%.1f,\"bytes\":%llu,"
+               "\"latency_us\":{\"min\":%llu,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu,\"mean\":%.1f},"
+               "\"status\":{\"2xx\":%llu,\"3xx\":%llu,\"4xx\":%llu,\"5xx\":%llu},"
+               "\"errors\":{\"connect\":%llu,\"read\":%llu,\"write\":%llu,\"timeout\":%llu,\"backlog\":%llu}}\n",
+               opt.threads, opt.conns, opt.pipeline, opt.keepAlive ? "true" : "false", opt.rps,
+               seconds, (unsigned long long)s.requests, rps, (unsigned long long)s.bytes,
+               (unsigned long long)h.Min(), (unsigned long long)h.ValueAt(50), (unsigned long long)h.ValueAt(90),
+               (unsigned long long)h.ValueAt(99), (unsigned long long)h.ValueAt(99.9),
+               (unsigned long long)h.Max(), h.Mean(),
+               (unsigned long long)s.status[2], (unsigned long long)s.status[3],
+               (unsigned long long)s.status[4], (unsigned long long)s.status[5],
+               (unsigned long long)s.connectErrors, (unsigned long long)s.readErrors,
+               (unsigned long long)s.writeErrors, (unsigned long long)s.timeouts, (unsigned long long)s.backlog);
+    }
+}
+
+std::atomic<bool> g_stop(false);
+
+void OnSignal(int) {
+    g_stop = true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    int ch;
+    while ((ch = getopt(argc, argv, "H:P:t:c:d:w:p:r:u:f:T:Cjh")) != -1) {
+        switch (ch) {
+            case 'H': opt.host = optarg; break;
+            case 'P': opt.port = optarg; break;
+            case 't': opt.threads = atoi(optarg); break;
+            case 'c': opt.conns = atoi(optarg); break;
+            case 'd': opt.duration = atoi(optarg); break;
+            case 'w': opt.warmup = atoi(optarg); break;
+            case 'p': opt.pipeline = atoi(optarg); break;
+            case 'r': opt.rps = atof(optarg); break;
+            case 'T': opt.timeoutMs = atoi(optarg); break;
+            case 'C': opt.keepAlive = false; break;
+            case 'j': opt.json = true; break;
+            case 'u': {
+                std::string arg = optarg;
+                size_t colon = arg.rfind(':');
+                unsigned weight = 1;
+                if (colon != std::string::npos && colon + 1 < arg.size()) {
+                    weight = static_cast<unsigned>(atoi(arg.c_str() + colon + 1));
+                    arg.resize(colon);
+                }
+                opt.urls.push_back({arg, weight});
+                break;
+            }
+            case 'f':
+                if (!LoadMix(optarg, &opt)) {
+                    fprintf(stderr, "cannot read url mix %s\n", optarg);
+                    return 1;
+                }
+                break;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+    if (opt.urls.empty()) {
+        opt.urls.push_back({"/", 1});
+    }
+    opt.urls.erase(std::remove_if(opt.urls.begin(), opt.urls.end(),
+                                  [](const std::pair<std::string, unsigned>& u) { return u.second == 0; }),
+                   opt.urls.end());
+    if (opt.threads <= 0 || opt.conns <= 0 || opt.duration <= 0 || opt.pipeline <= 0 || opt.urls.empty()) {
+        Usage(argv[0]);
+        return 1;
+    }
+    opt.threads = std::min(opt.threads, opt.conns);
+    if (!opt.keepAlive) {
+        opt.pipeline = 1;
+    }
+
+    struct addrinfo hints = {0};
+    struct addrinfo* addr = nullptr;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    int ret = getaddrinfo(opt.host.c_str(), opt.port.c_str(), &hints, &addr);
+    if (ret != 0) {
+        fprintf(stderr, "resolve %s: %s\n", opt.host.c_str(), gai_strerror(ret));
+        return 1;
+    }
+    signal(SIGINT, OnSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    UrlMix mix(opt);
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (int i = 0; i < opt.threads; i++) {
+        int conns = opt.conns / opt.threads + (i < opt.conns % opt.threads ? 1 : 0);
+        double rate = opt.rps > 0 ? opt.rps * conns / opt.conns : 0;
+        workers.emplace_back(new Worker(opt, mix, addr, conns, rate, i));
+    }
+    int64_t start = NowNs();
+    int64_t measureFrom = start + static_cast<int64_t>(opt.warmup) * 1000000000LL;
+    int64_t end = measureFrom + static_cast<int64_t>(opt.duration) * 1000000000LL;
+    std::vector<std::thread> threads;
+    for (auto& w : workers) {
+        threads.emplace_back([&w, start, measureFrom, end] { w->Run(start, measureFrom, end, g_stop); });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    double seconds = (std::min(NowNs(), end) - measureFrom) / 1e9;
+
+    Stats total;
+    for (auto& w : workers) {
+        total.Merge(w->GetStats());
+    }
+    Report(opt, total, seconds > 0 ? seconds : 1);
+    freeaddrinfo(addr);
+    return 0;
+}
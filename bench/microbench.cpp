@@ -0,0 +1,408 @@
+/*
+ * microbench：热点模块的微基准（不依赖 MySQL，不启动服务器）
+ *
+ * 覆盖 Buffer（Append / 搬移与扩容 / ReadFd）、HttpRequest::parse（几种真实请求形态）、
+ * HeapTimer（10 万个定时器的 add / adjust / tick）、ThreadPool::AddTask（不同线程数）
+ * 以及多线程并发写日志。
+ *
+ * 每个用例输出一行 JSON（bench、param、iters、ns_per_op、ops_per_sec，以及可选的 mb_per_s 等），
+ * 便于脚本收集、比较历史结果：
+ *   microbench                 运行全部用例
+ *   microbench parse timer     只运行名字包含 parse 或 timer 的用例
+ *   microbench -q              规模缩小 10 倍，快速检查
+ *   microbench -r 5            每个用例重复 5 次取最好成绩（默认 3）
+ */
+#include <sys/socket.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../code/buffer/buffer.h"
+#include "../code/http/httprequest.h"
+#include "../code/timer/heaptimer.h"
+#include "../code/pool/threadpool.h"
+#include "../code/log/log.h"
+
+namespace {
+
+int g_repeat = 3;
+double g_scale = 1.0;
+bool g_failed = false;      // 有用例的结果无效（例如日志丢行），退出码为 1
+std::vector<std::string> g_filters;
+const char* g_logDir = "/tmp/microbench_log";
+
+int64_t NowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+template <typename T>
+void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+uint64_t Scaled(uint64_t n) {
+    return std::max<uint64_t>(1, static_cast<uint64_t>(n * g_scale));
+}
+
+bool Selected(const std::string& name) {
+    if (g_filters.empty()) { return true; }
+    for (const std::string& f : g_filters) {
+        if (name.find(f) != std::string::npos) { return true; }
+    }
+    return false;
+}
+
+// 输出一行结果；bytesPerOp > 0 时附带吞吐（MB/s），extra 为附加的 JSON 字段
+void Emit(const std::string& name, const std::string& param, uint64_t iters, double nsPerOp,
+          double bytesPerOp = 0, const std::string& extra = "") {
+    printf("{\"bench\":\"%s\",\"param\":\"%s\",\"iters\":%llu,\"ns_per_op\":%.2f,\"ops_per_sec\":%.0f",
+           name.c_str(), param.c_str(), (unsigned long long)iters, nsPerOp, nsPerOp > 0 ? 1e9 / nsPerOp : 0);
+    if (bytesPerOp > 0) {
+        printf(",\"mb_per_s\":%.1f", bytesPerOp / nsPerOp * 1e9 / (1024.0 * 1024.0));
+    }
+    printf("%s}\n", extra.c_str());
+    fflush(stdout);
+}
+
+// 重复 g_repeat 次，返回最好的一次每操作耗时；body 返回本次执行的操作数
+template <typename F>
+double Best(F body) {
+    double best = 0;
+    for (int r = 0; r < g_repeat; r++) {
+        int64_t start = NowNs();
+        uint64_t ops = body();
+        double ns = static_cast<double>(NowNs() - start) / ops;
+        if (r == 0 || ns < best) { best = ns; }
+    }
+    return best;
+}
+
+/* ----------------- Buffer ----------------- */
+
+void BenchBufferAppend() {
+    const size_t sizes[] = {16, 256, 4096};
+    for (size_t size : sizes) {
+        std::string data(size, 'x');
+        uint64_t iters = Scaled(size >= 4096 ? 500000 : 5000000);
+        double ns = Best([&] {
+            Buffer buff;
+            for (uint64_t i = 0; i < iters; i++) {
+                buff.Append(data.data(), data.size());
+                if (buff.ReadableBytes() >= 64 * 1024) {
+                    buff.RetrieveAll();
+                }
+            }
+            DoNotOptimize(buff.Peek());
+            return iters;
+        });
+        Emit("buffer_append", std::to_string(size) + "B", iters, ns, size);
+    }
+}
+
+// MakeSpace_ 的两条路径：前部空闲足够时搬移数据（compact），不够时扩容（grow）
+void BenchBufferMakeSpace() {
+    std::string chunk(3000, 'x');
+    uint64_t iters = Scaled(2000000);
+    double ns = Best([&] {
+        Buffer buff(4096);
+        for (uint64_t i = 0; i < iters; i++) {
+            buff.Append(chunk.data(), chunk.size());   // 留 100 字节未读，下一次追加需要搬移
+            buff.Retrieve(chunk.size() - 100 < buff.ReadableBytes() ? chunk.size() - 100 : buff.ReadableBytes());
+            if (buff.ReadableBytes() > 2048) {
+                buff.RetrieveAll();
+            }
+        }
+        DoNotOptimize(buff.Peek());
+        return iters;
+    });
+    Emit("buffer_makespace", "compact", iters, ns, chunk.size());
+
+    std::string kb(1024, 'x');
+    uint64_t rounds = Scaled(50000);
+    ns = Best([&] {
+        for (uint64_t i = 0; i < rounds; i++) {
+            Buffer buff;
+            for (int k = 0; k < 64; k++) {              // 从 1KB 逐步长到 64KB
+                buff.Append(kb.data(), kb.size());
+            }
+            DoNotOptimize(buff.Peek());
+        }
+        return rounds;
+    });
+    Emit("buffer_makespace", "grow_64KB", rounds, ns, 64 * 1024);
+}
+
+// 每次操作：向 socketpair 一端写 size 字节，另一端 ReadFd 读入再清空（包含写端的系统调用）
+void BenchBufferReadFd() {
+    const size_t sizes[] = {1024, 16 * 1024, 128 * 1024};
+    for (size_t size : sizes) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+            perror("socketpair");
+            return;
+        }
+        int sndbuf = 1 << 20;
+        setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+        setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &sndbuf, sizeof(sndbuf));
+        std::string data(size, 'x');
+        uint64_t iters = Scaled(size >= 128 * 1024 ? 20000 : 200000);
+        double ns = Best([&] {
+            Buffer buff;
+            int err = 0;
+            for (uint64_t i = 0; i < iters; i++) {
+                size_t sent = 0;
+                while (sent < size) {
+                    ssize_t n = write(fds[0], data.data() + sent, size - sent);
+                    if (n <= 0) { break; }
+                    sent += n;
+                    while (buff.ReadableBytes() < sent) {
+                        if (buff.ReadFd(fds[1], &err) <= 0) { break; }
+                    }
+                }
+                buff.RetrieveAll();
+            }
+            return iters;
+        });
+        Emit("buffer_readfd", std::to_string(size / 1024) + "KB", iters, ns, size);
+        close(fds[0]);
+        close(fds[1]);
+    }
+}
+
+/* ----------------- HttpRequest::parse ----------------- */
+
+const char* REQ_MIN = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+const char* REQ_BROWSER =
+    "GET /css/bootstrap.min.css HTTP/1.1\r\n"
+    "Host: www.example.com:1316\r\n"
+    "Connection: keep-alive\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+    "sec-ch-ua-platform: \"Linux\"\r\n"
+    "Accept: text/css,*/*;q=0.1\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Dest: style\r\n"
+    "Referer: http://www.example.com:1316/index.html\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "If-None-Match: \"5f3a-65c1b2e0\"\r\n"
+    "If-Modified-Since: Tue, 06 Feb 2024 08:00:00 GMT\r\n"
+    "\r\n";
+
+std::string PostForm() {
+    std::string body = "username=alice%40example.com&password=p%40ssw0rd%21";
+    return "POST /login HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n"
+           "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: " +
+           std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+// 每次操作解析 corpus 中全部 count 个请求；chunk > 0 时按 chunk 字节分批到达
+void ParseCorpus(const std::string& param, const std::string& corpus, int count, size_t chunk) {
+    uint64_t iters = Scaled(chunk ? 100000 : 1000000 / count);
+    double ns = Best([&] {
+        Buffer buff;
+        HttpRequest req;
+        for (uint64_t i = 0; i < iters; i++) {
+            int parsed = 0;
+            size_t off = 0;
+            while (parsed < count) {
+                if (off < corpus.size()) {
+                    size_t n = chunk ? std::min(chunk, corpus.size() - off) : corpus.size();
+                    buff.Append(corpus.data() + off, n);
+                    off += n;
+                }
+                HttpRequest::PARSE_RESULT ret = req.parse(buff);
+                if (ret == HttpRequest::PARSE_OK) {
+                    parsed++;
+                } else if (ret == HttpRequest::PARSE_ERROR || off >= corpus.size()) {
+                    fprintf(stderr, "bad corpus %s\n", param.c_str());
+                    exit(1);
+                }
+            }
+            DoNotOptimize(req.path());
+        }
+        return iters;
+    });
+    Emit("http_parse", param, iters, ns, corpus.size(), ",\"requests_per_op\":" + std::to_string(count));
+}
+
+void BenchParse() {
+    ParseCorpus("get_min", REQ_MIN, 1, 0);
+    ParseCorpus("get_browser", REQ_BROWSER, 1, 0);
+    ParseCorpus("post_form", PostForm(), 1, 0);
+    std::string pipeline;
+    for (int i = 0; i < 16; i++) { pipeline += REQ_BROWSER; }
+    ParseCorpus("pipeline16", pipeline, 16, 0);
+    ParseCorpus("browser_split7", REQ_BROWSER, 1, 7);     // 每次只到 7 字节，考察断点续扫
+}
+
+/* ----------------- HeapTimer ----------------- */
+
+void BenchHeapTimer() {
+    const int N = static_cast<int>(Scaled(100000));
+    std::vector<int> order(N);
+    std::vector<int> timeouts(N);
+    uint64_t seed = 88172645463325252ULL;
+    for (int i = 0; i < N; i++) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        order[i] = i;
+        timeouts[i] = 60000 + static_cast<int>(seed % 60000);
+    }
+    for (int i = N - 1; i > 0; i--) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        std::swap(order[i], order[seed % (i + 1)]);
+    }
+    const std::string param = std::to_string(N / 1000) + "k";
+    int fired = 0;
+    TimeoutCallBack cb = [&fired] { fired++; };
+
+    double ns = Best([&] {
+        HeapTimer timer;
+        for (int i = 0; i < N; i++) {
+            timer.add(i, timeouts[i], cb);
+        }
+        return static_cast<uint64_t>(N);
+    });
+    Emit("heaptimer_add", param, N, ns);
+
+    // 连接活跃时的典型操作：把随机一个定时器往后推
+    HeapTimer timer;
+    for (int i = 0; i < N; i++) {
+        timer.add(i, timeouts[i], cb);
+    }
+    ns = Best([&] {
+        for (int i = 0; i < N; i++) {
+            timer.adjust(order[i], timeouts[order[(i + 1) % N]] + 60000);
+        }
+        return static_cast<uint64_t>(N);
+    });
+    Emit("heaptimer_adjust", param, N, ns);
+
+    // tick：所有定时器都已到期，逐个弹出并执行回调（只计 tick 本身）
+    ns = 0;
+    for (int r = 0; r < g_repeat; r++) {
+        HeapTimer expired;
+        for (int i = 0; i < N; i++) {
+            expired.add(order[i], -(i % 1000) - 1, cb);
+        }
+        int64_t start = NowNs();
+        expired.tick();
+        double cost = static_cast<double>(NowNs() - start) / N;
+        if (r == 0 || cost < ns) { ns = cost; }
+    }
+    Emit("heaptimer_tick", param, N, ns, 0, ",\"fired\":" + std::to_string(fired));
+}
+
+/* ----------------- ThreadPool ----------------- */
+
+void BenchThreadPool() {
+    const int counts[] = {1, 2, 4, 8};
+    for (int threads : counts) {
+        uint64_t tasks = Scaled(1000000);
+        double ns = Best([&] {
+            std::atomic<uint64_t> done(0);
+            ThreadPool pool(threads);
+            for (uint64_t i = 0; i < tasks; i++) {
+                pool.AddTask([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+            }
+            while (done.load(std::memory_order_acquire) < tasks) {
+                std::this_thread::yield();
+            }
+            return tasks;
+        });
+        Emit("threadpool_addtask", std::to_string(threads) + "threads", tasks, ns);
+    }
+}
+
+/* ----------------- Log ----------------- */
+
+// 多个线程同时写日志：ns_per_op 为所有线程合计的每行耗时。
+// 缓冲区满时等待后台线程（不丢行），测到的是完整的写日志路径；dropped 为单次运行中丢弃行数的最大值，
+// 不为 0 时结果只反映丢弃的快速路径，用例记为失败
+void BenchLog() {
+    Log::Instance()->init(1, g_logDir, ".log", 1024, true);
+    const int counts[] = {1, 4, 8};
+    for (int threads : counts) {
+        uint64_t perThread = Scaled(200000);
+        uint64_t dropped = 0;
+        double ns = Best([&] {
+            uint64_t droppedBefore = Log::Instance()->Dropped();
+            std::vector<std::thread> workers;
+            for (int t = 0; t < threads; t++) {
+                workers.emplace_back([perThread, t] {
+                    static const std::string path = "/css/bootstrap.min.css";
+                    for (uint64_t i = 0; i < perThread; i++) {
+                        LOG_INFO("Client[%d] %s %d bytes", t, path, static_cast<int>(i));
+                    }
+                });
+            }
+            for (auto& w : workers) {
+                w.join();
+            }
+            dropped = std::max(dropped, Log::Instance()->Dropped() - droppedBefore);
+            return perThread * threads;
+        });
+        Emit("log_write", std::to_string(threads) + "threads", perThread * threads, ns, 0,
+             ",\"dropped\":" + std::to_string(dropped));
+        if (dropped > 0) {
+            fprintf(stderr, "log_write %dthreads: %llu lines dropped in one run, result is not comparable\n",
+                    threads, (unsigned long long)dropped);
+            g_failed = true;
+        }
+    }
+    Log::Instance()->flush();
+}
+
+struct Case {
+    const char* name;
+    void (*run)();
+};
+
+const Case CASES[] = {
+    {"buffer_append", BenchBufferAppend},
+    {"buffer_makespace", BenchBufferMakeSpace},
+    {"buffer_readfd", BenchBufferReadFd},
+    {"http_parse", BenchParse},
+    {"heaptimer", BenchHeapTimer},
+    {"threadpool", BenchThreadPool},
+    {"log_write", BenchLog},
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int ch;
+    while ((ch = getopt(argc, argv, "qr:L:h")) != -1) {
+        switch (ch) {
+            case 'q': g_scale = 0.1; break;
+            case 'r': g_repeat = std::max(1, atoi(optarg)); break;
+            case 'L': g_logDir = optarg; break;
+            default:
+                fprintf(stderr, "Usage: %s [-q] [-r repeat] [-L logdir] [filter...]\n", argv[0]);
+                return 1;
+        }
+    }
+    for (int i = optind; i < argc; i++) {
+        g_filters.push_back(argv[i]);
+    }
+    for (const Case& c : CASES) {
+        if (Selected(c.name)) {
+            c.run();
+        }
+    }
+    return g_failed ? 1 : 0;
+}
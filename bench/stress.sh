@@ -0,0 +1,102 @@
+#!/bin/bash
+# stress.sh：在四种触发模式下（经典模式与多 Reactor 模式各一遍）启动服务端，用 stressbench 回放 stress.trace，
+# 汇总每种组合的吞吐、延迟与失败；服务端的 http_use_after_close_total 增加也算失败
+#
+# 用法（在仓库根目录执行，或 make stress）：
+#   bench/stress.sh [秒数] [并发]                 默认 10 秒、64 个并发客户端
+# 环境变量：
+#   CONF      基础配置（默认 server.conf），在其后追加 port、trig_mode、reactor_num、timeout_ms 等覆盖项
+#   PORT      测试端口（默认 1417）
+#   MODES     trig_mode 列表（默认 "0 1 2 3"）
+#   REACTORS  reactor_num 列表（默认 "0 2"；0 为经典模式：线程池 + EPOLLONESHOT）
+#   SEED      随机种子（默认 1），失败时用同一种子重放：bin/stressbench -s SEED -v ...
+#   SERVER    服务端可执行文件（默认 bin/server；竞争检查用 make SANITIZE=thread 编译的版本，
+#             TSan 报告写在服务端输出里、退出码非 0，该组合记为失败；TSAN_OPTIONS 未设置时使用 bench/tsan.supp）
+# 任一组合失败时退出码为 1
+
+DURATION=${1:-10}
+CLIENTS=${2:-64}
+CONF=${CONF:-server.conf}
+PORT=${PORT:-1417}
+MODES=${MODES:-"0 1 2 3"}
+REACTORS=${REACTORS:-"0 2"}
+SEED=${SEED:-1}
+SERVER=${SERVER:-bin/server}
+BENCH=bin/stressbench
+TRACE=bench/stress.trace
+
+cd "$(dirname "$0")/.." || exit 1
+export TSAN_OPTIONS=${TSAN_OPTIONS:-"suppressions=$PWD/bench/tsan.supp"}
+for f in "$SERVER" "$BENCH" "$CONF" "$TRACE"; do
+    if [ ! -e "$f" ]; then
+        echo "missing $f (run make && make bench first)" >&2
+        exit 1
+    fi
+done
+
+WORK=$(mktemp -d /tmp/tws-stress.XXXXXX)
+trap 'rm -rf "$WORK"' EXIT
+
+# 等待端口可以连接
+wait_port() {
+    for _ in $(seq 1 100); do
+        if (exec 3<>"/dev/tcp/127.0.0.1/$PORT") 2>/dev/null; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    return 1
+}
+
+failed=0
+summary=""
+for reactors in $REACTORS; do
+    for mode in $MODES; do
+        name="trig_mode=$mode reactor_num=$reactors"
+        conf="$WORK/stress-$mode-$reactors.conf"
+        cat "$CONF" > "$conf"
+        cat >> "$conf" <<EOF
+# ---- stress.sh 覆盖项 ----
+port = $PORT
+trig_mode = $mode
+reactor_num = $reactors
+timeout_ms = 1000
+drain_timeout_ms = 1000
+log_level = 2
+EOF
+        echo "==== $name"
+        "$SERVER" "$conf" > "$WORK/server.out" 2>&1 &
+        pid=$!
+        if ! wait_port; then
+            echo "server did not start:" >&2
+            cat "$WORK/server.out" >&2
+            kill -KILL $pid 2>/dev/null
+            wait $pid 2>/dev/null
+            failed=1
+            summary+="$(printf '%-28s %s' "$name" "server did not start")"$'\n'
+            continue
+        fi
+        "$BENCH" -P "$PORT" -f "$TRACE" -c "$CLIENTS" -d "$DURATION" -s "$SEED" -j > "$WORK/bench.out"
+        rc=$?
+        grep -v '^{' "$WORK/bench.out"
+        kill -TERM $pid 2>/dev/null
+        wait $pid
+        src=$?
+        line=$(grep '^{' "$WORK/bench.out")
+        rps=$(echo "$line" | sed -n 's/.*"rps":\([0-9.]*\).*/\1/p')
+        p99=$(echo "$line" | sed -n 's/.*"p99":\([0-9]*\).*/\1/p')
+        uac=$(echo "$line" | sed -n 's/.*"http_use_after_close_total":\([0-9]*\).*/\1/p')
+        result=PASS
+        if [ $rc -ne 0 ] || [ $src -ne 0 ]; then
+            result="FAIL (stressbench $rc, server exit $src)"
+            failed=1
+            grep -A40 -m3 'WARNING: ThreadSanitizer' "$WORK/server.out" >&2
+        fi
+        summary+="$(printf '%-28s %10s resp/s  p99 %8s us  use-after-close %s  %s' \
+                    "$name" "${rps:--}" "${p99:--}" "${uac:--}" "$result")"$'\n'
+    done
+done
+
+echo "==== summary (seed $SEED, ${DURATION}s, $CLIENTS clients)"
+printf '%s' "$summary"
+exit $failed
@@ -0,0 +1,769 @@
+/*
+ * stressbench：按脚本回放 HTTP 会话的竞争压测工具，配合 stress.sh 在四种触发模式下检查
+ * HttpConn 在 EPOLLET/EPOLLONESHOT、worker 线程、超时定时器之间的竞争
+ *
+ *  - 会话脚本（-f，格式见 stress.trace）描述一条连接上的动作：整段发送、随机拆包、逐字节慢发（slowloris）、
+ *    停顿到超时附近再发、流水线、半关闭、发送 RST（SO_LINGER 0）等，并写明期望的响应个数、状态码或服务端关闭
+ *  - 每个并发客户端一个线程，阻塞 socket；客户端 i 的随机数种子由 -s 与 i 决定，
+ *    同一种子下每个客户端选择的会话序列、拆包位置与停顿时长都相同，失败可以按种子重放
+ *  - 延迟从一组请求的第一个字节发出算起，到最后一个期望的响应收完，慢发期间的时间也计入
+ *  - 测试前后各取一次服务端的 /metrics（-m），输出 http_use_after_close_total、http_stale_tasks_total 等计数的增量；
+ *    use-after-close、期望不符或等待超时时以退出码 2 结束
+ *
+ * 用法示例：
+ *   stressbench -f stress.trace -c 64 -d 10        64 个并发客户端回放 10 秒
+ *   stressbench -f stress.trace -s 7 -c 8 -v       按种子 7 重放，打印每个失败的会话
+ */
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <signal.h>
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "histogram.h"
+
+namespace {
+
+int64_t NowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+struct Action {
+    enum KIND {
+        SEND,           // send <字节>
+        SPLIT,          // split <字节>：随机位置切成两段，中间停顿 1~5ms
+        DRIP,           // drip <间隔ms> <字节>：逐字节发送
+        SLEEP,          // sleep <ms> [抖动ms]
+        EXPECT,         // expect [n] [状态码]
+        EXPECT_OR_EOF,  // expect-or-eof [n] [状态码]：n 个响应，或者服务端关闭连接（竞争的两种结果都正确）
+        EXPECT_EOF,     // eof：服务端关闭连接
+        SHUTDOWN,       // shutdown：半关闭写端
+        RESET,          // reset：发送 RST 并结束会话
+    };
+    KIND kind;
+    std::string data;
+    int arg1 = 0;
+    int arg2 = 0;
+};
+
+struct Session {
+    std::string name;
+    unsigned weight = 1;
+    std::vector<Action> actions;
+};
+
+struct Options {
+    std::string host = "127.0.0.1";
+    std::string port = "1316";
+    std::string trace;
+    std::string metricsPath = "/metrics";   // 为空时不取服务端指标
+    int clients = 32;
+    int duration = 10;      // 秒
+    int timeoutMs = 5000;   // 等待一次读的上限，超过算作超时（服务端卡住）
+    uint64_t seed = 1;
+    bool json = false;
+    bool verbose = false;
+};
+
+// 测试前后对比的服务端计数
+const char* const SERVER_COUNTERS[] = {
+    "http_use_after_close_total",
+    "http_stale_tasks_total",
+    "http_timer_deferred_total",
+    "http_timer_expired_total",
+    "http_requests_total",
+};
+const int SERVER_COUNTER_NUM = sizeof(SERVER_COUNTERS) / sizeof(SERVER_COUNTERS[0]);
+
+struct Stats {
+    Histogram hist;
+    uint64_t sessions = 0;
+    uint64_t responses = 0;
+    uint64_t bytes = 0;
+    uint64_t status[6] = {0};       // 按 1xx..5xx 分类，0 为无法识别
+    uint64_t serverCloses = 0;      // 符合期望的服务端关闭（eof / expect-or-eof）
+    uint64_t resets = 0;
+    uint64_t connectErrors = 0;
+    uint64_t timeouts = 0;
+    uint64_t unexpectedCloses = 0;  // 期望响应时连接被关闭
+    uint64_t mismatches = 0;        // 状态码不符、期望关闭时收到响应、响应格式错误
+    std::vector<uint64_t> perSession;
+    std::vector<uint64_t> perSessionFail;
+
+    void Merge(const Stats& o) {
+        hist.Merge(o.hist);
+        sessions += o.sessions;
+        responses += o.responses;
+        bytes += o.bytes;
+        for (int i = 0; i < 6; i++) { status[i] += o.status[i]; }
+        serverCloses += o.serverCloses;
+        resets += o.resets;
+        connectErrors += o.connectErrors;
+        timeouts += o.timeouts;
+        unexpectedCloses += o.unexpectedCloses;
+        mismatches += o.mismatches;
+        perSession.resize(std::max(perSession.size(), o.perSession.size()));
+        perSessionFail.resize(perSession.size());
+        for (size_t i = 0; i < o.perSession.size(); i++) {
+            perSession[i] += o.perSession[i];
+            perSessionFail[i] += o.perSessionFail[i];
+        }
+    }
+
+    uint64_t Failures() const { return connectErrors + timeouts + unexpectedCloses + mismatches; }
+};
+
+// ---- 会话脚本 ----
+
+// \r \n \t \\ \xHH 转义
+bool Unescape(const std::string& in, std::string* out) {
+    out->clear();
+    for (size_t i = 0; i < in.size(); i++) {
+        if (in[i] != '\\') {
+            out->push_back(in[i]);
+            continue;
+        }
+        if (++i == in.size()) { return false; }
+        switch (in[i]) {
+            case 'r': out->push_back('\r'); break;
+            case 'n': out->push_back('\n'); break;
+            case 't': out->push_back('\t'); break;
+            case '\\': out->push_back('\\'); break;
+            case 'x': {
+                if (i + 2 >= in.size()) { return false; }
+                char hex[3] = {in[i + 1], in[i + 2], '\0'};
+                char* end = nullptr;
+                long v = strtol(hex, &end, 16);
+                if (end != hex + 2) { return false; }
+                out->push_back(static_cast<char>(v));
+                i += 2;
+                break;
+            }
+            default: return false;
+        }
+    }
+    return true;
+}
+
+// 只去掉行尾的 '\r' '\n'：发送的字节里允许末尾空格
+std::string ChompLine(const std::string& line) {
+    size_t end = line.size();
+    while (end > 0 && (line[end - 1] == '\n' || line[end - 1] == '\r')) { end--; }
+    return line.substr(0, end);
+}
+
+bool LoadTrace(const char* path, std::vector<Session>* sessions, std::string* err) {
+    std::ifstream in(path);
+    if (!in) {
+        *err = std::string("cannot open ") + path;
+        return false;
+    }
+    std::string raw;
+    int lineNo = 0;
+    while (std::getline(in, raw)) {
+        lineNo++;
+        std::string line = ChompLine(raw);
+        size_t begin = line.find_first_not_of(" \t");
+        if (begin == std::string::npos || line[begin] == '#') {
+            continue;
+        }
+        size_t cmdEnd = line.find_first_of(" \t", begin);
+        std::string cmd = line.substr(begin, cmdEnd == std::string::npos ? std::string::npos : cmdEnd - begin);
+        std::string rest = cmdEnd == std::string::npos ? "" : line.substr(cmdEnd + 1);
+        std::istringstream args(rest);
+        std::string where = std::string(path) + ":" + std::to_string(lineNo) + ": ";
+
+        if (cmd == "session") {
+            Session s;
+            if (!(args >> s.weight >> s.name)) {
+                *err = where + "expected: session <weight> <name>";
+                return false;
+            }
+            sessions->push_back(s);
+            continue;
+        }
+        if (sessions->empty()) {
+            *err = where + "action before the first session";
+            return false;
+        }
+        Action a;
+        bool ok = true;
+        if (cmd == "send" || cmd == "split") {
+            a.kind = cmd == "send" ? Action::SEND : Action::SPLIT;
+            ok = Unescape(rest, &a.data) && !a.data.empty();
+        } else if (cmd == "drip") {
+            a.kind = Action::DRIP;
+            std::string data;
+            ok = static_cast<bool>(args >> a.arg1) && a.arg1 >= 0;
+            if (ok) {
+                std::getline(args >> std::ws, data);
+                ok = Unescape(data, &a.data) && !a.data.empty();
+            }
+        } else if (cmd == "sleep") {
+            a.kind = Action::SLEEP;
+            ok = static_cast<bool>(args >> a.arg1) && a.arg1 >= 0;
+            if (ok && !(args >> a.arg2)) {
+                a.arg2 = 0;
+            }
+        } else if (cmd == "expect" || cmd == "expect-or-eof") {
+            a.kind = cmd == "expect" ? Action::EXPECT : Action::EXPECT_OR_EOF;
+            a.arg1 = 1;
+            if (args >> a.arg1) {
+                args >> a.arg2;     // 状态码，0 表示不检查
+            }
+            ok = a.arg1 > 0;
+        } else if (cmd == "eof") {
+            a.kind = Action::EXPECT_EOF;
+        } else if (cmd == "shutdown") {
+            a.kind = Action::SHUTDOWN;
+        } else if (cmd == "reset") {
+            a.kind = Action::RESET;
+        } else {
+            *err = where + "unknown action '" + cmd + "'";
+            return false;
+        }
+        if (!ok) {
+            *err = where + "bad arguments for '" + cmd + "'";
+            return false;
+        }
+        sessions->back().actions.push_back(a);
+    }
+    sessions->erase(std::remove_if(sessions->begin(), sessions->end(),
+                                   [](const Session& s) { return s.weight == 0 || s.actions.empty(); }),
+                    sessions->end());
+    if (sessions->empty()) {
+        *err = std::string(path) + ": no sessions";
+        return false;
+    }
+    return true;
+}
+
+// ---- 客户端 ----
+
+class Client {
+public:
+    Client(const Options& opt, const std::vector<Session>& sessions, const addrinfo* addr, int index)
+        : opt_(opt), sessions_(sessions), addr_(addr), index_(index),
+          rng_(0x9E3779B97F4A7C15ULL * (opt.seed * 1000003 + index + 1)), totalWeight_(0), fd_(-1), end_(0) {
+        for (const Session& s : sessions_) {
+            totalWeight_ += s.weight;
+        }
+        stats_.perSession.assign(sessions_.size(), 0);
+        stats_.perSessionFail.assign(sessions_.size(), 0);
+    }
+
+    void Run(int64_t end, const std::atomic<bool>& stop);
+    const Stats& GetStats() const { return stats_; }
+
+private:
+    enum READ_RESULT {
+        READ_OK,        // 收到一个完整的最终响应（跳过 1xx）
+        READ_EOF,       // 服务端关闭（FIN 或 RST）
+        READ_TIMEOUT,
+        READ_BAD,       // 响应格式错误
+    };
+    enum RESULT {
+        RESULT_OK,
+        RESULT_FAIL,
+        RESULT_STOPPED, // 测试时间到，会话未执行完，不计入统计
+    };
+
+    RESULT RunSession_(const Session& s, uint64_t seq);
+    bool Connect_();
+    bool Send_(const char* data, size_t len);
+    READ_RESULT ReadResponse_(int* status);
+    bool Sleep_(int64_t ms);    // 测试时间到时提前返回 false
+    void Close_(bool reset);
+    uint64_t Rand_() {
+        rng_ ^= rng_ << 13;
+        rng_ ^= rng_ >> 7;
+        rng_ ^= rng_ << 17;
+        return rng_;
+    }
+    void Fail_(const Session& s, uint64_t seq, size_t step, const char* what) {
+        if (opt_.verbose) {
+            fprintf(stderr, "client %d session #%llu %s step %zu: %s\n",
+                    index_, (unsigned long long)seq, s.name.c_str(), step + 1, what);
+        }
+    }
+
+    static const size_t MAX_HEAD = 64 * 1024;
+
+    const Options& opt_;
+    const std::vector<Session>& sessions_;
+    const addrinfo* addr_;
+    int index_;
+    uint64_t rng_;
+    uint64_t totalWeight_;
+    int fd_;
+    int64_t end_;
+    const std::atomic<bool>* stop_ = nullptr;
+    std::string in_;            // 已收到、尚未解析的字节
+    Stats stats_;
+};
+
+bool Client::Connect_() {
+    fd_ = socket(addr_->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        return false;
+    }
+    int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct timeval tv;
+    tv.tv_sec = opt_.timeoutMs / 1000;
+    tv.tv_usec = (opt_.timeoutMs % 1000) * 1000;
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd_, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    if (connect(fd_, addr_->ai_addr, addr_->ai_addrlen) < 0) {
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    in_.clear();
+    return true;
+}
+
+// 服务端已关闭或发送 RST 时返回 false
+bool Client::Send_(const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd_, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) { continue; }
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+void Client::Close_(bool reset) {
+    if (fd_ < 0) {
+        return;
+    }
+    if (reset) {
+        struct linger lg = {1, 0};
+        setsockopt(fd_, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    }
+    close(fd_);
+    fd_ = -1;
+}
+
+bool Client::Sleep_(int64_t ms) {
+    int64_t until = NowNs() + ms * 1000000;
+    while (true) {
+        int64_t now = NowNs();
+        if (now >= end_ || stop_->load()) {
+            return false;
+        }
+        if (now >= until) {
+            return true;
+        }
+        int64_t step = std::min<int64_t>(until - now, 50 * 1000000LL);
+        struct timespec ts = {static_cast<time_t>(step / 1000000000), static_cast<long>(step % 1000000000)};
+        nanosleep(&ts, nullptr);
+    }
+}
+
+Client::READ_RESULT Client::ReadResponse_(int* status) {
+    char buf[16 * 1024];
+    while (true) {
+        size_t headEnd = in_.find("\r\n\r\n");
+        if (headEnd != std::string::npos) {
+            if (in_.compare(0, 5, "HTTP/") != 0) {
+                return READ_BAD;
+            }
+            *status = in_.size() > 12 ? atoi(in_.c_str() + 9) : 0;
+            uint64_t bodyLen = 0;
+            size_t pos = 0;
+            while ((pos = in_.find("\r\n", pos)) != std::string::npos && pos < headEnd) {
+                pos += 2;
+                if (strncasecmp(in_.c_str() + pos, "Content-Length:", 15) == 0) {
+                    bodyLen = strtoull(in_.c_str() + pos + 15, nullptr, 10);
+                }
+            }
+            uint64_t total = headEnd + 4 + (*status >= 200 ? bodyLen : 0);
+            if (in_.size() >= total) {
+                in_.erase(0, total);
+                stats_.bytes += total;
+                if (*status >= 100 && *status < 200) {
+                    continue;   // 100 Continue 等中间响应
+                }
+                return READ_OK;
+            }
+        } else if (in_.size() > MAX_HEAD) {
+            return READ_BAD;
+        }
+        ssize_t n = recv(fd_, buf, sizeof(buf), 0);
+        if (n > 0) {
+            in_.append(buf, n);
+        } else if (n == 0) {
+            return READ_EOF;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return READ_TIMEOUT;
+        } else {
+            return READ_EOF;    // ECONNRESET 等
+        }
+    }
+}
+
+Client::RESULT Client::RunSession_(const Session& s, uint64_t seq) {
+    if (!Connect_()) {
+        stats_.connectErrors++;
+        Fail_(s, seq, 0, "connect failed");
+        return RESULT_FAIL;
+    }
+    bool peerClosed = false;    // 发送失败：服务端已关闭，之后只剩 eof / expect-or-eof 能成立
+    int64_t batchStart = 0;     // 当前这组请求第一个字节发出的时间
+    for (size_t step = 0; step < s.actions.size(); step++) {
+        const Action& a = s.actions[step];
+        switch (a.kind) {
+            case Action::SEND:
+            case Action::SPLIT:
+            case Action::DRIP: {
+                if (peerClosed) { break; }
+                if (batchStart == 0) { batchStart = NowNs(); }
+                const char* p = a.data.data();
+                size_t len = a.data.size();
+                if (a.kind == Action::SEND || len < 2) {
+                    peerClosed = !Send_(p, len);
+                } else if (a.kind == Action::SPLIT) {
+                    size_t cut = 1 + Rand_() % (len - 1);
+                    peerClosed = !Send_(p, cut);
+                    if (!Sleep_(1 + Rand_() % 5)) { Close_(false); return RESULT_STOPPED; }
+                    peerClosed = peerClosed || !Send_(p + cut, len - cut);
+                } else {
+                    for (size_t i = 0; i < len && !peerClosed; i++) {
+                        if (i > 0 && !Sleep_(a.arg1)) { Close_(false); return RESULT_STOPPED; }
+                        peerClosed = !Send_(p + i, 1);
+                    }
+                }
+                break;
+            }
+            case Action::SLEEP:
+                if (!Sleep_(a.arg1 + (a.arg2 > 0 ? static_cast<int64_t>(Rand_() % a.arg2) : 0))) {
+                    Close_(false);
+                    return RESULT_STOPPED;
+                }
+                break;
+            case Action::EXPECT:
+            case Action::EXPECT_OR_EOF:
+                for (int i = 0; i < a.arg1; i++) {
+                    int status = 0;
+                    READ_RESULT r = ReadResponse_(&status);
+                    if (r == READ_EOF && a.kind == Action::EXPECT_OR_EOF) {
+                        stats_.serverCloses++;
+                        Close_(false);
+                        return RESULT_OK;
+                    }
+                    if (r != READ_OK) {
+                        if (r == READ_TIMEOUT) {
+                            stats_.timeouts++;
+                            Fail_(s, seq, step, "timed out waiting for a response");
+                        } else if (r == READ_EOF) {
+                            stats_.unexpectedCloses++;
+                            Fail_(s, seq, step, "connection closed before the response");
+                        } else {
+                            stats_.mismatches++;
+                            Fail_(s, seq, step, "malformed response");
+                        }
+                        Close_(false);
+                        return RESULT_FAIL;
+                    }
+                    stats_.responses++;
+                    stats_.status[status >= 100 && status < 600 ? status / 100 : 0]++;
+                    if (batchStart) {
+                        stats_.hist.Record(static_cast<uint64_t>((NowNs() - batchStart) / 1000));
+                    }
+                    if (a.arg2 && status != a.arg2) {
+                        stats_.mismatches++;
+                        char what[64];
+                        snprintf(what, sizeof(what), "status %d, expected %d", status, a.arg2);
+                        Fail_(s, seq, step, what);
+                        Close_(false);
+                        return RESULT_FAIL;
+                    }
+                }
+                batchStart = 0;
+                break;
+            case Action::EXPECT_EOF: {
+                int status = 0;
+                READ_RESULT r = ReadResponse_(&status);
+                if (r == READ_EOF) {
+                    stats_.serverCloses++;
+                    Close_(false);
+                    return RESULT_OK;
+                }
+                if (r == READ_TIMEOUT) {
+                    stats_.timeouts++;
+                    Fail_(s, seq, step, "timed out waiting for the server to close");
+                } else {
+                    stats_.mismatches++;
+                    Fail_(s, seq, step, "expected the server to close the connection");
+                }
+                Close_(false);
+                return RESULT_FAIL;
+            }
+            case Action::SHUTDOWN:
+                shutdown(fd_, SHUT_WR);
+                break;
+            case Action::RESET:
+                stats_.resets++;
+                Close_(true);
+                return RESULT_OK;
+        }
+    }
+    Close_(false);
+    return RESULT_OK;
+}
+
+void Client::Run(int64_t end, const std::atomic<bool>& stop) {
+    end_ = end;
+    stop_ = &stop;
+    for (uint64_t seq = 0; !stop && NowNs() < end; seq++) {
+        uint64_t r = Rand_() % totalWeight_;
+        size_t i = 0;
+        while (r >= sessions_[i].weight) {
+            r -= sessions_[i].weight;
+            i++;
+        }
+        RESULT result = RunSession_(sessions_[i], seq);
+        if (result == RESULT_STOPPED) {
+            break;
+        }
+        stats_.sessions++;
+        stats_.perSession[i]++;
+        if (result == RESULT_FAIL) {
+            stats_.perSessionFail[i]++;
+        }
+    }
+}
+
+// ---- 服务端指标 ----
+
+// 请求 /metrics 并取出 SERVER_COUNTERS 的值（同名多条时相加），失败返回 false
+bool FetchCounters(const Options& opt, const addrinfo* addr, uint64_t* values) {
+    int fd = socket(addr->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct timeval tv = {static_cast<time_t>(opt.timeoutMs / 1000), (opt.timeoutMs % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    std::string req = "GET " + opt.metricsPath + " HTTP/1.1\r\nHost: " + opt.host + "\r\nConnection: close\r\n\r\n";
+    std::string resp;
+    if (connect(fd, addr->ai_addr, addr->ai_addrlen) == 0 &&
+        send(fd, req.data(), req.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(req.size())) {
+        char buf[16 * 1024];
+        ssize_t n;
+        while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+            resp.append(buf, n);
+        }
+    }
+    close(fd);
+    if (resp.compare(0, 12, "HTTP/1.1 200") != 0) {
+        return false;
+    }
+    std::fill(values, values + SERVER_COUNTER_NUM, 0);
+    std::istringstream lines(resp.substr(resp.find("\r\n\r\n") + 4));
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t nameEnd = line.find_first_of("{ ");
+        std::string name = line.substr(0, nameEnd);
+        for (int i = 0; i < SERVER_COUNTER_NUM; i++) {
+            if (name == SERVER_COUNTERS[i]) {
+                values[i] += strtoull(line.c_str() + line.rfind(' ') + 1, nullptr, 10);
+            }
+        }
+    }
+    return true;
+}
+
+void Report(const Options& opt, const std::vector<Session>& sessions, const Stats& s, double seconds,
+            bool haveServer, const uint64_t* serverDelta, bool pass) {
+    const Histogram& h = s.hist;
+    printf("%s:%s  %d clients, seed %llu, %s (%zu sessions)\n", opt.host.c_str(), opt.port.c_str(),
+           opt.clients, (unsigned long long)opt.seed, opt.trace.c_str(), sessions.size());
+    printf("  sessions %llu  responses %llu in %.2fs, %.1f resp/s, %.1f sessions/s\n",
+           (unsigned long long)s.sessions, (unsigned long long)s.responses, seconds,
+           s.responses / seconds, s.sessions / seconds);
+    printf("  latency(us)  min %llu  p50 %llu  p90 %llu  p99 %llu  p99.9 %llu  max %llu  mean %.1f\n",
+           (unsigned long long)h.Min(), (unsigned long long)h.ValueAt(50), (unsigned long long)h.ValueAt(90),
+           (unsigned long long)h.ValueAt(99), (unsigned long long)h.ValueAt(99.9),
+           (unsigned long long)h.Max(), h.Mean());
+    printf("  status 2xx %llu  3xx %llu  4xx %llu  5xx %llu  other %llu\n",
+           (unsigned long long)s.status[2], (unsigned long long)s.status[3], (unsigned long long)s.status[4],
+           (unsigned long long)s.status[5], (unsigned long long)(s.status[0] + s.status[1]));
+    printf("  closes by server %llu  resets sent %llu\n",
+           (unsigned long long)s.serverCloses, (unsigned long long)s.resets);
+    printf("  errors connect %llu  timeout %llu  unexpected-close %llu  mismatch %llu\n",
+           (unsigned long long)s.connectErrors, (unsigned long long)s.timeouts,
+           (unsigned long long)s.unexpectedCloses, (unsigned long long)s.mismatches);
+    for (size_t i = 0; i < sessions.size(); i++) {
+        printf("    %-24s %8llu runs  %llu failed\n", sessions[i].name.c_str(),
+               (unsigned long long)s.perSession[i], (unsigned long long)s.perSessionFail[i]);
+    }
+    if (haveServer) {
+        printf("  server");
+        for (int i = 0; i < SERVER_COUNTER_NUM; i++) {
+            printf("  %s +%llu", SERVER_COUNTERS[i], (unsigned long long)serverDelta[i]);
+        }
+        printf("\n");
+    } else if (!opt.metricsPath.empty()) {
+        printf("  server metrics unavailable (%s)\n", opt.metricsPath.c_str());
+    }
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    if (opt.json) {
+        printf("{\"clients\":%d,\"seed\":%llu,\"seconds\":%.3f,\"sessions\":%llu,\"responses\":%llu,\"rps\":%.1f,"
+               "\"latency_us\":{\"min\":%llu,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu,\"mean\":%.1f},"
+               "\"errors\":{\"connect\":%llu,\"timeout\":%llu,\"unexpected_close\":%llu,\"mismatch\":%llu},"
+               "\"server_closes\":%llu,\"resets\":%llu",
+               opt.clients, (unsigned long long)opt.seed, seconds, (unsigned long long)s.sessions,
+               (unsigned long long)s.responses, s.responses / seconds,
+               (unsigned long long)h.Min(), (unsigned long long)h.ValueAt(50), (unsigned long long)h.ValueAt(90),
+               (unsigned long long)h.ValueAt(99), (unsigned long long)h.ValueAt(99.9),
+               (unsigned long long)h.Max(), h.Mean(),
+               (unsigned long long)s.connectErrors, (unsigned long long)s.timeouts,
+               (unsigned long long)s.unexpectedCloses, (unsigned long long)s.mismatches,
+               (unsigned long long)s.serverCloses, (unsigned long long)s.resets);
+        if (haveServer) {
+            printf(",\"server\":{");
+            for (int i = 0; i < SERVER_COUNTER_NUM; i++) {
+                printf("%s\"%s\":%llu", i ? "," : "", SERVER_COUNTERS[i], (unsigned long long)serverDelta[i]);
+            }
+            printf("}");
+        }
+        printf(",\"pass\":%s}\n", pass ? "true" : "false");
+    }
+}
+
+void Usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s -f trace [options]\n"
+            "  -H host      server address (default 127.0.0.1)\n"
+            "  -P port      server port (default 1316)\n"
+            "  -f file      session trace to replay (see stress.trace)\n"
+            "  -c n         concurrent clients, one thread each (default 32)\n"
+            "  -d sec       duration (default 10)\n"
+            "  -s seed      random seed; the same seed replays the same session sequence (default 1)\n"
+            "  -T ms        read timeout before a session counts as stuck (default 5000)\n"
+            "  -m path      server metrics path, '' to skip the server-side check (default /metrics)\n"
+            "  -v           print every failed session\n"
+            "  -j           also print one JSON line\n",
+            prog);
+}
+
+std::atomic<bool> g_stop(false);
+
+void OnSignal(int) {
+    g_stop = true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    int ch;
+    while ((ch = getopt(argc, argv, "H:P:f:c:d:s:T:m:vjh")) != -1) {
+        switch (ch) {
+            case 'H': opt.host = optarg; break;
+            case 'P': opt.port = optarg; break;
+            case 'f': opt.trace = optarg; break;
+            case 'c': opt.clients = atoi(optarg); break;
+            case 'd': opt.duration = atoi(optarg); break;
+            case 's': opt.seed = strtoull(optarg, nullptr, 10); break;
+            case 'T': opt.timeoutMs = atoi(optarg); break;
+            case 'm': opt.metricsPath = optarg; break;
+            case 'v': opt.verbose = true; break;
+            case 'j': opt.json = true; break;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+    if (opt.trace.empty() || opt.clients <= 0 || opt.duration <= 0 || opt.timeoutMs <= 0) {
+        Usage(argv[0]);
+        return 1;
+    }
+    std::vector<Session> sessions;
+    std::string err;
+    if (!LoadTrace(opt.trace.c_str(), &sessions, &err)) {
+        fprintf(stderr, "%s\n", err.c_str());
+        return 1;
+    }
+
+    struct addrinfo hints = {0};
+    struct addrinfo* addr = nullptr;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    int ret = getaddrinfo(opt.host.c_str(), opt.port.c_str(), &hints, &addr);
+    if (ret != 0) {
+        fprintf(stderr, "resolve %s: %s\n", opt.host.c_str(), gai_strerror(ret));
+        return 1;
+    }
+    signal(SIGINT, OnSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    uint64_t before[SERVER_COUNTER_NUM] = {0};
+    uint64_t after[SERVER_COUNTER_NUM] = {0};
+    bool haveServer = !opt.metricsPath.empty() && FetchCounters(opt, addr, before);
+
+    std::vector<std::unique_ptr<Client>> clients;
+    for (int i = 0; i < opt.clients; i++) {
+        clients.emplace_back(new Client(opt, sessions, addr, i));
+    }
+    int64_t start = NowNs();
+    int64_t end = start + static_cast<int64_t>(opt.duration) * 1000000000LL;
+    std::vector<std::thread> threads;
+    for (auto& c : clients) {
+        threads.emplace_back([&c, end] { c->Run(end, g_stop); });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    double seconds = (NowNs() - start) / 1e9;
+
+    Stats total;
+    for (auto& c : clients) {
+        total.Merge(c->GetStats());
+    }
+    uint64_t delta[SERVER_COUNTER_NUM] = {0};
+    if (haveServer) {
+        usleep(200 * 1000);     // 留给服务端处理完最后发出的 RST 与关闭
+        haveServer = FetchCounters(opt, addr, after);
+        for (int i = 0; i < SERVER_COUNTER_NUM; i++) {
+            delta[i] = after[i] - before[i];
+        }
+    }
+    bool pass = total.Failures() == 0 && (!haveServer || delta[0] == 0);
+    Report(opt, sessions, total, seconds > 0 ? seconds : 1, haveServer, delta, pass);
+    freeaddrinfo(addr);
+    return pass ? 0 : 2;
+}
@@ -1,11 +1,20 @@
 #include "buffer.h"
+#include <algorithm>  // std::max
+#include <new>        // std::bad_alloc
 
-//初始化下标
-Buffer::Buffer(int initBuffSize): buffer_(initBuffSize),readPos_(0), writePos_(0) {}
+//初始化下标（不分配内存，第一次写入时再取块）
+Buffer::Buffer(int initBuffSize): buffer_(nullptr), capacity_(0),
+    initSize_(initBuffSize > 0 ? initBuffSize : BufferPool::MIN_BLOCK), readPos_(0), writePos_(0) {}
+
+Buffer::~Buffer() {
+    if(buffer_) {
+        BufferPool::Free(buffer_, capacity_);
+    }
+}
 
 //可写字节数
 size_t Buffer::WritableBytes() const {
-    return buffer_.size() - writePos_;
+    return capacity_ - writePos_;
 }
 //可读字节数
 size_t Buffer::ReadableBytes() const {
@@ -50,6 +59,17 @@ void Buffer::RetrieveAll() {
     readPos_ = 0;
     writePos_ = 0;
 }
+//没有可读数据时归还内存块
+void Buffer::Shrink() {
+    if(!buffer_ || ReadableBytes() > 0) {
+        return;
+    }
+    BufferPool::Free(buffer_, capacity_);
+    buffer_ = nullptr;
+    capacity_ = 0;
+    readPos_ = 0;
+    writePos_ = 0;
+}
 //将所有可读数据拷贝成string返回，并清空缓冲区
 std::string Buffer::RetrieveAllToStr() {
     std::string str(Peek(), ReadableBytes());
@@ -94,16 +114,28 @@ void Buffer::Append(const Buffer& buff) {
 }
 //返回底层缓冲区开始的指针（非const版本）
 char* Buffer::BeginPtr_() {
-    return &*buffer_.begin();
+    return buffer_;
 }
 //返回底层缓冲区开始的指针（const版本）
 const char* Buffer::BeginPtr_() const {
-    return &*buffer_.begin();
+    return buffer_;
 }
 //当可写空间不足时调用：尝试复用前面读取掉的空间
 void Buffer::MakeSpace_(size_t len) {
-    if(WritableBytes() + PrependableBytes() < len) { //连前置空间也不够
-        buffer_.resize(writePos_ + len + 1); //多加1字节，防止writePos_==buffer_.size()
+    if(WritableBytes() + PrependableBytes() < len) { //连前置空间也不够，换一个更大的块，未读数据搬到新块头部
+        size_t readable = ReadableBytes();
+        size_t capacity = 0;
+        char* block = BufferPool::Alloc(std::max(readable + len, initSize_), &capacity);
+        if(readable > 0) {
+            memcpy(block, BeginPtr_() + readPos_, readable);
+        }
+        if(buffer_) {
+            BufferPool::Free(buffer_, capacity_);
+        }
+        buffer_ = block;
+        capacity_ = capacity;
+        readPos_ = 0;
+        writePos_ = readable;
     } else {
         size_t readable = ReadableBytes();
         std::copy(BeginPtr_() + readPos_, BeginPtr_() + writePos_, BeginPtr_()); //把未读数据搬到缓冲区头部
@@ -114,21 +146,26 @@ void Buffer::MakeSpace_(size_t len) {
 }
 //从fd读取数据追加到buffer中
 ssize_t Buffer::ReadFd(int fd, int* Errno) {
-    char buff[65536]; //栈上临时缓冲区
+    char* spare = BufferPool::Spare(); //本线程的溢出区
     struct iovec iov[2];
     const size_t writable = WritableBytes();
-    iov[0].iov_base = BeginPtr_() + writePos_;
-    iov[0].iov_len = writable;
-    iov[1].iov_base = buff;
-    iov[1].iov_len = sizeof(buff);
-    const ssize_t len = readv(fd, iov, 2);
+    int iovCnt = 0;
+    if(writable > 0) {
+        iov[iovCnt].iov_base = BeginPtr_() + writePos_;
+        iov[iovCnt].iov_len = writable;
+        iovCnt++;
+    }
+    iov[iovCnt].iov_base = spare;
+    iov[iovCnt].iov_len = BufferPool::MAX_POOLED_BLOCK;
+    iovCnt++;
+    const ssize_t len = readv(fd, iov, iovCnt);
     if(len < 0) {
         *Errno = errno;
     } else if(static_cast<size_t>(len) <= writable) {
         writePos_ += len;
     } else {
-        writePos_ = buffer_.size();
-        Append(buff, len - writable);
+        writePos_ = capacity_;
+        Append(spare, len - writable);
     }
     return len;
 }
@@ -146,4 +183,107 @@ ssize_t Buffer::WriteFd(int fd, int* Errno) {
         writePos_ = 0;
     }
     return len;
-}
\ No newline at end of file
+}
+
+/* ----------------- BufferPool ----------------- */
+
+namespace {
+
+const int POOL_CLASS_NUM = 7;   // 1KB, 2KB, ..., 64KB
+
+// 空闲块以单链表串起来，链表指针存放在块的头部
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+struct ThreadBlockPool {
+    ThreadBlockPool() : spare(nullptr), cachedBytes(0) {
+        for(int i = 0; i < POOL_CLASS_NUM; i++) {
+            heads[i] = nullptr;
+            bytes[i] = 0;
+        }
+    }
+    ~ThreadBlockPool();
+
+    FreeBlock* heads[POOL_CLASS_NUM];
+    size_t bytes[POOL_CLASS_NUM];
+    char* spare;
+    size_t cachedBytes;
+};
+
+// 线程退出时池已析构，之后归还的块（例如静态对象析构时）直接 free
+thread_local bool poolDestroyed = false;
+thread_local ThreadBlockPool pool;
+
+ThreadBlockPool::~ThreadBlockPool() {
+    poolDestroyed = true;
+    for(int i = 0; i < POOL_CLASS_NUM; i++) {
+        while(heads[i]) {
+            FreeBlock* block = heads[i];
+            heads[i] = block->next;
+            free(block);
+        }
+    }
+    free(spare);
+}
+
+// 容纳 len 字节的档位，超过最大一档返回 -1
+int ClassOf(size_t len) {
+    size_t size = BufferPool::MIN_BLOCK;
+    for(int i = 0; i < POOL_CLASS_NUM; i++, size <<= 1) {
+        if(len <= size) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+char* BufferPool::Alloc(size_t len, size_t* capacity) {
+    int cls = ClassOf(len);
+    if(cls < 0) {
+        // 大块不缓存，按 64KB 对齐分配以减少再次扩容
+        *capacity = (len + MAX_POOLED_BLOCK - 1) / MAX_POOLED_BLOCK * MAX_POOLED_BLOCK;
+        char* block = static_cast<char*>(malloc(*capacity));
+        if(!block) { throw std::bad_alloc(); }
+        return block;
+    }
+    *capacity = MIN_BLOCK << cls;
+    if(!poolDestroyed && pool.heads[cls]) {
+        FreeBlock* block = pool.heads[cls];
+        pool.heads[cls] = block->next;
+        pool.bytes[cls] -= *capacity;
+        pool.cachedBytes -= *capacity;
+        return reinterpret_cast<char*>(block);
+    }
+    char* block = static_cast<char*>(malloc(*capacity));
+    if(!block) { throw std::bad_alloc(); }
+    return block;
+}
+
+void BufferPool::Free(char* block, size_t capacity) {
+    int cls = ClassOf(capacity);
+    if(poolDestroyed || cls < 0 || (MIN_BLOCK << cls) != capacity ||
+       pool.bytes[cls] + capacity > POOL_BYTES_PER_CLASS) {
+        free(block);
+        return;
+    }
+    FreeBlock* node = reinterpret_cast<FreeBlock*>(block);
+    node->next = pool.heads[cls];
+    pool.heads[cls] = node;
+    pool.bytes[cls] += capacity;
+    pool.cachedBytes += capacity;
+}
+
+char* BufferPool::Spare() {
+    if(!pool.spare) {
+        pool.spare = static_cast<char*>(malloc(MAX_POOLED_BLOCK));
+        if(!pool.spare) { throw std::bad_alloc(); }
+    }
+    return pool.spare;
+}
+
+size_t BufferPool::CachedBytes() {
+    return poolDestroyed ? 0 : pool.cachedBytes;
+}
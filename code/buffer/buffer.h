@@ -5,7 +5,7 @@
 #include <iostream>
 #include <unistd.h>  // write, close
 #include <sys/uio.h> // readv
-#include <vector>    // 底层存储
+#include <stdlib.h>  // malloc, free
 #include <atomic>
 #include <assert.h>
 
@@ -13,7 +13,8 @@
  * Buffer
  *
  * 简要说明：
- * 这是一个基于 std::vector<char> 的字节缓冲区类，用于网络 IO 场景。
+ * 这是一个基于连续内存块的字节缓冲区类，用于网络 IO 场景。内存块来自每线程的块池（BufferPool），
+ * 按 2 的幂分档（1KB ~ 64KB），更大的块直接 malloc。
  * 它维护读写两个索引（readPos_, writePos_），并提供：
  *  - 可读字节数（ReadableBytes）
  *  - 可写字节数（WritableBytes）
@@ -24,6 +25,11 @@
  *   - 解析请求使用 Peek() + Retrieve(...)
  *   - 发送响应使用 Append(...)，随后 WriteFd()
  *
+ * 内存管理：
+ *  - 构造时不分配内存，第一次写入时才按 initBuffSize 取块；空间不足时换成更大的一档并搬移未读数据
+ *  - 没有可读数据时可调用 Shrink() 把块还给当前线程的块池，空闲的 keep-alive 连接因此不占缓冲区内存
+ *  - ReadFd 的溢出区是每线程一块的 64KB 备用块，不再在栈上开 64KB 数组
+ *
  * 设计注意：
  *  - 本类并未在内部对复杂并发场景做全锁保护；若在多线程环境共享同一 Buffer，
  *    需要外部加锁或使用专门的无锁 SPSC 设计。尽管使用了 std::atomic 来存位置索引，
@@ -35,11 +41,13 @@ public:
     // 构造：initBuffSize 为初始缓冲区容量（字节）
     // 推荐保留少量前置空间（例如用于 prepend header），但此处由实现者决定。
     Buffer(int initBuffSize = 1024);
-    ~Buffer() = default;
+    ~Buffer();
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
     /* ----------------- 大小/空间相关 ----------------- */
 
     // 返回当前可写入的字节数（buffer_ 末尾到 writePos_ 的剩余容量）
-    // 公式通常为 buffer_.size() - writePos_
+    // 公式通常为 capacity_ - writePos_
     size_t WritableBytes() const;
 
     // 返回当前可读取的字节数（已写入但未被 读取的字节数）
@@ -77,6 +85,12 @@ public:
     // 实现可选择不释放底层 capacity，仅将索引重置
     void RetrieveAll();
 
+    // 没有可读数据时把内存块还给当前线程的块池（有数据时什么也不做），下次写入时再取
+    void Shrink();
+
+    // 当前持有的内存块大小（未持有时为 0）
+    size_t Capacity() const { return capacity_; }
+
     // 将所有可读数据拷贝成 std::string 返回，并清空缓冲区
     // 注意：会做一次拷贝，性能敏感场景请优先使用 Peek() + Retrieve()
     std::string RetrieveAllToStr();
@@ -91,6 +105,7 @@ public:
 
     // 以下一组 Append 将数据追加到缓冲区尾部（会自动 EnsureWriteable）
     void Append(const std::string& str);
+    void Append(const char* str) { Append(str, strlen(str)); }  // C 字符串（字面量不再先构造 std::string）
     void Append(const char* str, size_t len);
     void Append(const void* data, size_t len);
     void Append(const Buffer& buff); // 将另一个 Buffer 的可读内容复制过来
@@ -98,8 +113,9 @@ public:
     /* ----------------- 与文件描述符交互（IO） ----------------- */
 
     // 从 fd 读取数据追加到 buffer 中（通常用于 socket 读取）
-    // 实现常用 readv：第一个 iovec 指向 BeginWrite() 的可写空间，
-    // 第二个 iovec 指向临时栈缓冲区以接收溢出数据，然后把溢出数据 Append 进来。
+    // 实现用 readv：第一个 iovec 指向 BeginWrite() 的可写空间，
+    // 第二个 iovec 指向本线程的备用块以接收溢出数据，然后把溢出数据 Append 进来。
+    // 读到 EAGAIN 时不会为空缓冲区分配内存。
     // 返回读到的字节数（>=0），若 <0 出错并把 errno 写入 *Errno
     ssize_t ReadFd(int fd, int* Errno);
 
@@ -118,12 +134,14 @@ private:
     const char* BeginPtr_() const;
 
     // 当可写空间不足时调用：尝试复用前面读取掉的空间（移动未读数据到头部），
-    // 如果仍不足则扩容 vector（通常按增长策略扩容）
+    // 如果仍不足则从块池换一个能容纳全部数据的更大块（按 2 的幂增长）
     void MakeSpace_(size_t len);
 
     /* ----------------- 成员变量 ----------------- */
 
-    std::vector<char> buffer_;            // 底层存储：连续内存块
+    char* buffer_;                        // 底层存储：连续内存块（未分配时为 nullptr）
+    size_t capacity_;                     // buffer_ 的大小
+    size_t initSize_;                     // 第一次分配的大小
     std::atomic<std::size_t> readPos_;    // 读取索引（已读取的位置）
     std::atomic<std::size_t> writePos_;   // 写入索引（已写入的位置）
     // 说明：尽管使用了 std::atomic 来存索引，但复杂操作（如扩容、MakeSpace_）仍需外部同步，
@@ -131,4 +149,26 @@ private:
     // 请在外层使用互斥（mutex）或采用单生产者-单消费者（SPSC）模型并仔细处理内存序列。
 };
 
+/*
+ * BufferPool：每线程一个的内存块池（仅供 Buffer 使用）
+ * 按 2 的幂分档缓存释放的块，每档最多缓存 POOL_BYTES_PER_CLASS 字节，超出的直接 free。
+ * 块可以在一个线程取、另一个线程还（例如 worker 线程读、Reactor 线程关闭连接），它会进入归还线程的池。
+ */
+class BufferPool {
+public:
+    static const size_t MIN_BLOCK = 1024;               // 最小一档
+    static const size_t MAX_POOLED_BLOCK = 64 * 1024;   // 超过这一档的块不缓存
+    static const size_t POOL_BYTES_PER_CLASS = 1024 * 1024;
+
+    // 取一块不小于 len 的内存，*capacity 返回实际大小
+    static char* Alloc(size_t len, size_t* capacity);
+    // 归还 Alloc 得到的块（capacity 必须是 Alloc 返回的大小）
+    static void Free(char* block, size_t capacity);
+    // 本线程 ReadFd 使用的溢出区（MAX_POOLED_BLOCK 字节）
+    static char* Spare();
+
+    // 本线程池中缓存的字节数
+    static size_t CachedBytes();
+};
+
 #endif //BUFFER_H
@@ -0,0 +1,93 @@
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>    // strcasecmp
+#include <errno.h>
+
+namespace {
+// 去掉 [begin, end) 两侧的空白
+void Trim(const char*& begin, const char*& end) {
+    while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r')) { ++begin; }
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) { --end; }
+}
+} // namespace
+
+bool Config::Load(const std::string& path, std::string* err) {
+    FILE* fp = fopen(path.c_str(), "r");
+    if (!fp) {
+        if (err) { *err = strerror(errno); }
+        return false;
+    }
+    std::unordered_map<std::string, std::string> values;
+    char line[1024];
+    int lineNo = 0;
+    bool ok = true;
+    while (fgets(line, sizeof(line), fp)) {
+        lineNo++;
+        const char* begin = line;
+        const char* end = line + strlen(line);
+        if (end > begin && end[-1] != '\n' && !feof(fp)) {
+            if (err) { *err = "line " + std::to_string(lineNo) + ": too long"; }
+            ok = false;
+            break;
+        }
+        const char* comment = static_cast<const char*>(memchr(begin, '#', end - begin));
+        if (comment) { end = comment; }
+        if (end > begin && end[-1] == '\n') { --end; }
+        Trim(begin, end);
+        if (begin == end) {
+            continue;
+        }
+        const char* eq = static_cast<const char*>(memchr(begin, '=', end - begin));
+        const char* keyEnd = eq;
+        const char* value = eq ? eq + 1 : nullptr;
+        if (eq) { Trim(begin, keyEnd); }
+        if (!eq || keyEnd == begin) {
+            if (err) { *err = "line " + std::to_string(lineNo) + ": expected key = value"; }
+            ok = false;
+            break;
+        }
+        Trim(value, end);
+        values[std::string(begin, keyEnd)] = std::string(value, end);
+    }
+    fclose(fp);
+    if (ok) {
+        path_ = path;
+        values_.swap(values);
+    }
+    return ok;
+}
+
+int Config::GetInt(const char* key, int def) const {
+    auto it = values_.find(key);
+    if (it == values_.end() || it->second.empty()) {
+        return def;
+    }
+    char* end = nullptr;
+    long v = strtol(it->second.c_str(), &end, 10);
+    if (*end != '\0') {
+        return def;
+    }
+    return static_cast<int>(v);
+}
+
+bool Config::GetBool(const char* key, bool def) const {
+    auto it = values_.find(key);
+    if (it == values_.end()) {
+        return def;
+    }
+    const char* v = it->second.c_str();
+    if (!strcasecmp(v, "true") || !strcasecmp(v, "yes") || !strcasecmp(v, "on") || !strcmp(v, "1")) {
+        return true;
+    }
+    if (!strcasecmp(v, "false") || !strcasecmp(v, "no") || !strcasecmp(v, "off") || !strcmp(v, "0")) {
+        return false;
+    }
+    return def;
+}
+
+std::string Config::GetString(const char* key, const std::string& def) const {
+    auto it = values_.find(key);
+    return it == values_.end() ? def : it->second;
+}
@@ -0,0 +1,32 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+#include <unordered_map>
+
+/*
+ * Config：服务器配置文件
+ *  - 每行一个 "key = value"，'#' 之后为注释，空行忽略；值两侧的空白去掉，不支持引号与续行
+ *  - 同一个键出现多次时以最后一次为准
+ *  - 读取时由调用方给出默认值：文件中没有的键、或值不是合法数字时使用默认值
+ *  - 启动时由 main 加载后交给 WebServer；SIGHUP 时 WebServer 按 Path() 重新加载
+ */
+class Config {
+public:
+    // 解析 path 指向的文件，成功后替换当前内容；失败时保持原内容不变，*err 为原因（含行号）
+    bool Load(const std::string& path, std::string* err);
+
+    // 最近一次成功加载的文件路径（没有加载过时为空）
+    const std::string& Path() const { return path_; }
+
+    bool Has(const char* key) const { return values_.count(key) > 0; }
+    int GetInt(const char* key, int def) const;
+    bool GetBool(const char* key, bool def) const;   // true/false、yes/no、on/off、1/0
+    std::string GetString(const char* key, const std::string& def) const;
+
+private:
+    std::string path_;
+    std::unordered_map<std::string, std::string> values_;
+};
+
+#endif //CONFIG_H
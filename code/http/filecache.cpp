@@ -0,0 +1,295 @@
+#include "filecache.h"
+
+FileCache::FileCache() : maxBytes_(64 * 1024 * 1024), maxFileBytes_(1024 * 1024), checkIntervalMS_(1000) {}
+
+FileCache* FileCache::Instance() {
+    static FileCache cache;
+    return &cache;
+}
+
+// 设置缓存上限，并按新上限淘汰。单个文件不能超过一个分片的预算，
+// 否则插入后立即被淘汰，每次请求都要重新映射，比不缓存更差
+void FileCache::Init(size_t maxBytes, size_t maxFileBytes, int checkIntervalMS) {
+    maxBytes_ = maxBytes;
+    maxFileBytes_ = std::min(maxFileBytes, maxBytes / SHARD_NUM);
+    checkIntervalMS_ = checkIntervalMS;
+    for (int i = 0; i < SHARD_NUM; i++) {
+        std::lock_guard<std::mutex> locker(shards_[i].mtx);
+        Evict_(shards_[i], maxBytes / SHARD_NUM);
+    }
+}
+
+// 获取文件，命中且未到校验间隔时不做任何系统调用
+std::shared_ptr<const FileEntry> FileCache::Get(const std::string& path, const char* type, bool* tooLarge) {
+    *tooLarge = false;
+    Shard& shard = ShardOf_(path);
+    Clock::time_point now = Clock::now();
+    std::shared_ptr<const FileEntry> stale;
+    {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        auto it = shard.index.find(path);
+        if (it != shard.index.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);    // 移到 LRU 头部
+            Node& node = *it->second;
+            if (now - node.checkedAt < std::chrono::milliseconds(checkIntervalMS_)) {
+                return node.entry;
+            }
+            stale = node.entry;
+        }
+    }
+
+    // 未命中或需要重新校验：stat 放在锁外
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0 || S_ISDIR(st.st_mode)) {
+        if (stale) { Insert_(shard, path, nullptr); }
+        return nullptr;
+    }
+    if (stale && SameFile_(stale->st, st)) {
+        // 文件没变，只刷新校验时间
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        auto it = shard.index.find(path);
+        if (it != shard.index.end() && it->second->entry == stale) {
+            it->second->checkedAt = now;
+        }
+        return stale;
+    }
+    if (static_cast<size_t>(st.st_size) > maxFileBytes_) {
+        *tooLarge = true;
+        if (stale) { Insert_(shard, path, nullptr); }
+        return nullptr;
+    }
+
+    std::shared_ptr<const FileEntry> entry = Load_(path, st, type);
+    // 不可读或打开/映射失败的条目（没有生成响应头）不缓存，下次请求重新尝试
+    if (!entry->headers.empty()) {
+        Insert_(shard, path, entry);
+    } else if (stale) {
+        Insert_(shard, path, nullptr);
+    }
+    return entry;
+}
+
+void FileCache::Clear() {
+    for (int i = 0; i < SHARD_NUM; i++) {
+        std::lock_guard<std::mutex> locker(shards_[i].mtx);
+        shards_[i].lru.clear();
+        shards_[i].index.clear();
+        shards_[i].bytes = 0;
+    }
+}
+
+// 加载文件：不可读的文件只记录 stat，不映射
+std::shared_ptr<const FileEntry> FileCache::Load_(const std::string& path, const struct stat& st,
+                                                  const char* type) {
+    std::shared_ptr<FileEntry> entry = std::make_shared<FileEntry>();
+    entry->st = st;
+    if (!(st.st_mode & S_IROTH)) {
+        return entry;
+    }
+    if (st.st_size > 0) {
+        int srcFd = open(path.c_str(), O_RDONLY);
+        if (srcFd < 0) {
+            return entry;
+        }
+        void* mm = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
+        close(srcFd);
+        if (mm == MAP_FAILED) {
+            return entry;
+        }
+        entry->data = static_cast<char*>(mm);
+        entry->size = st.st_size;
+        entry->mapped = true;
+    }
+
+    entry->type = type;
+    entry->etag = MakeETag(st);
+    FormatHttpDate(st.st_mtime, entry->lastModified);
+    MakeHeaders_(*entry);
+    return entry;
+}
+
+// 获取压缩变体：source 已由 Get 校验过，变体记录的是生成时原文件的状态，不一致时重新生成
+std::shared_ptr<const FileEntry> FileCache::GetEncoded(const std::shared_ptr<const FileEntry>& source,
+                                                       const std::string& path, FILE_ENCODING encoding) {
+    if (!source || source->headers.empty() || source->size == 0 || !source->encoding.empty()) {
+        return nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> locker(source->variantMtx);
+        const std::shared_ptr<const FileEntry>& entry = source->variants[encoding];
+        if (entry && SameFile_(entry->st, source->st)) {
+            return entry->headers.empty() ? nullptr : entry;
+        }
+    }
+    // 生成变体（锁外）；压缩无收益时也挂一个没有响应头的空条目，避免每次重试压缩
+    std::shared_ptr<const FileEntry> entry = LoadEncoded_(path, *source, encoding);
+    size_t added = entry->size;
+    {
+        std::lock_guard<std::mutex> locker(source->variantMtx);
+        std::shared_ptr<const FileEntry>& slot = source->variants[encoding];
+        if (slot) {
+            added = 0;      // 其他线程同时生成了一份，保留先挂上的
+            entry = slot;
+        } else {
+            slot = entry;
+        }
+    }
+    if (added > 0) {
+        Account_(path, source.get(), added);
+    }
+    return entry->headers.empty() ? nullptr : entry;
+}
+
+// 变体的字节数计入原文件所在的节点，参与 LRU 淘汰；原文件已不在缓存中时变体随最后一个引用释放
+void FileCache::Account_(const std::string& path, const FileEntry* source, size_t bytes) {
+    Shard& shard = ShardOf_(path);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.index.find(path);
+    if (it != shard.index.end() && it->second->entry.get() == source) {
+        it->second->bytes += bytes;
+        shard.bytes += bytes;
+        Evict_(shard, maxBytes_ / SHARD_NUM);
+    }
+}
+
+const char* FileCache::EncodingName(FILE_ENCODING encoding) {
+    return encoding == FILE_ENCODING_BR ? "br" : "gzip";
+}
+
+// 生成压缩变体：预压缩的兄弟文件不旧于原文件时直接映射，否则现场压缩
+std::shared_ptr<const FileEntry> FileCache::LoadEncoded_(const std::string& path, const FileEntry& source,
+                                                         FILE_ENCODING encoding) {
+    std::shared_ptr<FileEntry> entry = std::make_shared<FileEntry>();
+    entry->st = source.st;
+    const std::string sibling = path + (encoding == FILE_ENCODING_BR ? ".br" : ".gz");
+    struct stat st;
+    if (stat(sibling.c_str(), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+        st.st_mtime >= source.st.st_mtime) {
+        int fd = open(sibling.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            void* mm = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (mm != MAP_FAILED) {
+                entry->data = static_cast<char*>(mm);
+                entry->size = st.st_size;
+                entry->mapped = true;
+            }
+        }
+    }
+    if (!entry->data) {
+        if (!Compress_(source.data, source.size, encoding, entry->blob) || entry->blob.size() >= source.size) {
+            return entry;   // 压缩失败或没有变小
+        }
+        entry->data = &entry->blob[0];
+        entry->size = entry->blob.size();
+    }
+    entry->type = source.type;
+    entry->encoding = EncodingName(encoding);
+    entry->etag = source.etag.substr(0, source.etag.size() - 1) + "-" + entry->encoding + "\"";
+    entry->lastModified = source.lastModified;
+    MakeHeaders_(*entry);
+    return entry;
+}
+
+// 压缩：gzip 使用 zlib（默认级别），br 使用 brotli（质量 9，只在生成变体时执行一次）
+bool FileCache::Compress_(const char* data, size_t len, FILE_ENCODING encoding, std::string& out) {
+    if (encoding == FILE_ENCODING_BR) {
+        size_t outLen = BrotliEncoderMaxCompressedSize(len);
+        if (outLen == 0) {
+            return false;
+        }
+        out.resize(outLen);
+        if (!BrotliEncoderCompress(9, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, len,
+                                   reinterpret_cast<const uint8_t*>(data), &outLen,
+                                   reinterpret_cast<uint8_t*>(&out[0]))) {
+            return false;
+        }
+        out.resize(outLen);
+        return true;
+    }
+    z_stream zs = {};
+    // windowBits 15 + 16：输出 gzip 格式而不是 zlib 格式
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    out.resize(deflateBound(&zs, len) + 32);
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    zs.avail_in = len;
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = out.size();
+    int ret = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return ret == Z_STREAM_END;
+}
+
+bool FileCache::SameFile_(const struct stat& a, const struct stat& b) {
+    return a.st_ino == b.st_ino && a.st_size == b.st_size &&
+           a.st_mtim.tv_sec == b.st_mtim.tv_sec && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+}
+
+// 预生成实体头
+void FileCache::MakeHeaders_(FileEntry& entry) {
+    entry.headers = "Content-Type: " + entry.type + "\r\n";
+    if (!entry.encoding.empty()) {
+        entry.headers += "Content-Encoding: " + entry.encoding + "\r\n";
+        entry.headers += "Vary: Accept-Encoding\r\n";
+    }
+    entry.headers += "Content-Length: " + std::to_string(entry.size) + "\r\n";
+    entry.headers += "ETag: " + entry.etag + "\r\n";
+    entry.headers += "Last-Modified: " + entry.lastModified + "\r\n";
+}
+
+std::string FileCache::MakeETag(const struct stat& st) {
+    char etag[64];
+    return std::string(etag, MakeETag(st, etag, sizeof(etag)));
+}
+
+size_t FileCache::MakeETag(const struct stat& st, char* out, size_t cap) {
+    int n = snprintf(out, cap, "\"%lx-%lx\"",
+                     static_cast<unsigned long>(st.st_mtime), static_cast<unsigned long>(st.st_size));
+    return n < 0 ? 0 : std::min(static_cast<size_t>(n), cap - 1);
+}
+
+// 生成 RFC 7231 的 HTTP-date
+void FileCache::FormatHttpDate(time_t t, std::string& out) {
+    char buf[64];
+    out.assign(buf, FormatHttpDate(t, buf, sizeof(buf)));
+}
+
+size_t FileCache::FormatHttpDate(time_t t, char* out, size_t cap) {
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    return strftime(out, cap, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+}
+
+FileCache::Shard& FileCache::ShardOf_(const std::string& path) {
+    return shards_[std::hash<std::string>()(path) % SHARD_NUM];
+}
+
+// 插入或替换条目；entry 为空表示删除
+void FileCache::Insert_(Shard& shard, const std::string& path, std::shared_ptr<const FileEntry> entry) {
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.index.find(path);
+    if (it != shard.index.end()) {
+        shard.bytes -= it->second->bytes;
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+    if (entry) {
+        shard.lru.push_front({path, entry, Clock::now(), entry->size});
+        shard.index[path] = shard.lru.begin();
+        shard.bytes += entry->size;
+        Evict_(shard, maxBytes_ / SHARD_NUM);
+    }
+}
+
+// 从 LRU 尾部淘汰，直到本分片映射字节数不超过上限
+void FileCache::Evict_(Shard& shard, size_t maxBytes) {
+    while (shard.bytes > maxBytes && !shard.lru.empty()) {
+        Node& victim = shard.lru.back();
+        shard.bytes -= victim.bytes;
+        shard.index.erase(victim.path);
+        shard.lru.pop_back();
+    }
+}
@@ -0,0 +1,146 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <string>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include <stdio.h>       // snprintf
+#include <time.h>        // gmtime_r, strftime
+#include <fcntl.h>       // open
+#include <unistd.h>      // close
+#include <sys/stat.h>    // stat
+#include <sys/mman.h>    // mmap, munmap
+#include <zlib.h>        // gzip
+#include <brotli/encode.h>  // br
+
+// 压缩变体的编码，FileEntry::variants 的下标
+enum FILE_ENCODING {
+    FILE_ENCODING_BR,
+    FILE_ENCODING_GZIP,
+    FILE_ENCODING_NUM,
+};
+
+/*
+ * FileEntry：缓存中的一个静态文件（或它的一个压缩变体）
+ * 文件内容通过 mmap 只读映射（现场压缩的变体保存在 blob 中），连同预先生成好的响应头一起保存。
+ * 以 shared_ptr 形式交给 HttpResponse 使用：条目被淘汰或失效时，
+ * 正在发送它的连接仍持有引用，最后一个引用释放时才 munmap。
+ * 原文件的压缩变体挂在原文件条目上（variants），原文件变化时整个条目被替换，变体随之失效。
+ */
+struct FileEntry {
+    FileEntry() : data(nullptr), size(0), st({}), mapped(false) {}
+    ~FileEntry() {
+        if (data && mapped) { munmap(data, size); }
+    }
+    FileEntry(const FileEntry&) = delete;
+    FileEntry& operator=(const FileEntry&) = delete;
+
+    char* data;             // 文件内容（size 为 0 或不可读时为 nullptr）
+    size_t size;            // 文件长度
+    struct stat st;         // 加载时的文件状态（压缩变体记录的是原文件的状态）
+    bool mapped;            // data 是否为 mmap 映射（否则指向 blob）
+    std::string blob;       // 现场压缩得到的内容
+    std::string type;       // Content-Type
+    std::string encoding;   // Content-Encoding，原文件为空
+    std::string etag;       // 例如 "5f3a1c2b-c4c"，压缩变体追加 "-gzip" / "-br"
+    std::string lastModified;   // HTTP-date，例如 Sun, 21 Sep 2025 08:00:00 GMT
+    // 预生成的实体头：Content-Type / [Content-Encoding / Vary] / Content-Length / ETag / Last-Modified
+    // （每行以 CRLF 结尾）
+    std::string headers;
+    // 已生成的压缩变体（只在原文件条目上使用，variantMtx 保护）；headers 为空的变体表示压缩无收益
+    mutable std::mutex variantMtx;
+    mutable std::shared_ptr<const FileEntry> variants[FILE_ENCODING_NUM];
+};
+
+/*
+ * FileCache：进程内共享的静态文件缓存（单例）
+ *  - 以完整路径为键，按 LRU 淘汰，总映射字节数不超过 maxBytes
+ *  - 超过 maxFileBytes 的大文件不缓存，由调用方自行处理
+ *  - 命中时在 checkIntervalMS 之内不做任何文件系统调用；超过间隔后 stat 一次，
+ *    mtime/size 变化则重新加载
+ *  - 按路径哈希分片加锁，降低多个 Reactor/worker 线程之间的竞争
+ */
+class FileCache {
+public:
+    static FileCache* Instance();
+
+    // 设置缓存上限（运行中也可调用，例如 SIGHUP 重新加载配置；已缓存的条目会按新上限淘汰）
+    // 实际的单文件上限不超过 maxBytes / SHARD_NUM（见 MaxFileBytes）
+    void Init(size_t maxBytes, size_t maxFileBytes, int checkIntervalMS);
+
+    // 获取文件：
+    //   返回 nullptr              —— 文件不存在或是目录
+    //   返回条目且 headers 为空    —— 文件存在但不可读或映射失败（调用方据 st 判断 403）
+    //   返回条目且 headers 非空    —— 加载成功（空文件的 data 为 nullptr、size 为 0）
+    // type 为文件的 Content-Type，仅在（重新）加载条目时使用
+    // 大文件（超过 maxFileBytes）不会被缓存，此时 *tooLarge 置为 true 并返回 nullptr
+    std::shared_ptr<const FileEntry> Get(const std::string& path, const char* type, bool* tooLarge);
+
+    // 获取 source（Get 刚返回的原文件条目，path 为其路径）的压缩变体：
+    // 优先使用同目录下预压缩的 .br / .gz 文件（不旧于原文件时），否则对原文件压缩一次。
+    // 变体挂在 source 上，命中时只加 source 自己的锁，不再查找缓存、不拼接键；
+    // 原文件 inode/size/mtime 变化后 Get 返回新条目，变体随之重新生成。
+    // 原文件不可读、或压缩后没有变小时返回 nullptr，调用方发送原文件。
+    std::shared_ptr<const FileEntry> GetEncoded(const std::shared_ptr<const FileEntry>& source,
+                                                const std::string& path, FILE_ENCODING encoding);
+
+    static const char* EncodingName(FILE_ENCODING encoding);   // "br" / "gzip"
+
+    // 清空缓存（已被引用的条目在引用释放后才真正解除映射）
+    void Clear();
+
+    size_t MaxFileBytes() const { return maxFileBytes_; }     // 生效的单文件上限
+
+    // 由文件状态生成 ETag（"mtime-size" 的十六进制形式），缓存与未缓存的大文件共用同一规则
+    static std::string MakeETag(const struct stat& st);
+    static size_t MakeETag(const struct stat& st, char* out, size_t cap);  // 写入 out，返回长度
+    // 生成 RFC 7231 的 HTTP-date
+    static void FormatHttpDate(time_t t, std::string& out);
+    static size_t FormatHttpDate(time_t t, char* out, size_t cap);        // 写入 out，返回长度
+
+private:
+    FileCache();
+    ~FileCache() = default;
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Node {
+        std::string path;
+        std::shared_ptr<const FileEntry> entry;
+        Clock::time_point checkedAt;    // 上一次确认文件未变化的时间
+        size_t bytes;                   // entry 与挂在它上面的压缩变体的字节数
+    };
+
+    struct Shard {
+        std::mutex mtx;
+        std::list<Node> lru;            // 头部为最近使用
+        std::unordered_map<std::string, std::list<Node>::iterator> index;
+        size_t bytes = 0;               // 本分片已映射的字节数
+    };
+
+    static std::shared_ptr<const FileEntry> Load_(const std::string& path, const struct stat& st,
+                                                  const char* type);
+    static std::shared_ptr<const FileEntry> LoadEncoded_(const std::string& path, const FileEntry& source,
+                                                         FILE_ENCODING encoding);
+    static bool Compress_(const char* data, size_t len, FILE_ENCODING encoding, std::string& out);
+    void Account_(const std::string& path, const FileEntry* source, size_t bytes);  // 变体计入 source 所在节点
+    static bool SameFile_(const struct stat& a, const struct stat& b);
+    static void MakeHeaders_(FileEntry& entry);
+
+    Shard& ShardOf_(const std::string& path);
+    void Insert_(Shard& shard, const std::string& path, std::shared_ptr<const FileEntry> entry);
+    void Evict_(Shard& shard, size_t maxBytes);
+
+    static const int SHARD_NUM = 8;
+
+    std::atomic<size_t> maxBytes_;      // 所有分片的映射字节上限
+    std::atomic<size_t> maxFileBytes_;  // 单个文件可缓存的最大长度
+    std::atomic<int> checkIntervalMS_;  // 命中后重新校验 mtime 的间隔
+    Shard shards_[SHARD_NUM];
+};
+
+#endif //FILE_CACHE_H
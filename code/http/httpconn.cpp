@@ -2,13 +2,28 @@
 using namespace std;
 
 const char* HttpConn::srcDir;
+const char* HttpConn::metricsPath = nullptr;
 std::atomic<int> HttpConn::userCount;
 bool HttpConn::isET;
+size_t HttpConn::writeBudget = 256 * 1024;
+size_t HttpConn::highWater = 256 * 1024;
+size_t HttpConn::lowWater = 64 * 1024;
+size_t HttpConn::readHighWater = 64 * 1024;
+std::atomic<bool> HttpConn::draining(false);
 
 HttpConn::HttpConn() { 
     fd_ = -1;
+    generation_ = 0;
     addr_ = { 0 };
     isClose_ = true;
+    keepAlive_ = false;
+    readPaused_ = false;
+    verifyState_ = VERIFY_NONE;
+    task_ = 0;
+    taskTicket_ = 0;
+    segHead_ = 0;
+    toWrite_ = 0;
+    reqStart_ = 0;
 };
 
 HttpConn::~HttpConn() { 
@@ -17,25 +32,59 @@ HttpConn::~HttpConn() {
 
 void HttpConn::init(int fd, const sockaddr_in& addr) {
     assert(fd > 0);
+    // 上一个连接可能刚在 worker 线程中关闭：与 Close 中的 release 配对，之后才改写各字段
+    bool closed = isClose_.load(std::memory_order_acquire);
+    assert(closed);
+    (void)closed;
     userCount++;
     addr_ = addr;
     fd_ = fd;
+    generation_.fetch_add(1, std::memory_order_release);
     writeBuff_.RetrieveAll();
     readBuff_.RetrieveAll();
+    request_.Init();
+    segs_.clear();
+    segHead_ = 0;
+    toWrite_ = 0;
+    keepAlive_ = false;
+    readPaused_ = false;
+    verifyState_ = VERIFY_NONE;
     isClose_ = false;
     LOG_INFO("Client[%d](%s:%d) in, userCount:%d", fd_, GetIP(), GetPort(), (int)userCount);
 }
 
 void HttpConn::Close() {
     response_.UnmapFile();
-    if(isClose_ == false){
-        isClose_ = true; 
+    segs_.clear();  // 释放排队中的正文资源
+    segHead_ = 0;
+    toWrite_ = 0;
+    // 连接对象会被同一 fd 的下一个连接复用，缓冲区的内存块先还给块池
+    readBuff_.RetrieveAll();
+    readBuff_.Shrink();
+    writeBuff_.RetrieveAll();
+    writeBuff_.Shrink();
+    request_.Init();    // 关闭未读完的请求体的临时文件
+    if(!isClose_.load(std::memory_order_relaxed)){
         userCount--;
-        close(fd_);
         LOG_INFO("Client[%d](%s:%d) quit, UserCount:%d", fd_, GetIP(), GetPort(), (int)userCount);
+        // close 之后 fd 可能立刻被 accept 到，本对象随之被新连接 init：先发布关闭，之后不再访问成员
+        int fd = fd_;
+        isClose_.store(true, std::memory_order_release);
+        close(fd);
     }
 }
 
+// 已关闭的连接上不应再有读写：fd 可能已经属于别的连接。出现即是调用方的竞争（见 BeginTask），
+// 计数并拒绝，压测工具（bench/stress.sh）以 http_use_after_close_total 为 0 作为通过条件
+bool HttpConn::UsedAfterClose_(const char* op) {
+    if(!IsClosed()) {
+        return false;
+    }
+    Metrics::Count(COUNTER_USE_AFTER_CLOSE);
+    LOG_ERROR("Client[%d] %s after close", fd_, op);
+    return true;
+}
+
 int HttpConn::GetFd() const {
     return fd_;
 };
@@ -52,69 +101,258 @@ int HttpConn::GetPort() const {
     return addr_.sin_port;
 }
 
+// ET 下读到 EAGAIN 为止，但读缓冲区积压到 readHighWater 就停下：请求体由 process 边解析边取走，
+// 上传大文件时读缓冲区不会跟着增长；停下时 socket 里可能还有数据，由 ReadPaused 告诉调用者
 ssize_t HttpConn::read(int* saveErrno) {
+    if (UsedAfterClose_("read")) {
+        *saveErrno = EBADF;
+        return -1;
+    }
+    int64_t start = Metrics::Now();
     ssize_t len = -1;
+    readPaused_ = false;
     do {
         len = readBuff_.ReadFd(fd_, saveErrno);
         if (len <= 0) {
             break;
         }
+        if (isET && readBuff_.ReadableBytes() >= readHighWater) {
+            readPaused_ = true;
+            break;
+        }
     } while (isET); // ET:边沿触发要一次性全部读出
+    Metrics::ObserveSince(HIST_READ, start);
     return len;
 }
 
-// 主要采用writev连续写函数
+// 发送队列：连续的内存段（响应头/映射正文）合并为一次 writev，文件段使用 sendfile
+// 每次调用最多发送 writeBudget 字节，一个慢客户端的大文件不会独占 worker / Reactor 直到 EAGAIN
 ssize_t HttpConn::write(int* saveErrno) {
+    if(UsedAfterClose_("write")) {
+        *saveErrno = EBADF;
+        return -1;
+    }
+    int64_t start = Metrics::Now();
     ssize_t len = -1;
+    size_t budget = writeBudget;
     do {
-        len = writev(fd_, iov_, iovCnt_);   // 将iov的内容写到fd中
+        if(toWrite_ == 0) { break; } /* 传输结束 */
+        const WriteSeg& head = segs_[segHead_];
+        if(head.kind == WriteSeg::FILE) {
+            off_t offset = head.offset;
+            len = sendfile(fd_, head.fd, &offset, std::min(head.len, budget));
+        } else {
+            struct iovec iov[MAX_IOV];
+            int iovCnt = 0;
+            size_t buffOff = 0;     // 本次已经放入 iov 的 writeBuff_ 字节数
+            size_t total = 0;       // 本次 writev 的字节数，不超过剩余预算
+            for(size_t i = segHead_; i < segs_.size() && iovCnt < MAX_IOV && total < budget; i++) {
+                const WriteSeg& seg = segs_[i];
+                if(seg.kind == WriteSeg::FILE) { break; }
+                if(seg.kind == WriteSeg::BUFF) {
+                    iov[iovCnt].iov_base = const_cast<char*>(writeBuff_.Peek()) + buffOff;
+                    buffOff += seg.len;
+                } else {
+                    iov[iovCnt].iov_base = const_cast<char*>(seg.base);
+                }
+                iov[iovCnt].iov_len = std::min(seg.len, budget - total);
+                total += iov[iovCnt].iov_len;
+                iovCnt++;
+            }
+            len = writev(fd_, iov, iovCnt);   // 将iov的内容写到fd中
+        }
         if(len <= 0) {
             *saveErrno = errno;
             break;
         }
-        if(iov_[0].iov_len + iov_[1].iov_len  == 0) { break; } /* 传输结束 */
-        else if(static_cast<size_t>(len) > iov_[0].iov_len) {
-            iov_[1].iov_base = (uint8_t*) iov_[1].iov_base + (len - iov_[0].iov_len);
-            iov_[1].iov_len -= (len - iov_[0].iov_len);
-            if(iov_[0].iov_len) {
-                writeBuff_.RetrieveAll();
-                iov_[0].iov_len = 0;
-            }
+        ConsumeSegs_(len);
+        budget -= len;
+    } while(budget > 0 && (isET || ToWriteBytes() > 10240));
+    Metrics::ObserveSince(HIST_WRITE, start);
+    return len;
+}
+
+void HttpConn::AppendSeg_(const WriteSeg& seg) {
+    if(seg.len == 0) { return; }
+    segs_.push_back(seg);
+    toWrite_ += seg.len;
+}
+
+// 已发送 len 字节：依次推进各段，BUFF 段同步回收 writeBuff_
+void HttpConn::ConsumeSegs_(size_t len) {
+    assert(len <= toWrite_);
+    toWrite_ -= len;
+    size_t sent[3] = {0, 0, 0};     // 按段类型统计发送字节数
+    while(len > 0) {
+        WriteSeg& seg = segs_[segHead_];
+        size_t n = std::min(len, seg.len);
+        sent[seg.kind] += n;
+        if(seg.kind == WriteSeg::BUFF) {
+            writeBuff_.Retrieve(n);
+        } else if(seg.kind == WriteSeg::MEM) {
+            seg.base += n;
+        } else {
+            seg.offset += n;
         }
-        else {
-            iov_[0].iov_base = (uint8_t*)iov_[0].iov_base + len; 
-            iov_[0].iov_len -= len; 
-            writeBuff_.Retrieve(len);
+        seg.len -= n;
+        len -= n;
+        if(seg.len == 0) {
+            seg.body.reset();
+            segHead_++;
         }
-    } while(isET || ToWriteBytes() > 10240);
-    return len;
+    }
+    if(sent[WriteSeg::BUFF]) { Metrics::Count(COUNTER_SENT_BUFF, sent[WriteSeg::BUFF]); }
+    if(sent[WriteSeg::MEM]) { Metrics::Count(COUNTER_SENT_MMAP, sent[WriteSeg::MEM]); }
+    if(sent[WriteSeg::FILE]) { Metrics::Count(COUNTER_SENT_SENDFILE, sent[WriteSeg::FILE]); }
+    if(segHead_ == segs_.size()) {
+        segs_.clear();
+        segHead_ = 0;
+        writeBuff_.Shrink();    // 全部发送完，写缓冲区的块还给块池
+    } else if(segHead_ >= MAX_IOV && segHead_ * 2 >= segs_.size()) {
+        // 流水线持续写入时队列可能一直排不空，定期丢弃已发送的段
+        segs_.erase(segs_.begin(), segs_.begin() + segHead_);
+        segHead_ = 0;
+    }
 }
 
+// 依次处理读缓冲区中所有完整的请求，响应按顺序追加到发送队列，由 write 合并发送
+// 遇到需要查数据库的登录/注册时停下，之后的请求等校验完成再处理
 bool HttpConn::process() {
-    request_.Init();
-    if(readBuff_.ReadableBytes() <= 0) {
+    if(UsedAfterClose_("process")) {
         return false;
     }
-    else if(request_.parse(readBuff_)) {    // 解析成功
-        LOG_DEBUG("%s", request_.path().c_str());
-        response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 200);
-    } else {
-        response_.Init(srcDir, request_.path(), false, 400);
+    if(verifyState_ != VERIFY_NONE) {
+        return toWrite_ > 0;        // 之前的响应仍可以继续发送
     }
+    int handled = 0;
+    // 发送队列达到高水位就停下，剩余请求等队列降到低水位以下再处理（见 CanProcess）
+    while(readBuff_.ReadableBytes() > 0 && handled < MAX_PIPELINE && toWrite_ < highWater) {
+        if(handled > 0 && !keepAlive_) {
+            readBuff_.RetrieveAll();    // 前一个请求要求关闭连接，之后的数据不再处理
+            break;
+        }
+        int64_t start = Metrics::Now();
+        if(!request_.InProgress()) {
+            reqStart_ = start;          // 新请求的第一段数据
+        }
+        HttpRequest::PARSE_RESULT ret = request_.parse(readBuff_);
+        Metrics::ObserveSince(HIST_PARSE, start);
+        if(ret == HttpRequest::PARSE_AGAIN) {   // 请求不完整，保留解析状态继续读
+            if(request_.TakeContinue()) {
+                // 客户端等待 100 Continue 后才发送请求体
+                static const char CONTINUE[] = "HTTP/1.1 100 Continue\r\n\r\n";
+                writeBuff_.Append(CONTINUE, sizeof(CONTINUE) - 1);
+                AppendSeg_({WriteSeg::BUFF, nullptr, -1, 0, sizeof(CONTINUE) - 1});
+                keepAlive_ = true;  // 发完 100 Continue 不能关闭连接，是否保持由请求完成后的响应决定
+            }
+            break;
+        }
+        handled++;
+        if(ret == HttpRequest::PARSE_OK) {    // 解析成功
+            LOG_DEBUG("%s", request_.path().c_str());
+            // 排空时回复 Connection: close，客户端收到后换到新进程的连接上
+            keepAlive_ = request_.IsKeepAlive() && !draining.load(std::memory_order_relaxed);
+            bool isLogin = false;
+            if(request_.NeedsVerify(&isLogin)) {
+                UserVerifier::RESULT result;
+                if(!UserVerifier::Instance()->TryCache(request_.GetPost("username"),
+                                                       request_.GetPost("password"), isLogin, &result)) {
+                    verifyState_ = VERIFY_READY;
+                    break;
+                }
+                request_.SetVerified(result == UserVerifier::VERIFY_OK);
+            }
+            MakeResponse_();
+        } else {
+            keepAlive_ = false;
+            response_.Init(srcDir, request_.path(), false, request_.ErrorCode());
+            QueueResponse_();
+        }
+    }
+    readBuff_.Shrink();     // 请求都已消费完时归还读缓冲区的块，空闲的 keep-alive 连接不占缓冲区
+    return toWrite_ > 0;
+}
 
-    response_.MakeResponse(writeBuff_); // 生成响应报文放入writeBuff_中
-    // 响应头
-    iov_[0].iov_base = const_cast<char*>(writeBuff_.Peek()); 
-    iov_[0].iov_len = writeBuff_.ReadableBytes();
-    iovCnt_ = 1;
-
-    // 文件
-    if(response_.FileLen() > 0  && response_.File()) {
-        iov_[1].iov_base = response_.File();
-        iov_[1].iov_len = response_.FileLen();
-        iovCnt_ = 2;
+void HttpConn::MakeResponse_() {
+    response_.Init(srcDir, request_.path(), keepAlive_, 200);
+    if(metricsPath && request_.path() == metricsPath) {
+        std::string body;
+        Metrics::Instance()->Render(&body);
+        response_.SetContent("text/plain; version=0.0.4; charset=utf-8", std::move(body));
+    } else if(request_.method() == "GET") {
+        response_.SetRange(request_.Header(HttpRequest::HEADER_RANGE));
+        response_.SetConditional(request_.Header(HttpRequest::HEADER_IF_NONE_MATCH),
+                                 request_.Header(HttpRequest::HEADER_IF_MODIFIED_SINCE));
+        response_.SetAcceptEncoding(request_.Header(HttpRequest::HEADER_ACCEPT_ENCODING));
     }
-    LOG_DEBUG("filesize:%d, %d  to %d", response_.FileLen() , iovCnt_, ToWriteBytes());
+    QueueResponse_();
+}
+
+// 之前的响应都发送完后才提交校验，等待结果期间连接上没有待发送的数据
+bool HttpConn::TakeVerify(std::string* name, std::string* pwd, bool* isLogin) {
+    if(verifyState_ != VERIFY_READY || toWrite_ > 0) {
+        return false;
+    }
+    request_.NeedsVerify(isLogin);
+    *name = request_.GetPost("username");
+    *pwd = request_.GetPost("password");
+    verifyState_ = VERIFY_SUBMITTED;
     return true;
 }
 
+void HttpConn::FinishVerify(UserVerifier::RESULT result) {
+    assert(verifyState_ != VERIFY_NONE);
+    verifyState_ = VERIFY_NONE;
+    request_.SetVerified(result == UserVerifier::VERIFY_OK);
+    if(result == UserVerifier::VERIFY_BUSY) {
+        response_.Init(srcDir, request_.path(), keepAlive_, 503);
+        QueueResponse_();
+    } else {
+        MakeResponse_();
+    }
+}
+
+void HttpConn::QueueResponse_() {
+    int64_t start = Metrics::Now();
+    size_t pending = toWrite_;
+    size_t headLen = writeBuff_.ReadableBytes();
+    response_.MakeResponse(writeBuff_); // 生成响应报文追加到writeBuff_中
+    char* file = response_.File();
+    int fileFd = response_.FileFd();
+    std::shared_ptr<const void> body = response_.ReleaseBody();
+
+    // 按分段把响应头/分段头（writeBuff_）与文件内容交替放入发送队列
+    // 小文件走内存映射，大文件走 sendfile
+    size_t queued = 0;  // 已放入发送队列的本响应 writeBuff_ 字节数
+    for(const BodyPart& part : response_.Parts()) {
+        AppendSeg_({WriteSeg::BUFF, nullptr, -1, 0, part.buffPos - queued});
+        queued = part.buffPos;
+        if(file) {
+            AppendSeg_({WriteSeg::MEM, file + part.offset, -1, 0, part.len, body});
+        } else if(fileFd >= 0) {
+            AppendSeg_({WriteSeg::FILE, nullptr, fileFd, static_cast<off_t>(part.offset), part.len, body});
+        }
+    }
+    AppendSeg_({WriteSeg::BUFF, nullptr, -1, 0, writeBuff_.ReadableBytes() - headLen - queued});
+    LOG_DEBUG("filesize:%d, %d  to %d", response_.FileLen() , segs_.size(), ToWriteBytes());
+    Metrics::ObserveSince(HIST_RESPONSE, start);
+    Metrics::Count(COUNTER_REQUESTS);
+    if(AccessLog::Instance()->IsOpen()) {
+        LogAccess_(toWrite_ - pending);
+    }
+}
+
+void HttpConn::LogAccess_(size_t bytes) {
+    int64_t now = Metrics::Now();
+    AccessRecord rec = {};
+    rec.method = AccessLog::MethodCode(request_.method().data(), request_.method().size());
+    rec.status = static_cast<uint16_t>(response_.Code());
+    rec.peerPort = ntohs(addr_.sin_port);
+    rec.flags = keepAlive_ ? ACCESS_FLAG_KEEP_ALIVE : 0;
+    rec.peerAddr = addr_.sin_addr.s_addr;
+    rec.fd = fd_;
+    rec.bytes = bytes;
+    rec.bodyBytes = request_.BodyLen();
+    rec.latencyUs = static_cast<uint32_t>(std::max<int64_t>(now - reqStart_, 0) / 1000);
+    AccessLog::Instance()->Append(rec, now, request_.Target(), request_.TargetLen());
+}
@@ -3,14 +3,37 @@
 
 #include <sys/types.h>
 #include <sys/uio.h>     // readv/writev
+#include <sys/sendfile.h> // sendfile
+#include <vector>
 #include <arpa/inet.h>   // sockaddr_in
 #include <stdlib.h>      // atoi()
 #include <errno.h>      // errno
 
 #include "../log/log.h"
+#include "../log/accesslog.h"
 #include "../buffer/buffer.h"
 #include "httprequest.h"
 #include "httpresponse.h"
+#include "../pool/userverifier.h"
+#include "../metrics/metrics.h"
+/*
+待发送数据中的一段，按顺序排在 HttpConn 的发送队列里：
+  BUFF : 位于 writeBuff_ 中的响应头，按顺序从 writeBuff_.Peek() 开始消费
+  MEM  : 内存中的正文（FileCache 或本次请求的 mmap 映射）
+  FILE : 大文件正文，直接用 sendfile 从文件 fd 的 offset 处发送（零拷贝，不映射）
+连续的 BUFF/MEM 段合并为一次 writev 发送。
+流水线上的多个响应依次排在同一个队列里，MEM/FILE 段通过 body 持有各自响应的正文资源。
+*/
+struct WriteSeg {
+    enum KIND { BUFF, MEM, FILE };
+    KIND kind;
+    const char* base;   // MEM：下一个待发送字节
+    int fd;             // FILE：文件描述符（由 body 持有）
+    off_t offset;       // FILE：下一次 sendfile 的文件偏移，EAGAIN 后从这里继续
+    size_t len;         // 剩余待发送长度
+    std::shared_ptr<const void> body;   // MEM/FILE：正文资源（FileEntry 或 ResponseBody），段发送完即释放
+};
+
 /*
 进行读写数据并调用httprequest 来解析数据以及httpresponse来生成响应
 */
@@ -21,36 +44,128 @@ public:
     
     void init(int sockFd, const sockaddr_in& addr);
     ssize_t read(int* saveErrno);// 读取数据
-    ssize_t write(int* saveErrno);// 写数据
+    // 写发送队列，单次调用最多写 writeBudget 字节；返回值 > 0 且 ToWriteBytes() > 0 表示预算用完，
+    // socket 可能仍可写（ET 下不会再有 EPOLLOUT 边沿），调用者应让出后尽快再调用
+    ssize_t write(int* saveErrno);
     void Close();
     int GetFd() const;// 获取文件描述符
+    bool IsClosed() const { return isClose_.load(std::memory_order_acquire); }   // Reactor 线程会读取 worker 关闭的连接
+    uint32_t GetGeneration() const { return generation_.load(std::memory_order_acquire); }  // 代数：每次 init 加一，用于识别 fd 复用后的新连接
     int GetPort() const;// 获取端口号
     const char* GetIP() const;// 获取IP地址
     sockaddr_in GetAddr() const;// 获取地址结构体
-    bool process();// 处理HTTP请求
+    bool process();// 处理读缓冲区中所有完整的HTTP请求，有响应待发送时返回 true
 
     // 写的总长度
-    int ToWriteBytes() { 
-        return iov_[0].iov_len + iov_[1].iov_len; 
+    size_t ToWriteBytes() const { 
+        return toWrite_; 
     }
 
+    // 最后处理的请求是否保持连接（遇到 Connection: close 或错误请求后不再处理后续请求）
     bool IsKeepAlive() const {
-        return request_.IsKeepAlive();
+        return keepAlive_;
+    }
+
+    // 读缓冲区中是否还有未处理的数据（发送队列排空后应再调用一次 process）
+    bool HasPendingInput() const {
+        return readBuff_.ReadableBytes() > 0;
+    }
+
+    // 上一次 read 因读缓冲区达到 readHighWater 而停下，socket 中可能还有数据（ET 下不会再有新的边沿），
+    // 调用者应在 process 取走数据后再 read
+    bool ReadPaused() const {
+        return readPaused_;
+    }
+
+    // 发送队列降到低水位以下，且还有待处理的流水线请求、待提交的校验或暂停的读：应再调用一次 process
+    bool CanProcess() const {
+        return (HasPendingInput() || IsVerifying() || readPaused_) && toWrite_ <= lowWater;
+    }
+
+    // 连接空闲：没有待发送的响应、待校验的请求，读缓冲区中没有未处理的数据，也没有解析到一半的请求
+    // （排空时可以直接关闭而不丢失请求）
+    bool IsIdle() const {
+        return toWrite_ == 0 && !IsVerifying() && !readPaused_ && !HasPendingInput() && !request_.InProgress();
     }
 
+    // 登录/注册的异步校验：process 遇到缓存未命中的校验请求时停下，等发送队列排空后由
+    // TakeVerify 取出用户名密码交给 UserVerifier，结果回到所属线程后调用 FinishVerify 生成响应，
+    // 再继续 process 之后的请求（流水线上的响应顺序不变）
+    bool TakeVerify(std::string* name, std::string* pwd, bool* isLogin);
+    void FinishVerify(UserVerifier::RESULT result);
+    // 是否有已解析、尚未得到结果的校验请求（此期间不再处理该连接上的后续请求）
+    bool IsVerifying() const {
+        return verifyState_ != VERIFY_NONE;
+    }
+
+    // 经典模式下连接交给 worker 处理的标记：Reactor 线程提交任务前 BeginTask 取一个票号，
+    // worker 把连接交还（重新注册事件、关闭或等待校验结果）、从任务中返回后 EndTask。
+    // 标记期间 Reactor 线程不能关闭连接（超时、排空），只能推迟到交还之后。
+    // 票号不随 init 重置：旧任务晚到的 EndTask 不会清掉同一对象上新任务（或新连接）的标记
+    uint32_t BeginTask() {
+        uint32_t ticket = ++taskTicket_;
+        if (ticket == 0) {
+            ticket = ++taskTicket_;
+        }
+        task_.store(ticket, std::memory_order_release);
+        return ticket;
+    }
+    void EndTask(uint32_t ticket) {
+        task_.compare_exchange_strong(ticket, 0, std::memory_order_acq_rel);
+    }
+    bool InTask() const {
+        return task_.load(std::memory_order_acquire) != 0;
+    }
+
+    static const int MAX_PIPELINE = 64;   // 一次 process 最多处理的请求数，其余留到当前响应发完后
+    static const int MAX_IOV = 64;        // 一次 writev 最多合并的段数
+
+    // 发送的公平性：慢客户端下载大文件时，每次 write 最多写 writeBudget 字节就让出线程；
+    // 发送队列达到 highWater 时 process 不再生成新的响应，降到 lowWater 以下才继续
+    static size_t writeBudget;
+    static size_t highWater;
+    static size_t lowWater;
+    // 读缓冲区积压到该字节数时 read 暂停（上传的请求体边读边交给 HttpRequest，内存有上限）
+    static size_t readHighWater;
+
+    // 进程正在退出或热重启（WebServer 设置）：之后完成的请求一律回复 Connection: close
+    static std::atomic<bool> draining;
+
     static bool isET;
     static const char* srcDir;
+    static const char* metricsPath;     // 请求该路径时返回 Metrics 的输出（不查找文件），nullptr 表示不提供
     static std::atomic<int> userCount;  // 原子，支持锁
     
 private:
    
     int fd_;
+    std::atomic<uint32_t> generation_;     // worker 线程会读取，reactor 线程在 init 时修改
     struct  sockaddr_in addr_;
 
-    bool isClose_;
+    std::atomic<bool> isClose_;     // Close 中以 release 写入，之后对象可能被新连接 init（见 init）
+    bool keepAlive_;
+    bool readPaused_;
+
+    enum VERIFY_STATE {
+        VERIFY_NONE,        // 没有待校验的请求
+        VERIFY_READY,       // 已解析，等待发送队列排空后提交
+        VERIFY_SUBMITTED,   // 已提交，等待结果
+    };
+    VERIFY_STATE verifyState_;
+    std::atomic<uint32_t> task_;    // 正在处理该连接的任务的票号，0 表示没有（见 BeginTask）
+    uint32_t taskTicket_;           // 只在 Reactor 线程修改
+    void MakeResponse_();            // 根据 request_ 生成响应并放入发送队列
     
-    int iovCnt_;
-    struct iovec iov_[2];
+    void AppendSeg_(const WriteSeg& seg);
+    void ConsumeSegs_(size_t len);   // 已发送 len 字节，推进发送队列
+    void QueueResponse_();           // 把 response_ 刚生成的响应放入发送队列
+    void LogAccess_(size_t bytes);   // 写一条二进制访问日志（AccessLog 打开时）
+    bool UsedAfterClose_(const char* op);   // 连接已关闭时计数、记录错误并返回 true
+
+    std::vector<WriteSeg> segs_;    // 发送队列（segHead_ 之前的段已发送完）
+    size_t segHead_;
+    size_t toWrite_;                // 发送队列中剩余的总字节数
+    int64_t reqStart_;              // 当前请求开始解析的时间（Metrics::Now），用于访问日志的耗时
     
     Buffer readBuff_; // 读缓冲区
     Buffer writeBuff_; // 写缓冲区
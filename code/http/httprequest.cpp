@@ -1,166 +1,454 @@
 #include "httprequest.h"
-// 初始化
+#include <strings.h>    // strncasecmp
+#include <fcntl.h>      // open, O_TMPFILE
+#include <unistd.h>     // write, unlink
+#include <stdlib.h>     // mkostemp
+#include <algorithm>
+
+size_t HttpRequest::maxBodySize = 8 * 1024 * 1024;
+size_t HttpRequest::bodyMemLimit = 64 * 1024;
+const char* HttpRequest::bodyTmpDir = "/tmp";
+
+// 写满 len 字节（普通文件上只有 EINTR 或出错才会写不全）
+static bool WriteAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) { continue; }
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+HttpRequest::HttpRequest() {
+    bodyFd_ = -1;
+    arena_.reserve(ARENA_RESERVE);
+    fields_.reserve(16);
+    Init();
+}
+
+HttpRequest::~HttpRequest() {
+    CloseBody_();
+}
+// 初始化：只清空内容，容量留给下一个请求
 void HttpRequest::Init() {
-    method_ = ""; 
-    path_ = ""; 
-    version_ = "";
-    body_ = "";
+    method_.clear();
+    path_.clear();
+    version_.clear();
+    target_ = 0;
+    targetLen_ = 0;
     state_ = REQUEST_LINE; 
-    header_.clear();
-    post_.clear();
+    checked_ = 0;
+    contentLen_ = 0;
+    bodyLen_ = 0;
+    CloseBody_();
+    errorCode_ = 400;
+    failed_ = false;
+    continuePending_ = false;
+    if (arena_.capacity() > ARENA_KEEP) {
+        std::string().swap(arena_);    // 偶尔的大请求不让连接一直占着大块内存
+        arena_.reserve(ARENA_RESERVE);
+    } else {
+        arena_.clear();
+    }
+    if (body_.capacity() > ARENA_KEEP) {
+        std::string().swap(body_);
+    } else {
+        body_.clear();
+    }
+    fields_.clear();
+    posts_.clear();
+    for (int& k : known_) { k = -1; }
+    verifyPending_ = false;
+    verifyLogin_ = false;
 }
 // 解析处理
-bool HttpRequest::parse(Buffer& buff) {
-    const char CRLF[] = "\r\n";
-    if (buff.ReadableBytes() <= 0) {
-        return false;
+HttpRequest::PARSE_RESULT HttpRequest::parse(Buffer& buff) {
+    if (state_ == FINISH) {
+        Init(); // 上一个请求已完成，开始解析下一个请求
     }
 
     // 解析循环：根据当前状态，逐步解析请求行、头部、请求体
-    while (buff.ReadableBytes() > 0&& state_ != FINISH) {
-        // 获取一行数据（以 CRLF 结尾）
-        const char* line_end = std::search(buff.Peek(), buff.BeginWriteConst(), CRLF, CRLF + 2);
-        if (line_end == buff.BeginWrite()) {
-            // 没有找到完整的一行，等待更多数据
-            break;
-        }
-        std::string line(buff.Peek(), line_end);
-        buff.RetrieveUntil(line_end + 2); // 移动读指针，跳过 CRLF
-        if(state_ == REQUEST_LINE) {
-            // 解析请求行
-            if (!ParseRequestLine_(line)) {
-                return false; // 请求行格式错误
+    while (state_ != FINISH) {
+        if (state_ == BODY || state_ == CHUNK_DATA) {
+            // 请求体（或当前分块）：取走已到达的部分，不等整个请求体进入读缓冲区
+            size_t n = std::min(buff.ReadableBytes(), contentLen_);
+            if (n > 0 && !AppendBody_(buff.Peek(), n)) {
+                failed_ = true;
+                state_ = FINISH;
+                return PARSE_ERROR;
+            }
+            buff.Retrieve(n);
+            contentLen_ -= n;
+            if (contentLen_ > 0) {
+                return PARSE_AGAIN;
             }
-            state_ = HEADERS; // 切换到解析头部状态
-        } else if (state_ == HEADERS) {
-            // 解析请求头
-            if (line.empty()) {
-                // 空行表示头部结束
-                if (header_.count("Content-Length")) {
-                    state_ = BODY; // 有请求体，切换到解析体状态
-                } else {
-                    state_ = FINISH; // 无请求体，解析完成
-                }
+            if (state_ == BODY) {
+                FinishBody_();
+                state_ = FINISH;
             } else {
-                ParseHeader_(line); // 解析单条头部
+                state_ = CHUNK_END;
+            }
+            continue;
+        }
+
+        // 获取一行数据：从上次扫描结束处用 memchr 找 '\n'
+        const char* begin = buff.Peek();
+        size_t readable = buff.ReadableBytes();
+        const char* lf = static_cast<const char*>(
+            memchr(begin + checked_, '\n', readable - checked_));
+        if (lf == nullptr) {
+            // 没有找到完整的一行，记录已扫描长度，等待更多数据
+            checked_ = readable;
+            if (checked_ > MAX_LINE_LEN) {
+                LOG_WARN("Request line too long!");
+                failed_ = true;
+                state_ = FINISH;
+                return PARSE_ERROR;
             }
-        } else if (state_ == BODY) {
-            // 解析请求体
-            ParseBody_(line);
-            state_ = FINISH; // 解析完成
+            return PARSE_AGAIN;
+        }
+        size_t len = lf - begin;
+        if (len > MAX_LINE_LEN) {
+            // 一次读到的完整长行同样拒绝，不拷进 arena_
+            LOG_WARN("Request line too long!");
+            failed_ = true;
+            state_ = FINISH;
+            return PARSE_ERROR;
+        }
+        if (len > 0 && begin[len - 1] == '\r') {
+            len--; // 去掉 CR
+        }
+
+        bool ok = true;
+        switch (state_) {
+        case REQUEST_LINE:
+            // 请求行之前的空行直接忽略（RFC 7230 3.5）
+            if (len > 0) {
+                ok = ParseRequestLine_(begin, len);
+                state_ = HEADERS; // 切换到解析头部状态
+            }
+            break;
+        case HEADERS:
+            // 空行表示头部结束：根据 Content-Length / Transfer-Encoding 决定是否读取请求体
+            ok = len == 0 ? HeadersDone_() : ParseHeader_(begin, len); // 解析单条头部
+            break;
+        case CHUNK_SIZE:
+            ok = ParseChunkSize_(begin, len);
+            break;
+        case CHUNK_END:
+            ok = len == 0;  // 分块数据之后必须紧跟 CRLF
+            state_ = CHUNK_SIZE;
+            break;
+        case CHUNK_TRAILER:
+            // trailer 中的头部直接忽略，空行表示请求结束
+            if (len == 0) {
+                FinishBody_();
+                state_ = FINISH;
+            }
+            break;
+        default:
+            break;
+        }
+        buff.RetrieveUntil(lf + 1); // 移动读指针，跳过 CRLF
+        checked_ = 0;
+        if (!ok) {
+            failed_ = true;    // 出错的请求不保持连接
+            state_ = FINISH;
+            return PARSE_ERROR;
         }
     }
     LOG_DEBUG("[%s], [%s], [%s]", method_.c_str(), path_.c_str(), version_.c_str());
-    return true;
+    return PARSE_OK;
 }
 // 解析路径
 void HttpRequest::ParsePath_() {
     if (path_ == "/") {
         path_ = "/index.html"; // 默认首页
     } else {
-        // 查找是否有默认页面映射
-        size_t last_slash = path_.find_last_of('/');
-        std::string last_part = path_.substr(last_slash);
-        if (DEFAULT_HTML.count(last_part)) {
-            path_ = path_ + ".html"; // 映射为 .html 页面
+        // 查找是否有默认页面映射（直接比较最后一段，不构造子串）
+        size_t lastSlash = path_.find_last_of('/');
+        if (lastSlash == std::string::npos) {
+            return;
+        }
+        const char* last = path_.c_str() + lastSlash;
+        size_t lastLen = path_.size() - lastSlash;
+        for (const char* const* page = DEFAULT_HTML; *page; ++page) {
+            if (strlen(*page) == lastLen && memcmp(*page, last, lastLen) == 0) {
+                path_.append(".html"); // 映射为 .html 页面
+                break;
+            }
         }
     }
 }
-// 处理请求行
-bool HttpRequest::ParseRequestLine_(const std::string& line){
-    regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-    smatch subMatch;
-    // 正则匹配请求行
-    if (regex_match(line, subMatch, patten)) {
-        method_ = subMatch[1];
-        path_ = subMatch[2];
-        version_ = subMatch[3];
-        // 仅支持 GET 和 POST 方法
-        if (method_ == "GET" || method_ == "POST") {
-            ParsePath_(); // 处理路径映射
-            return true;
-        }
+// 处理请求行：METHOD SP PATH SP HTTP/VERSION
+bool HttpRequest::ParseRequestLine_(const char* begin, size_t len) {
+    const char* end = begin + len;
+    const char* sp1 = static_cast<const char*>(memchr(begin, ' ', len));
+    if (sp1 == nullptr) {
+        return false;
+    }
+    const char* uri = sp1 + 1;
+    const char* sp2 = static_cast<const char*>(memchr(uri, ' ', end - uri));
+    if (sp2 == nullptr) {
+        return false;
+    }
+    const char* ver = sp2 + 1;
+    if (end - ver < 5 || memcmp(ver, "HTTP/", 5) != 0 ||
+        memchr(ver, ' ', end - ver) != nullptr) {
+        return false;
+    }
+    method_.assign(begin, sp1 - begin);
+    targetLen_ = sp2 - uri;
+    target_ = AppendStr_(uri, targetLen_);     // ParsePath_ / SetVerified 会改写 path_，这里保留原样
+    path_.assign(uri, sp2 - uri);
+    version_.assign(ver + 5, end - ver - 5);
+    // 仅支持 GET 和 POST 方法
+    if (method_ == "GET" || method_ == "POST") {
+        ParsePath_(); // 处理路径映射
+        return true;
     }
     return false;
 }
-// 处理请求头
-void HttpRequest::ParseHeader_(const std::string& line) {
-    regex patten("^([^:]*): ?(.*)$");
-    smatch subMatch;
-    if (regex_match(line, subMatch, patten)) {
-        std::string key = subMatch[1];
-        std::string value = subMatch[2];
-        header_[key] = value; // 存储头部键值对
+// 处理请求头：Key: value（去掉 value 两侧的空白）
+bool HttpRequest::ParseHeader_(const char* begin, size_t len) {
+    const char* colon = static_cast<const char*>(memchr(begin, ':', len));
+    if (colon == nullptr) {
+        return true; // 不合法的头部行直接忽略
+    }
+    const char* value = colon + 1;
+    const char* end = begin + len;
+    while (value < end && (*value == ' ' || *value == '\t')) { ++value; }
+    while (end > value && (end[-1] == ' ' || end[-1] == '\t')) { --end; }
+
+    if (fields_.size() >= MAX_HEADERS) {
+        LOG_WARN("Too many request headers!");
+        return false;
     }
+
+    int known = KnownHeader_(begin, colon - begin);
+    if (known == HEADER_CONTENT_LENGTH) {
+        // 只接受十进制数字；重复的 Content-Length 必须相同，否则可能是请求走私（RFC 7230 3.3.2）
+        size_t n = 0;
+        if (!ParseContentLength_(value, end - value, &n) ||
+            (known_[HEADER_CONTENT_LENGTH] >= 0 && n != contentLen_)) {
+            return false;
+        }
+        contentLen_ = n;
+    }
+
+    // 存储头部键值对：名字与值拷进 arena_，常用头部登记到 known_
+    Field field;
+    field.nameLen = colon - begin;
+    field.name = AppendStr_(begin, field.nameLen);
+    field.valueLen = end - value;
+    field.value = AppendStr_(value, field.valueLen);
+    if (known >= 0) {
+        known_[known] = static_cast<int>(fields_.size());
+    }
+    fields_.push_back(field);
+    return true;
 }
-// 处理请求体
-void HttpRequest::ParseBody_(const std::string& line) {
-    body_ = line;
-    ParsePost_(); // 解析 POST 请求
+// Content-Length：1 个以上十进制数字，不接受符号、空白，超出 size_t 视为非法
+bool HttpRequest::ParseContentLength_(const char* begin, size_t len, size_t* n) {
+    if (len == 0) {
+        return false;
+    }
+    size_t v = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (begin[i] < '0' || begin[i] > '9') {
+            return false;
+        }
+        size_t d = begin[i] - '0';
+        if (v > (SIZE_MAX - d) / 10) {
+            return false;
+        }
+        v = v * 10 + d;
+    }
+    *n = v;
+    return true;
+}
+// 预登记的头部按长度分派，再做一次不区分大小写的比较
+int HttpRequest::KnownHeader_(const char* name, size_t len) {
+    int h = -1;
+    const char* expect = nullptr;
+    switch (len) {
+        case 5:  h = HEADER_RANGE;             expect = "Range"; break;
+        case 10: h = HEADER_CONNECTION;        expect = "Connection"; break;
+        case 12: h = HEADER_CONTENT_TYPE;      expect = "Content-Type"; break;
+        case 13: h = HEADER_IF_NONE_MATCH;     expect = "If-None-Match"; break;
+        case 14: h = HEADER_CONTENT_LENGTH;    expect = "Content-Length"; break;
+        case 6:  h = HEADER_EXPECT;            expect = "Expect"; break;
+        case 15: h = HEADER_ACCEPT_ENCODING;   expect = "Accept-Encoding"; break;
+        case 17:
+            // 同为 17 个字符，按首字母区分
+            if (name[0] == 'T' || name[0] == 't') {
+                h = HEADER_TRANSFER_ENCODING;  expect = "Transfer-Encoding";
+            } else {
+                h = HEADER_IF_MODIFIED_SINCE;  expect = "If-Modified-Since";
+            }
+            break;
+        default: return -1;
+    }
+    return strncasecmp(name, expect, len) == 0 ? h : -1;
+}
+// 拷贝到 arena_ 并补 '\0'，返回偏移（arena_ 扩容后旧指针失效，所以只记偏移）
+uint32_t HttpRequest::AppendStr_(const char* begin, size_t len) {
+    uint32_t off = static_cast<uint32_t>(arena_.size());
+    arena_.append(begin, len);
+    arena_.push_back('\0');
+    return off;
+}
+// 头部结束：chunked 编码逐块读取，否则按 Content-Length 读取；过大的请求体不等读完就拒绝
+bool HttpRequest::HeadersDone_() {
+    const char* te = Header(HEADER_TRANSFER_ENCODING);
+    if (*te != '\0') {
+        if (strcasecmp(te, "chunked") != 0) {
+            return Fail_(501);
+        }
+        if (known_[HEADER_CONTENT_LENGTH] >= 0) {
+            return false;   // 同时带 Content-Length 可能是请求走私（RFC 7230 3.3.3），按错误处理
+        }
+        state_ = CHUNK_SIZE;
+    } else if (contentLen_ > maxBodySize) {
+        return Fail_(413);
+    } else {
+        state_ = contentLen_ > 0 ? BODY : FINISH;
+    }
+    if (state_ != FINISH && strcasecmp(Header(HEADER_EXPECT), "100-continue") == 0) {
+        continuePending_ = true;
+    }
+    return true;
+}
+// 分块长度行：十六进制长度，后面可以跟 ";扩展"（忽略）；长度为 0 表示最后一块
+bool HttpRequest::ParseChunkSize_(const char* begin, size_t len) {
+    size_t size = 0;
+    size_t i = 0;
+    for (; i < len && ConverHex(begin[i]) >= 0; i++) {
+        size = size * 16 + ConverHex(begin[i]);
+        if (bodyLen_ + size > maxBodySize) {
+            return Fail_(413);
+        }
+    }
+    if (i == 0 || (i < len && begin[i] != ';' && begin[i] != ' ' && begin[i] != '\t')) {
+        return false;
+    }
+    contentLen_ = size;
+    state_ = size > 0 ? CHUNK_DATA : CHUNK_TRAILER;
+    return true;
+}
+// 追加请求体：超过 bodyMemLimit 时转存到临时文件，之后的数据直接写文件
+bool HttpRequest::AppendBody_(const char* begin, size_t len) {
+    if (bodyLen_ + len > maxBodySize) {
+        return Fail_(413);
+    }
+    if (bodyFd_ < 0 && bodyLen_ + len > bodyMemLimit && !SpillBody_()) {
+        return Fail_(500);
+    }
+    if (bodyFd_ >= 0) {
+        if (!WriteAll(bodyFd_, begin, len)) {
+            LOG_ERROR("Write request body to temp file failed, errno: %d", errno);
+            return Fail_(500);
+        }
+    } else {
+        body_.append(begin, len);
+    }
+    bodyLen_ += len;
+    return true;
+}
+// 临时文件优先用 O_TMPFILE（没有名字，进程退出或关闭即释放），文件系统不支持时 mkostemp 后立即 unlink
+bool HttpRequest::SpillBody_() {
+    int fd = open(bodyTmpDir, O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        std::string name = std::string(bodyTmpDir) + "/webserver-body-XXXXXX";
+        fd = mkostemp(&name[0], O_CLOEXEC);
+        if (fd >= 0) {
+            unlink(name.c_str());
+        }
+    }
+    if (fd < 0) {
+        LOG_ERROR("Create request body temp file in %s failed, errno: %d", bodyTmpDir, errno);
+        return false;
+    }
+    if (!WriteAll(fd, body_.data(), body_.size())) {
+        LOG_ERROR("Write request body to temp file failed, errno: %d", errno);
+        close(fd);
+        return false;
+    }
+    bodyFd_ = fd;
+    std::string().swap(body_);     // 内存中的部分已写入文件，归还内存
+    return true;
+}
+// 请求体读完：只有内存中的请求体才按表单解析（登录/注册的表单远小于 bodyMemLimit）
+void HttpRequest::FinishBody_() {
+    if (bodyFd_ < 0) {
+        ParsePost_(); // 解析 POST 请求
+    } else {
+        LOG_DEBUG("Request body %zu bytes kept in temp file", bodyLen_);
+    }
+}
+void HttpRequest::CloseBody_() {
+    if (bodyFd_ >= 0) {
+        close(bodyFd_);
+        bodyFd_ = -1;
+    }
+}
+bool HttpRequest::Fail_(int code) {
+    errorCode_ = code;
+    return false;
 }
 // 解析 POST 请求
 void HttpRequest::ParsePost_() {
-    if (method_ == "POST" && header_["Content-Type"] == "application/x-www-form-urlencoded") {
+    if (method_ == "POST" && strcmp(Header(HEADER_CONTENT_TYPE), "application/x-www-form-urlencoded") == 0) {
         ParseFromUrlencoded_(); // 仅处理 urlencoded 格式
         if(DEFAULT_HTML_TAG.count(path_)) { // 如果是登录/注册的path
             int tag = DEFAULT_HTML_TAG.find(path_)->second; 
             LOG_DEBUG("Tag:%d", tag);
             if(tag == 0 || tag == 1) {
-                bool isLogin = (tag == 1);  // 为1则是登录
-                if(UserVerify(post_["username"], post_["password"], isLogin)) {
-                    path_ = "/welcome.html";
-                } 
-                else {
-                    path_ = "/error.html";
-                }
+                verifyPending_ = true;      // 数据库校验交给 UserVerifier，完成后 SetVerified
+                verifyLogin_ = (tag == 1);  // 为1则是登录
             }
         }
     }
 }
-// 解析 urlencoded 格式的请求体
+// 解析 urlencoded 格式的请求体：按 '&' 切分，每段在第一个 '=' 处分成键和值
 void HttpRequest::ParseFromUrlencoded_() {
-    if (body_.empty()) {
-        return;
-    }
-    string key, value;
-    int num = 0;
-    int n = body_.size();
-    int i = 0, j = 0;
-    while (i < n) {
-        char ch = body_[i];
-        switch (ch) {
-            case '=':
-                key = body_.substr(j, i - j);
-                j = i + 1;
-                break;
-            case '+':
-                body_[i] = ' '; // '+' 转为空格
-                break;
-            case '%':
-                num = ConverHex(body_[i + 1]) * 16 + ConverHex(body_[i + 2]);
-                body_[i + 2] = num % 10 + '0';
-                body_[i + 1] = num / 10 + '0';
-                i += 2;
-                break;
-            case '&':
-                value = body_.substr(j, i - j);
-                j = i + 1;
-                post_[key] = value; // 存储键值对
-                key = value = "";
-                break;
-            default:
-                break;
+    const char* p = body_.data();
+    const char* end = p + body_.size();
+    while (p < end) {
+        const char* amp = static_cast<const char*>(memchr(p, '&', end - p));
+        const char* pairEnd = amp ? amp : end;
+        if (pairEnd > p) {
+            const char* eq = static_cast<const char*>(memchr(p, '=', pairEnd - p));
+            const char* keyEnd = eq ? eq : pairEnd;
+            Field field;
+            field.name = AppendDecoded_(p, keyEnd);
+            field.nameLen = static_cast<uint32_t>(arena_.size() - 1 - field.name);
+            field.value = AppendDecoded_(eq ? eq + 1 : pairEnd, pairEnd);
+            field.valueLen = static_cast<uint32_t>(arena_.size() - 1 - field.value);
+            posts_.push_back(field); // 存储键值对
         }
-        ++i;
+        p = pairEnd + 1;
     }
-    // 处理最后一个键值对
-    if (key.empty() && j < i) {
-        key = body_.substr(j, i - j);
-        post_[key] = "";
-    } else if (!key.empty() && j < i) {
-        value = body_.substr(j, i - j);
-        post_[key] = value;
+}
+// URL 解码：'+' 转为空格，%XX 转为对应字节，非法的 % 序列原样保留
+uint32_t HttpRequest::AppendDecoded_(const char* begin, const char* end) {
+    uint32_t off = static_cast<uint32_t>(arena_.size());
+    for (const char* p = begin; p < end; ++p) {
+        if (*p == '+') {
+            arena_.push_back(' ');
+        } else if (*p == '%' && end - p > 2 && ConverHex(p[1]) >= 0 && ConverHex(p[2]) >= 0) {
+            arena_.push_back(static_cast<char>(ConverHex(p[1]) * 16 + ConverHex(p[2])));
+            p += 2;
+        } else {
+            arena_.push_back(*p);
+        }
     }
+    arena_.push_back('\0');
+    return off;
 }
 // 十六进制转整数
 int HttpRequest::ConverHex(char ch) {
@@ -175,105 +463,60 @@ int HttpRequest::ConverHex(char ch) {
     }
     return -1; // 非法字符
 }
-// 用户校验
-bool HttpRequest::UserVerify(const std::string& name, const std::string& pwd, bool isLogin) {
-    if (name.empty() || pwd.empty()) {
-        return false;
+// 是否有待校验的登录/注册
+bool HttpRequest::NeedsVerify(bool* isLogin) const {
+    if (verifyPending_ && isLogin) {
+        *isLogin = verifyLogin_;
     }
-    LOG_INFO("Verify name:%s pwd:%s", name.c_str(), pwd.c_str());
-    MYSQL* sql = nullptr;
-    // SqlConnRAII(&sql, SqlConnPool::Instance());
-    SqlConnRAII conn(&sql, SqlConnPool::Instance());
-    assert(sql);
-    bool flag = false;
-    unsigned int j = 0;
-    char order[256] = {0};
-    MYSQL_RES* res;
-    if (isLogin) {
-        snprintf(order, 256, "SELECT password FROM user WHERE username='%s' LIMIT 1", name.c_str());
-        LOG_INFO("Login Query: %s", order);
-        if (mysql_query(sql, order)) {
-            mysql_free_result(res);
-            return false;
-        }
-        res = mysql_store_result(sql);
-        // 查询结果只有一行一列
-        while ((res != nullptr) && (j = mysql_num_rows(res)) > 0) {
-            MYSQL_ROW row = mysql_fetch_row(res);
-            if (row[0] && pwd == row[0]) {
-                flag = true; // 密码匹配
-            } else {
-                flag = false; // 密码不匹配
-            }
-        }
-        mysql_free_result(res);
-    } else { // 注册用户
-        snprintf(order, 256, "SELECT username FROM user WHERE username='%s' LIMIT 1", name.c_str());
-        LOG_INFO("Register Query: %s", order);
-        if (mysql_query(sql, order)) {// 查询失败
-            mysql_free_result(res);
-            return false;
-        }
-        // 获取查询结果
-        res = mysql_store_result(sql);
-        if (mysql_num_rows(res) == 0) {
-            // 用户名不存在，可以注册
-            snprintf(order, 256, "INSERT INTO user(username, password) VALUES('%s', '%s')", name.c_str(), pwd.c_str());
-            LOG_INFO("Insert Query: %s", order);
-            if (mysql_query(sql, order)) {
-                mysql_free_result(res);
-                return false;
-            }
-            flag = true; // 注册成功
-        } else {
-            flag = false; // 用户名已存在   
-        }
-        mysql_free_result(res);
-    }
-    return flag;
-}   
-// 获取请求方法
-std::string HttpRequest::method() const {
-    return method_;
+    return verifyPending_;
 }
-// 获取请求路径
-std::string HttpRequest::path() const {
-    return path_;
+// 设置校验结果
+void HttpRequest::SetVerified(bool ok) {
+    verifyPending_ = false;
+    path_ = ok ? "/welcome.html" : "/error.html";
 }
-// 非 const 版本，允许修改 path_
-std::string& HttpRequest::path() {
-    return path_;
-}
-// 获取 HTTP 版本
-std::string HttpRequest::version() const {
-    return version_;
+// 在 fields 中从后往前找，重复的字段以最后一个为准
+const char* HttpRequest::Find_(const std::vector<Field>& fields, const char* key, bool ignoreCase) const {
+    size_t keyLen = strlen(key);
+    for (size_t i = fields.size(); i > 0; --i) {
+        const Field& f = fields[i - 1];
+        if (f.nameLen == keyLen &&
+            (ignoreCase ? strncasecmp(Str_(f.name), key, keyLen) : memcmp(Str_(f.name), key, keyLen)) == 0) {
+            return Str_(f.value);
+        }
+    }
+    return nullptr;
 }
 // 获取 POST 参数值
 std::string HttpRequest::GetPost(const std::string& key) const {
-    assert(key != "");
-    if (post_.count(key)) {
-        return post_.find(key)->second;
-    }
-    return "";
+    return GetPost(key.c_str());
 }
 std::string HttpRequest::GetPost(const char* key) const {
-    assert(key != nullptr);
-    if (post_.count(key)) {
-        return post_.find(key)->second;
+    assert(key != nullptr && *key != '\0');
+    const char* value = Find_(posts_, key, false);
+    return value ? value : "";
+}
+// 获取请求头
+const char* HttpRequest::GetHeader(const char* key) const {
+    int known = KnownHeader_(key, strlen(key));
+    if (known >= 0) {
+        return Header(static_cast<KNOWN_HEADER>(known));
     }
-    return "";
+    const char* value = Find_(fields_, key, true);
+    return value ? value : "";
 }
-// 判断是否为长连接
+// 判断是否为长连接：HTTP/1.1 默认保持，除非 Connection: close；HTTP/1.0 需要显式的 keep-alive
 bool HttpRequest::IsKeepAlive() const {
-    if (header_.count("Connection")) {
-        return header_.find("Connection")->second == "keep-alive" && version_ == "1.1";
+    if (failed_) {
+        return false;
     }
-    return false;
+    const char* conn = Header(HEADER_CONNECTION);
+    return version_ == "1.1" ? strcasecmp(conn, "close") != 0 : strcasecmp(conn, "keep-alive") == 0;
 }
-const std::unordered_set<std::string> HttpRequest::DEFAULT_HTML{
-    "/index", "/register", "/login", "/welcome", "/video", "/picture", "/favicon.ico"
+const char* const HttpRequest::DEFAULT_HTML[] = {
+    "/index", "/register", "/login", "/welcome", "/video", "/picture", "/favicon.ico", nullptr
 };
 const std::unordered_map<std::string, int> HttpRequest::DEFAULT_HTML_TAG{
     {"/register.html", 0},
     {"/login.html", 1}
-};
\ No newline at end of file
+};
@@ -2,24 +2,28 @@
 #define HTTP_REQUEST_H
 
 #include <unordered_map>
-#include <unordered_set>
 #include <string>
-#include <regex>    // 可能用于解析请求行或 header（注意：std::regex 在某些实现上性能较差）
+#include <vector>
+#include <stdint.h>
 #include <errno.h>     
-#include <mysql/mysql.h>  // mysql C API（UserVerify 用到）
 
 #include "../buffer/buffer.h"   // 自定义环形/字节缓冲区，用于从 socket 读入的数据解析
 #include "../log/log.h"         // 日志工具
-#include "../pool/sqlconnpool.h"// MySQL 连接池（线程安全）用于用户验证等操作
 
 // HttpRequest：用于解析单个 HTTP 请求（面向单连接/单线程的请求对象）
 // 设计职责：增量解析 HTTP 请求（支持粘包/拆包），把请求行/头部/请求体解析成可访问的字段。
+// 解析器是手写状态机：直接在 Buffer 的可读区上用 memchr 找行尾，不构造临时行字符串，
+// 也不使用 std::regex；一行没收全时保留状态与已扫描偏移，下次 parse 从断点继续。
+// 头部与表单字段不放进 map：名字和值依次拷进每个连接自己的 arena_（以 '\0' 结尾），
+// fields_ 只记录偏移；常用头部在解析时登记到 known_ 槽位，查找不用比较字符串。
+// Init 只清空长度、保留容量，稳态下解析一个请求不做任何堆分配。
+// 请求体按 Content-Length 或 chunked 编码增量消费：每次 parse 取走读缓冲区中已到达的部分，
+// 不要求整个请求体先进入读缓冲区；超过 bodyMemLimit 的请求体转存到临时文件，超过 maxBodySize 直接拒绝（413）。
 // 使用方式示例：
-//   HttpRequest req; req.Init();
+//   HttpRequest req;
 //   while (从 socket 读到数据放入 Buffer) {
-//       if (req.parse(buffer)) { // 解析完成 -> 访问 req.method(), req.path(), req.GetPost("k") 等
-//           // 构造响应...
-//           req.Init(); // 若连接 keep-alive，重用对象解析下一个请求
+//       if (req.parse(buffer) == HttpRequest::PARSE_OK) { // 解析完成 -> 访问 req.method(), req.path() 等
+//           // 构造响应...（下一次 parse 会自动重置对象，用于 keep-alive 的下一个请求）
 //       }
 //   }
 class HttpRequest {
@@ -27,54 +31,136 @@ public:
     // 解析状态机的几个状态：
     // REQUEST_LINE: 正在解析请求行（例如 "GET /index.html HTTP/1.1"）
     // HEADERS:      正在解析请求头部（每行 "Key: value"）
-    // BODY:         正在读取请求体（POST 时，依据 Content-Length）
+    // BODY:         正在读取请求体（依据 Content-Length）
+    // CHUNK_SIZE / CHUNK_DATA / CHUNK_END / CHUNK_TRAILER:
+    //               chunked 编码的分块长度行、分块数据、数据后的 CRLF、结尾的 trailer 头部
     // FINISH:       请求已解析完成
     enum PARSE_STATE {
         REQUEST_LINE,
         HEADERS,
         BODY,
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        CHUNK_END,
+        CHUNK_TRAILER,
         FINISH,        
     };
+
+    // parse 的返回值：
+    // PARSE_AGAIN: 数据不完整，已解析部分保留在对象中，等待更多数据后再次调用
+    // PARSE_OK:    一个完整请求解析完成
+    // PARSE_ERROR: 请求无法处理（请求行非法、行过长、Content-Length 非法、请求体过大等），
+    //              应返回的状态码由 ErrorCode() 给出
+    enum PARSE_RESULT {
+        PARSE_AGAIN,
+        PARSE_OK,
+        PARSE_ERROR,
+    };
+
+    // 解析时预先登记的头部（名字不区分大小写，重复出现时以最后一个为准）
+    enum KNOWN_HEADER {
+        HEADER_CONNECTION,
+        HEADER_CONTENT_LENGTH,
+        HEADER_CONTENT_TYPE,
+        HEADER_RANGE,
+        HEADER_IF_NONE_MATCH,
+        HEADER_IF_MODIFIED_SINCE,
+        HEADER_ACCEPT_ENCODING,
+        HEADER_TRANSFER_ENCODING,
+        HEADER_EXPECT,
+        HEADER_NUM
+    };
     
-    HttpRequest() { Init(); }   // 构造时初始化状态
-    ~HttpRequest() = default;
+    HttpRequest();              // 构造时预留 arena_ 并初始化状态
+    ~HttpRequest();             // 关闭请求体的临时文件
 
     // 重置对象到初始状态（用于复用同一对象解析下一个请求）
-    // - 清空 method_, path_, version_, body_
+    // - 清空 method_, path_, version_, body_（保留容量）
     // - state_ = REQUEST_LINE
-    // - 清空 header_、post_
+    // - 清空 arena_、fields_、known_；上一个请求把 arena_ / body_ 撑得过大时归还内存
+    // - 关闭上一个请求体的临时文件
     void Init();
 
-    // 从 Buffer 中增量解析请求。函数通常会被上层循环调用，直到返回 true（解析完成）或发生错误。
-    // 返回：true 表示请求已完整解析（state_ == FINISH）
-    //       false 表示尚未完成（或解析出错——具体可在实现中区分）
-    bool parse(Buffer& buff);   
+    // 从 Buffer 中增量解析请求，只消费已解析完的完整行（以及完整的请求体）。
+    // 若上一个请求已解析完成（state_ == FINISH），会先 Init() 再解析下一个请求。
+    PARSE_RESULT parse(Buffer& buff);   
 
-    // 访问器：返回请求路径（例如 "/index.html"）
-    std::string path() const;
+    // 访问器：返回请求路径（例如 "/index.html"），返回引用避免每次拷贝
+    const std::string& path() const { return path_; }
     // 非 const 版本（极少用）：允许修改 path_
-    std::string& path();
+    std::string& path() { return path_; }
+
+    // 客户端发来的原始请求目标（请求行中的 URI，未经默认页面映射、登录结果改写），访问日志使用
+    const char* Target() const { return targetLen_ ? Str_(target_) : ""; }
+    size_t TargetLen() const { return targetLen_; }
 
     // 返回请求方法，例如 "GET"、"POST"
-    std::string method() const;
+    const std::string& method() const { return method_; }
     // 返回 HTTP 版本字符串，例如 "1.1"
-    std::string version() const;
+    const std::string& version() const { return version_; }
 
     // 从解析好的 POST 参数中获取键值（若不存在返回空字符串）
-    // 注意：只有当请求体是 urlencoded（application/x-www-form-urlencoded）并且已经被 ParsePost_ 解析后，post_ 才有值
+    // 注意：只有当请求体是 urlencoded（application/x-www-form-urlencoded）并且已经被 ParsePost_ 解析后，posts_ 才有值
     std::string GetPost(const std::string& key) const;
     std::string GetPost(const char* key) const;
 
+    // 获取请求头的值（键不区分大小写，不存在时返回空字符串）
+    // 返回的指针指向 arena_，在下一次 parse/Init 之前有效
+    const char* GetHeader(const char* key) const;
+    const char* Header(KNOWN_HEADER h) const {
+        return known_[h] < 0 ? "" : Str_(fields_[known_[h]].value);
+    }
+
+    // 请求体：不超过 bodyMemLimit 时在 body() 中；否则 body() 为空，内容在 BodyFd()（已 unlink 的临时文件，
+    // 读写位置在末尾，读取前先 lseek/pread）。BodyLen() 为解码后（去掉 chunked 编码）的总长度
+    const std::string& body() const { return body_; }
+    int BodyFd() const { return bodyFd_; }
+    size_t BodyLen() const { return bodyLen_; }
+
+    // parse 返回 PARSE_ERROR 时应回复的状态码：400 格式错误，413 请求体过大，
+    // 501 不支持的 Transfer-Encoding，500 临时文件写入失败
+    int ErrorCode() const { return errorCode_; }
+
+    // 头部带 Expect: 100-continue 且请求体可以接收时，头部解析完后返回一次 true，
+    // 调用者应先回复 "100 Continue"，客户端才会开始发送请求体
+    bool TakeContinue() {
+        bool ret = continuePending_;
+        continuePending_ = false;
+        return ret;
+    }
+
     // 判断是否使用长连接（keep-alive）
-    // 实现应参考 HTTP 版本与 Connection 头（HTTP/1.1 默认 keep-alive 除非 Connection: close）
+    // 参考 HTTP 版本与 Connection 头（HTTP/1.1 默认 keep-alive 除非 Connection: close）；解析出错的请求返回 false
     bool IsKeepAlive() const;
 
+    // 是否有解析到一半的请求（已收到请求行但尚未解析完成）
+    bool InProgress() const {
+        return state_ != REQUEST_LINE && state_ != FINISH;
+    }
+
+    // 登录/注册表单：解析后不在解析线程里访问数据库，只记录“待校验”，由调用方（HttpConn）
+    // 交给 UserVerifier 异步校验。返回是否有待校验的请求，*isLogin 为 true 表示登录
+    bool NeedsVerify(bool* isLogin) const;
+    // 用校验结果决定返回的页面（成功 /welcome.html，失败 /error.html）并清除待校验标记
+    void SetVerified(bool ok);
+
+    // 请求体的上限（超过回复 413）、在内存中保存的上限、临时文件所在目录，由 WebServer 设置
+    static size_t maxBodySize;
+    static size_t bodyMemLimit;
+    static const char* bodyTmpDir;
+
 private:
-    // 以下为解析各部分的内部方法（由 parse 调用）
+    // 以下为解析各部分的内部方法（由 parse 调用），参数是指向 Buffer 内部的 [begin, begin+len) 切片
     // 返回 true/false 取决于解析是否成功（例如请求行格式错误则返回 false）
-    bool ParseRequestLine_(const std::string& line);    // 处理请求行
-    void ParseHeader_(const std::string& line);         // 处理单条请求头
-    void ParseBody_(const std::string& line);           // 处理请求体（当前实现按整块 body 处理）
+    bool ParseRequestLine_(const char* begin, size_t len);  // 处理请求行
+    bool ParseHeader_(const char* begin, size_t len);       // 处理单条请求头
+    bool ParseChunkSize_(const char* begin, size_t len);    // 处理 chunked 编码的分块长度行
+    bool HeadersDone_();                                    // 头部结束：决定请求体的读取方式
+    bool AppendBody_(const char* begin, size_t len);        // 追加一段请求体（必要时转存到临时文件）
+    bool SpillBody_();                                      // 把内存中的请求体转存到临时文件
+    void FinishBody_();                                     // 请求体读完
+    void CloseBody_();
+    bool Fail_(int code);   // 记录错误状态码，返回 false
 
     // 路径相关处理（例如把 "/" 映射为 "/index.html"，把 "/index" 映射为 "/index.html"）
     void ParsePath_();
@@ -82,34 +168,70 @@ private:
     // 处理 POST 请求：根据 Content-Type 解析 body_（例如 urlencoded）
     void ParsePost_();
 
-    // 从 "application/x-www-form-urlencoded" 格式解析键值对并放入 post_ map（会做 URL 解码）
+    // 从 "application/x-www-form-urlencoded" 格式解析键值对，解码后放入 arena_ / posts_
     void ParseFromUrlencoded_();
-
-    // 用户校验：访问 MySQL 连接池，检查用户名密码或插入新用户（登录/注册）
-    // 参数：
-    //   name  - 用户名
-    //   pwd   - 密码（注意：示例项目通常是明文比较，但真实项目请使用哈希+salt）
-    //   isLogin - true: 校验登录；false: 注册时检查是否可用并插入
-    // 返回：校验/注册是否成功（true/false）
-    static bool UserVerify(const std::string& name, const std::string& pwd, bool isLogin);
+    // URL 解码 [begin, end) 追加到 arena_ 并以 '\0' 结尾，返回起始偏移
+    uint32_t AppendDecoded_(const char* begin, const char* end);
+
+    // 名字与值在 arena_ 中的偏移（均以 '\0' 结尾，长度不含 '\0'）
+    struct Field {
+        uint32_t name;
+        uint32_t nameLen;
+        uint32_t value;
+        uint32_t valueLen;
+    };
+    uint32_t AppendStr_(const char* begin, size_t len);     // 拷入 arena_，返回偏移
+    const char* Str_(uint32_t off) const { return arena_.data() + off; }
+    // 在 fields 中找名字为 key 的最后一项，返回值（没有时返回 nullptr）
+    const char* Find_(const std::vector<Field>& fields, const char* key, bool ignoreCase) const;
+    static int KnownHeader_(const char* name, size_t len);  // 不是预登记的头部时返回 -1
+    static bool ParseContentLength_(const char* begin, size_t len, size_t* n);
 
     // 当前解析状态
     PARSE_STATE state_;
+    // 当前未完成的行中已经扫描过（确认没有 '\n'）的字节数，避免数据分多次到达时重复扫描
+    size_t checked_;
+    // 请求体长度（来自 Content-Length）；chunked 编码时为当前分块剩余的长度
+    size_t contentLen_;
+    // 已读到的请求体长度；请求体超过 bodyMemLimit 后转存到的临时文件（-1 表示在 body_ 中）
+    size_t bodyLen_;
+    int bodyFd_;
+    // PARSE_ERROR 对应的状态码；failed_ 为 true 时不保持连接
+    int errorCode_;
+    bool failed_;
+    // 等待调用者回复 100 Continue
+    bool continuePending_;
     // 基本请求字段
     std::string method_, path_, version_, body_;
-    // 存储 header 的键值（key 不区分大小写最好在插入时统一转换为小写）
-    std::unordered_map<std::string, std::string> header_;
-    // POST 表单解析结果（key -> value）
-    std::unordered_map<std::string, std::string> post_;
-
-    // 默认的静态页面集合（例如访问 "/index" 时会映射到 "/index.html"）
-    static const std::unordered_set<std::string> DEFAULT_HTML;
+    // 本请求的原始请求目标、头部/表单字段的字节（依次存放）；target_ 为请求目标在 arena_ 中的偏移
+    std::string arena_;
+    uint32_t target_;
+    size_t targetLen_;
+    // 头部按出现顺序存放；known_ 为预登记头部在 fields_ 中的下标（-1 表示没有）
+    std::vector<Field> fields_;
+    int known_[HEADER_NUM];
+    // POST 表单解析结果（urlencoded 解码后的键值）
+    std::vector<Field> posts_;
+    // 登录/注册表单是否等待校验，以及是否为登录
+    bool verifyPending_;
+    bool verifyLogin_;
+
+    // 默认的静态页面集合（例如访问 "/index" 时会映射到 "/index.html"），以 nullptr 结尾
+    static const char* const DEFAULT_HTML[];
     // 默认页面的 tag（例如 register.html 对应一个 tag，用于判断注册/登录逻辑）
     static const std::unordered_map<std::string, int> DEFAULT_HTML_TAG;
 
     // 把十六进制字符（'0'..'9','a'..'f','A'..'F'）转为整数 0..15
     // 返回 -1 表示非法 hex 字符（实现中应判断返回值）
     static int ConverHex(char ch);  // 16进制转换为10进制
+
+    // 单行（请求行/头部行）的最大长度，超过视为非法请求，防止读缓冲无限增长
+    static const size_t MAX_LINE_LEN = 8192;
+    // 单个请求最多的头部数，超过视为非法请求，限制 fields_ / arena_ 的大小
+    static const size_t MAX_HEADERS = 100;
+    // 构造时 arena_ 预留的容量；超过 ARENA_KEEP 的部分在下一次 Init 时归还
+    static const size_t ARENA_RESERVE = 1024;
+    static const size_t ARENA_KEEP = 16 * 1024;
 };
 
 #endif
@@ -1,12 +1,19 @@
 #include "httpresponse.h"
 
+size_t HttpResponse::sendfileThreshold = 1024 * 1024;
+const char* HttpResponse::BOUNDARY = "TINYWEBSERVER_BYTERANGES";
+
 //构造函数
 HttpResponse::HttpResponse() {
     code_ = -1;
     path_ = srcDir_ = "";
     isKeepAlive_ = false;
     mmFile_ = nullptr;
+    fileFd_ = -1;
     mmFileStat_ = {0};
+    buffStart_ = 0;
+    vary_ = false;
+    hasContent_ = false;
 }
 //析构函数
 HttpResponse::~HttpResponse() {
@@ -14,21 +21,46 @@ HttpResponse::~HttpResponse() {
 }
 
 //初始化
-void HttpResponse::Init(const std::string& srcDir, std::string& path, bool isKeepAlive, int code) {
-    assert(srcDir != "");
-    if (mmFile_) { UnmapFile(); }
+void HttpResponse::Init(const char* srcDir, const std::string& path, bool isKeepAlive, int code) {
+    assert(srcDir && *srcDir);
+    UnmapFile();
     code_ = code;
     isKeepAlive_ = isKeepAlive;
     srcDir_ = srcDir;
     path_ = path;
-    mmFile_ = nullptr;
     mmFileStat_ = {0};
+    range_.clear();
+    ifNoneMatch_.clear();
+    ifModifiedSince_.clear();
+    acceptEncoding_.clear();
+    hasContent_ = false;
+    contentType_.clear();
+    content_.clear();
+    vary_ = false;
+    ranges_.clear();
+    parts_.clear();
 }
 
 //生成响应报文
 void HttpResponse::MakeResponse(Buffer& buff) {
-    //判断请求资源文件
-    if (stat((srcDir_ + path_).c_str(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode)) {
+    buffStart_ = buff.ReadableBytes();
+    parts_.clear();
+    if (hasContent_) {
+        code_ = 200;
+        AddStateLine_(buff);
+        AddHeader_(buff);
+        buff.Append("Content-Type: ");
+        buff.Append(contentType_);
+        buff.Append("\r\nContent-Length: ");
+        AppendNum_(buff, content_.size());
+        buff.Append("\r\n\r\n");
+        buff.Append(content_);
+        return;
+    }
+    //判断请求资源文件：调用者已指定错误状态码（非法请求、请求体过大、校验繁忙等）时不查找请求的文件
+    if (code_ >= 400) {
+        fullPath_.clear();
+    } else if (!Stat_()) {
         code_ = 404;
     } else if (!(mmFileStat_.st_mode & S_IROTH)) {
         code_ = 403;
@@ -36,6 +68,14 @@ void HttpResponse::MakeResponse(Buffer& buff) {
         code_ = 200;
     }
     ErrorHtml_();//生成错误页面
+    if (code_ == 200) {
+        NegotiateEncoding_();   // 可能把 file_ 换成压缩变体，之后的校验与区间都针对变体
+    }
+    if (code_ == 200 && IsNotModified_()) {
+        code_ = 304;    // 协商缓存命中：只发头部，不打开/映射文件
+    } else if (code_ == 200 && !range_.empty()) {
+        ParseRange_();  // 可能变为 206 或 416
+    }
     //添加状态行、消息报头、响应正文
     AddStateLine_(buff);
     AddHeader_(buff);
@@ -43,106 +83,534 @@ void HttpResponse::MakeResponse(Buffer& buff) {
 }
 //解除文件映射
 void HttpResponse::UnmapFile() {
+    file_.reset();  // 缓存条目：只释放引用，最后一个引用释放时才 munmap
     if (mmFile_) {
         munmap(mmFile_, mmFileStat_.st_size);   
         mmFile_ = nullptr;
     }
+    if (fileFd_ >= 0) {
+        close(fileFd_);
+        fileFd_ = -1;
+    }
+}
+//转交正文资源：之后 File()/FileFd() 不再有效，资源随返回的 holder 释放
+std::shared_ptr<const void> HttpResponse::ReleaseBody() {
+    if (file_) {
+        return std::move(file_);
+    }
+    if (!mmFile_ && fileFd_ < 0) {
+        return nullptr;
+    }
+    std::shared_ptr<ResponseBody> body = std::make_shared<ResponseBody>();
+    body->mm = mmFile_;
+    body->mmLen = mmFileStat_.st_size;
+    body->fd = fileFd_;
+    mmFile_ = nullptr;
+    fileFd_ = -1;
+    return body;
 }
 //获取文件地址
 char* HttpResponse::File() {
-    return mmFile_;
+    return file_ ? file_->data : mmFile_;
 }
 //获取文件长度
 size_t HttpResponse::FileLen() const {
-    return mmFileStat_.st_size;
+    return file_ ? file_->size : mmFileStat_.st_size;
 }
-//将错误信息添加到响应报文
+//将错误信息添加到响应报文（只在错误页面文件也不存在时使用）
 void HttpResponse::ErrorContent(Buffer& buff, std::string message) {
     std::string body;
-    std::string status;
-    if (CODE_STATUS.count(code_) == 1) {
-        status = CODE_STATUS.find(code_)->second;
-    } else {
-        status = "Bad Request";
-    }
     body += "<html><title>Error</title>";
     body += "<body bgcolor=\"ffffff\">";
-    body += std::to_string(code_) + " : " + status + "\n";
+    body += std::to_string(code_) + " : " + StatusText_(code_) + "\n";
     body += "<p>" + message + "</p>";
     body += "<hr><em> Liu's Web Server</em></body></html>";
-    buff.Append("Content-Length: " + std::to_string(body.size()) + "\r\n");
-    buff.Append("Content-Type: text/html\r\n");
-    buff.Append("\r\n");
+    buff.Append("Content-Length: ");
+    AppendNum_(buff, body.size());
+    buff.Append("\r\nContent-Type: text/html\r\n\r\n");
     buff.Append(body);
 }
-//添加状态行
+//添加状态行：未知状态码按 400 处理
 void HttpResponse::AddStateLine_(Buffer &buff) {
-    std::string status;
-    if (CODE_STATUS.count(code_) == 1) {
-        status = CODE_STATUS.find(code_)->second;
-    } else {
+    size_t len = 0;
+    const char* line = StatusLine_(code_, &len);
+    if (!line) {
         code_ = 400;
-        status = CODE_STATUS.find(400)->second;
+        line = StatusLine_(code_, &len);
     }
-    buff.Append("HTTP/1.1 " + std::to_string(code_) + " " + status + "\r\n");
+    buff.Append(line, len);
 }
 //添加消息报头
 void HttpResponse::AddHeader_(Buffer &buff) {
-    buff.Append("Connection: ");
+    static const char KEEP_ALIVE[] = "Connection: keep-alive\r\nKeep-Alive: max=6, timeout=120\r\n";
+    static const char CLOSE[] = "Connection: close\r\n";
     if (isKeepAlive_) {
-        buff.Append("keep-alive\r\n");
-        buff.Append("Keep-Alive: max=6, timeout=120\r\n");
+        buff.Append(KEEP_ALIVE, sizeof(KEEP_ALIVE) - 1);
     } else {
-        buff.Append("close\r\n");
+        buff.Append(CLOSE, sizeof(CLOSE) - 1);
+    }
+    AddDate_(buff);
+    if (vary_ && !(file_ && !file_->encoding.empty())) {
+        buff.Append("Vary: Accept-Encoding\r\n");  // 压缩变体的 Vary 已包含在它的实体头中
+    }
+}
+//Date 头：每个线程缓存当前秒格式化好的整行，秒数变化时才重新格式化
+void HttpResponse::AddDate_(Buffer &buff) {
+    struct DateCache {
+        time_t sec = -1;
+        char line[64];
+        size_t len = 0;
+    };
+    static thread_local DateCache cache;
+    time_t now = time(nullptr);
+    if (now != cache.sec) {
+        cache.sec = now;
+        memcpy(cache.line, "Date: ", 6);
+        size_t n = FileCache::FormatHttpDate(now, cache.line + 6, sizeof(cache.line) - 8);
+        memcpy(cache.line + 6 + n, "\r\n", 2);
+        cache.len = n + 8;
+    }
+    buff.Append(cache.line, cache.len);
+}
+//十进制格式化
+size_t HttpResponse::FormatNum_(char* out, uint64_t v) {
+    char tmp[20];
+    size_t n = 0;
+    do {
+        tmp[n++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v);
+    for (size_t i = 0; i < n; i++) {
+        out[i] = tmp[n - 1 - i];
     }
-    buff.Append("Content-Type: " + GetFileType_() + "\r\n");
+    return n;
+}
+//数字直接写进 Buffer 的可写区域
+void HttpResponse::AppendNum_(Buffer &buff, uint64_t v) {
+    buff.EnsureWriteable(20);
+    buff.HasWritten(FormatNum_(buff.BeginWrite(), v));
 }
-//添加响应正文
+//添加响应正文：整文件、单区间或多区间（multipart/byteranges），文件内容记录到 parts_ 由 HttpConn 发送
 void HttpResponse::AddContent_(Buffer &buff) {
-    int srcFd = open((srcDir_ + path_).c_str(), O_RDONLY);
-    if (srcFd < 0) {
-        ErrorContent(buff, "File Not Found!");
+    if (code_ == 304) {
+        AddFileHeaders_(buff, false);
+        buff.Append("\r\n");
+        return;
+    }
+    if (!OpenFile_()) {
+        ErrorContent(buff, code_ >= 400 && code_ != 404 ? StatusText_(code_) : "File Not Found!");
+        return;
+    }
+    const size_t size = FileLen();
+    if (code_ == 416) {
+        buff.Append("Content-Range: bytes */");
+        AppendNum_(buff, size);
+        buff.Append("\r\nContent-Length: 0\r\n\r\n");
         return;
     }
+    if (code_ == 200 || code_ == 206) {
+        buff.Append("Accept-Ranges: bytes\r\n");
+    }
+    if (code_ != 206) {
+        AddFileHeaders_(buff, true);
+        buff.Append("\r\n");
+        parts_.push_back({buff.ReadableBytes() - buffStart_, 0, size});
+        return;
+    }
+
+    const char* type = file_ ? file_->type.c_str() : GetFileType_();
+    if (ranges_.size() == 1) {
+        size_t first = ranges_[0].first, last = ranges_[0].second;
+        buff.Append("Content-Type: ");
+        buff.Append(type);
+        buff.Append("\r\n");
+        AddFileHeaders_(buff, false);
+        buff.Append("Content-Range: bytes ");
+        AppendNum_(buff, first);
+        buff.Append("-");
+        AppendNum_(buff, last);
+        buff.Append("/");
+        AppendNum_(buff, size);
+        buff.Append("\r\nContent-Length: ");
+        AppendNum_(buff, last - first + 1);
+        buff.Append("\r\n\r\n");
+        parts_.push_back({buff.ReadableBytes() - buffStart_, first, last - first + 1});
+        return;
+    }
+
+    // 多区间：每个分段前是分隔符与分段头，最后是结束分隔符；先只计算长度得到 Content-Length
+    size_t length = 0;
+    for (const auto& r : ranges_) {
+        length += AddPartHead_(nullptr, type, r.first, r.second, size) + r.second - r.first + 1;
+    }
+    length += 4 + strlen(BOUNDARY) + 4;     // "\r\n--" BOUNDARY "--\r\n"
+    buff.Append("Content-Type: multipart/byteranges; boundary=");
+    buff.Append(BOUNDARY);
+    buff.Append("\r\n");
+    AddFileHeaders_(buff, false);
+    buff.Append("Content-Length: ");
+    AppendNum_(buff, length);
+    buff.Append("\r\n\r\n");
+    for (const auto& r : ranges_) {
+        AddPartHead_(&buff, type, r.first, r.second, size);
+        parts_.push_back({buff.ReadableBytes() - buffStart_, r.first, r.second - r.first + 1});
+    }
+    buff.Append("\r\n--");
+    buff.Append(BOUNDARY);
+    buff.Append("--\r\n");
+}
+//多区间的分段头，返回长度；buff 为空时只计算长度
+size_t HttpResponse::AddPartHead_(Buffer* buff, const char* type, size_t first, size_t last, size_t size) const {
+    char nums[3][20];
+    size_t numLen[3] = {FormatNum_(nums[0], first), FormatNum_(nums[1], last), FormatNum_(nums[2], size)};
+    const char* pieces[] = {"\r\n--", BOUNDARY, "\r\nContent-Type: ", type, "\r\nContent-Range: bytes "};
+    size_t len = 0;
+    for (const char* piece : pieces) {
+        size_t n = strlen(piece);
+        if (buff) { buff->Append(piece, n); }
+        len += n;
+    }
+    static const char* SEPS[] = {"-", "/", "\r\n\r\n"};
+    for (int i = 0; i < 3; i++) {
+        size_t n = strlen(SEPS[i]);
+        if (buff) {
+            buff->Append(nums[i], numLen[i]);
+            buff->Append(SEPS[i], n);
+        }
+        len += numLen[i] + n;
+    }
+    return len;
+}
+//实体头：full 为 true 时输出 Content-Type/Content-Length 及校验头，否则只输出 [Content-Encoding] ETag/Last-Modified
+//未缓存的大文件的校验头由 mmFileStat_ 生成，规则与 FileCache 相同
+void HttpResponse::AddFileHeaders_(Buffer &buff, bool full) {
+    if (file_) {
+        if (full) {
+            buff.Append(file_->headers);    //缓存命中：实体头已预先生成
+        } else {
+            if (!file_->encoding.empty()) {
+                buff.Append("Content-Encoding: ");
+                buff.Append(file_->encoding);
+                buff.Append("\r\nVary: Accept-Encoding\r\n");
+            }
+            buff.Append("ETag: ");
+            buff.Append(file_->etag);
+            buff.Append("\r\nLast-Modified: ");
+            buff.Append(file_->lastModified);
+            buff.Append("\r\n");
+        }
+    } else {
+        if (full) {
+            buff.Append("Content-Type: ");
+            buff.Append(GetFileType_());
+            buff.Append("\r\nContent-Length: ");
+            AppendNum_(buff, mmFileStat_.st_size);
+            buff.Append("\r\n");
+        }
+        char field[64];
+        buff.Append("ETag: ");
+        buff.Append(field, FileCache::MakeETag(mmFileStat_, field, sizeof(field)));
+        buff.Append("\r\nLast-Modified: ");
+        buff.Append(field, FileCache::FormatHttpDate(mmFileStat_.st_mtime, field, sizeof(field)));
+        buff.Append("\r\n");
+    }
+}
+//准备正文：缓存命中直接引用缓存中的映射；大文件本次请求自行 mmap，或保留 fd 供 sendfile
+bool HttpResponse::OpenFile_() {
+    if (file_) {
+        return !file_->headers.empty();    // 为空表示文件不可读或映射失败
+    }
+    int srcFd = open(fullPath_.c_str(), O_RDONLY);
+    if (srcFd < 0) {
+        return false;
+    }
+    LOG_DEBUG("file path %s", fullPath_.c_str());
+    if (static_cast<size_t>(mmFileStat_.st_size) >= sendfileThreshold) {
+        //超大文件：不映射，保留 fd 由 HttpConn 用 sendfile 发送
+        fileFd_ = srcFd;
+        return true;
+    }
     //将文件映射到内存提高文件的访问速度
-    LOG_DEBUG("file path %s", (srcDir_ + path_).c_str());
     mmFile_ = (char*)mmap(0, mmFileStat_.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
+    close(srcFd);
     if (mmFile_ == MAP_FAILED) {
-        ErrorContent(buff, "File Not Found!");
-        close(srcFd);   
+        mmFile_ = nullptr;
+        return false;
     }
-    close(srcFd);
-    buff.Append("Content-Length: " + std::to_string(mmFileStat_.st_size) + "\r\n");
-    buff.Append("\r\n");
+    return true;
+}
+//解析 Range: bytes=a-b, c-, -n
+//语法错误或区间过多时忽略 Range（按 200 返回整文件）；所有区间都不可满足时置为 416
+void HttpResponse::ParseRange_() {
+    const size_t size = FileLen();  // 压缩变体按压缩后的字节计算区间
+    const char* p = range_.c_str();
+    if (strncmp(p, "bytes=", 6) != 0) {
+        return;
+    }
+    p += 6;
+    // 直接填入 ranges_（复用容量）；中途放弃时 code_ 仍为 200，ranges_ 中的部分结果不会被使用
+    std::vector<std::pair<size_t, size_t>>& result = ranges_;
+    result.clear();
+    size_t specs = 0;
+    while (true) {
+        while (*p == ' ' || *p == '\t') { p++; }
+        char* end = nullptr;
+        bool hasFirst = isdigit(static_cast<unsigned char>(*p));
+        unsigned long long first = 0, last = 0;
+        if (hasFirst) {
+            first = strtoull(p, &end, 10);
+            p = end;
+        }
+        if (*p != '-') {
+            return;
+        }
+        p++;
+        bool hasLast = isdigit(static_cast<unsigned char>(*p));
+        if (hasLast) {
+            last = strtoull(p, &end, 10);
+            p = end;
+        }
+        while (*p == ' ' || *p == '\t') { p++; }
+        if ((!hasFirst && !hasLast) || (hasFirst && hasLast && last < first) || ++specs > MAX_RANGES) {
+            return;
+        }
+        if (!hasFirst) {
+            // 后缀区间：最后 last 个字节
+            if (last > 0 && size > 0) {
+                result.push_back({last >= size ? 0 : size - last, size - 1});
+            }
+        } else if (first < size) {
+            result.push_back({first, (hasLast && last < size) ? last : size - 1});
+        }
+        if (*p == '\0') {
+            break;
+        }
+        if (*p != ',') {
+            return;
+        }
+        p++;
+    }
+    if (result.empty()) {
+        code_ = 416;
+        return;
+    }
+    code_ = 206;
+}
+//条件请求：If-None-Match 优先（弱比较）；没有时再看 If-Modified-Since
+bool HttpResponse::IsNotModified_() {
+    if (!ifNoneMatch_.empty()) {
+        if (file_) {
+            return MatchETag_(ifNoneMatch_, file_->etag.data(), file_->etag.size());
+        }
+        char etag[64];      // 不进缓存的大文件：在栈上生成，不分配堆内存
+        return MatchETag_(ifNoneMatch_, etag, FileCache::MakeETag(mmFileStat_, etag, sizeof(etag)));
+    }
+    if (!ifModifiedSince_.empty()) {
+        struct tm tm = {};
+        const char* end = strptime(ifModifiedSince_.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        if (end == nullptr) {
+            return false;   // 无法解析的日期忽略
+        }
+        return mmFileStat_.st_mtime <= timegm(&tm);
+    }
+    return false;
+}
+//内容协商：可压缩的缓存文件按 Accept-Encoding 依次尝试 br、gzip（q=0 表示拒绝）
+//没有合适的变体时保持原文件；大文件（不进缓存）不压缩
+void HttpResponse::NegotiateEncoding_() {
+    if (!file_ || file_->headers.empty() || !IsCompressible_(file_->type)) {
+        return;
+    }
+    vary_ = true;
+    if (acceptEncoding_.empty()) {
+        return;
+    }
+    static const FILE_ENCODING CODINGS[] = {FILE_ENCODING_BR, FILE_ENCODING_GZIP};
+    for (FILE_ENCODING coding : CODINGS) {
+        if (AcceptQ_(acceptEncoding_, FileCache::EncodingName(coding)) <= 0) {
+            continue;
+        }
+        std::shared_ptr<const FileEntry> variant = FileCache::Instance()->GetEncoded(file_, fullPath_, coding);
+        if (variant) {
+            file_ = variant;
+            return;
+        }
+    }
+}
+//返回 coding 在 Accept-Encoding 中的 q 值：未出现时取 "*" 的 q 值，都没有返回 0
+double HttpResponse::AcceptQ_(const std::string& list, const std::string& coding) {
+    double star = 0;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = list.size();
+        }
+        std::string item = list.substr(pos, comma - pos);
+        pos = comma + 1;
+        double q = 1;
+        size_t semi = item.find(';');
+        if (semi != std::string::npos) {
+            size_t eq = item.find("q=", semi);
+            if (eq != std::string::npos) {
+                q = atof(item.c_str() + eq + 2);
+            }
+            item.resize(semi);
+        }
+        size_t b = item.find_first_not_of(" \t");
+        size_t e = item.find_last_not_of(" \t");
+        if (b == std::string::npos) {
+            continue;
+        }
+        item = item.substr(b, e - b + 1);
+        if (strcasecmp(item.c_str(), coding.c_str()) == 0) {
+            return q;
+        }
+        if (item == "*") {
+            star = q;
+        }
+    }
+    return star;
+}
+//文本类资源才值得压缩；图片、视频、压缩包等本身已压缩
+bool HttpResponse::IsCompressible_(const std::string& type) {
+    return type.compare(0, 5, "text/") == 0 || type == "application/javascript" ||
+           type == "application/json" || type == "application/xhtml+xml" ||
+           type == "image/svg+xml" || type == "image/x-icon" ||
+           type == "font/ttf" || type == "font/otf" || type == "application/vnd.ms-fontobject";
+}
+//在逗号分隔的 ETag 列表中查找，支持 "*"，比较时忽略弱校验前缀 W/
+bool HttpResponse::MatchETag_(const std::string& list, const char* etag, size_t len) {
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = list.size();
+        }
+        size_t b = pos, e = comma;
+        while (b < e && (list[b] == ' ' || list[b] == '\t')) { b++; }
+        while (e > b && (list[e - 1] == ' ' || list[e - 1] == '\t')) { e--; }
+        if (e - b >= 2 && list.compare(b, 2, "W/") == 0) {
+            b += 2;
+        }
+        if ((e - b == 1 && list[b] == '*') || list.compare(b, e - b, etag, len) == 0) {
+            return true;
+        }
+        pos = comma + 1;
+    }
+    return false;
 }
 //生成错误页面
 void HttpResponse::ErrorHtml_() {
     if (CODE_PATH.count(code_) == 1) {
         path_ = CODE_PATH.find(code_)->second;
-        if (stat((srcDir_ + path_).c_str(), &mmFileStat_) < 0) {
+        if (!Stat_()) {
             code_ = 404;
         }
     }
 }
-//获取文件类型
-std::string HttpResponse::GetFileType_() {
+//查找请求资源：小文件从 FileCache 获取（校验间隔内无系统调用），大文件直接 stat
+bool HttpResponse::Stat_() {
+    bool tooLarge = false;
+    UnmapFile();
+    fullPath_.assign(srcDir_);
+    fullPath_.append(path_);
+    file_ = FileCache::Instance()->Get(fullPath_, GetFileType_(), &tooLarge);
+    if (file_) {
+        mmFileStat_ = file_->st;
+        return true;
+    }
+    if (tooLarge) {
+        return stat(fullPath_.c_str(), &mmFileStat_) == 0 && !S_ISDIR(mmFileStat_.st_mode);
+    }
+    mmFileStat_ = {0};
+    return false;
+}
+namespace {
+// 把不超过 8 字节的扩展名（不含 '.'）按字节打包成整数，用于 switch；更长的扩展名得到 0
+constexpr uint64_t PackExt(const char* ext, size_t len) {
+    uint64_t v = 0;
+    if (len > 8) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        v |= static_cast<uint64_t>(static_cast<unsigned char>(ext[i])) << (8 * i);
+    }
+    return v;
+}
+template <size_t N>
+constexpr uint64_t Ext(const char (&ext)[N]) {
+    return PackExt(ext, N - 1);
+}
+} // namespace
+
+//获取文件类型：按扩展名 switch（编译期打包的常量），不生成子串
+const char* HttpResponse::GetFileType_() const {
     std::string::size_type idx = path_.find_last_of('.');
-    if (idx != std::string::npos) {
-        std::string suffix = path_.substr(idx);
-        if (SUFFIX_TYPE.count(suffix) == 1) {
-            return SUFFIX_TYPE.find(suffix)->second;
-        }
+    if (idx == std::string::npos) {
+        return "text/plain";
+    }
+    switch (PackExt(path_.data() + idx + 1, path_.size() - idx - 1)) {
+    case Ext("html"): return "text/html";
+    case Ext("xml"): return "text/xml";
+    case Ext("xhtml"): return "application/xhtml+xml";
+    case Ext("txt"): return "text/plain";
+    case Ext("rtf"): return "application/rtf";
+    case Ext("pdf"): return "application/pdf";
+    case Ext("word"): return "application/msword";
+    case Ext("png"): return "image/png";
+    case Ext("gif"): return "image/gif";
+    case Ext("jpg"): return "image/jpeg";
+    case Ext("jpeg"): return "image/jpeg";
+    case Ext("au"): return "audio/basic";
+    case Ext("mpeg"): return "video/mpeg";
+    case Ext("mpg"): return "video/mpeg";
+    case Ext("avi"): return "video/x-msvideo";
+    case Ext("gz"): return "application/x-gzip";
+    case Ext("mp4"): return "video/mp4";
+    case Ext("tar"): return "application/x-tar";
+    case Ext("css"): return "text/css";
+    case Ext("js"): return "text/javascript";
+    case Ext("json"): return "application/json";
+    case Ext("svg"): return "image/svg+xml";
+    case Ext("ico"): return "image/x-icon";
+    case Ext("ttf"): return "font/ttf";
+    case Ext("otf"): return "font/otf";
+    case Ext("woff"): return "font/woff";
+    case Ext("woff2"): return "font/woff2";
+    case Ext("eot"): return "application/vnd.ms-fontobject";
+    default: return "text/plain";
     }
-    return "text/plain";
 }
-//状态码与状态信息
-const std::unordered_map<int, std::string> HttpResponse::CODE_STATUS = {
-    {200, "OK"},
-    {400, "Bad Request"},
-    {403, "Forbidden"},
-    {404, "Not Found"},
-    {500, "Internal Server Error"},
-};
+//状态码与预先拼好的状态行
+const char* HttpResponse::StatusLine_(int code, size_t* len) {
+#define STATUS_LINE(num, text) \
+    case num: *len = sizeof("HTTP/1.1 " #num " " text "\r\n") - 1; return "HTTP/1.1 " #num " " text "\r\n";
+    switch (code) {
+    STATUS_LINE(200, "OK")
+    STATUS_LINE(206, "Partial Content")
+    STATUS_LINE(304, "Not Modified")
+    STATUS_LINE(400, "Bad Request")
+    STATUS_LINE(403, "Forbidden")
+    STATUS_LINE(404, "Not Found")
+    STATUS_LINE(413, "Payload Too Large")
+    STATUS_LINE(416, "Range Not Satisfiable")
+    STATUS_LINE(500, "Internal Server Error")
+    STATUS_LINE(501, "Not Implemented")
+    STATUS_LINE(503, "Service Unavailable")
+    default: *len = 0; return nullptr;
+    }
+#undef STATUS_LINE
+}
+//状态信息（状态行去掉 "HTTP/1.1 xxx " 与结尾的 CRLF）
+std::string HttpResponse::StatusText_(int code) {
+    size_t len = 0;
+    const char* line = StatusLine_(code, &len);
+    if (!line) {
+        return "Bad Request";
+    }
+    return std::string(line + 13, len - 15);
+}
 //状态码与错误路径
 const std::unordered_map<int, std::string> HttpResponse::CODE_PATH = {
     {400, "/400.html"},
@@ -150,25 +618,3 @@ const std::unordered_map<int, std::string> HttpResponse::CODE_PATH = {
     {404, "/404.html"},
     {500, "/500.html"},
 };
-//后缀与文件类型
-const std::unordered_map<std::string, std::string> HttpResponse::SUFFIX_TYPE = {
-    {".html", "text/html"},
-    {".xml", "text/xml"},
-    {".xhtml", "application/xhtml+xml"},
-    {".txt", "text/plain"},
-    {".rtf", "application/rtf"},
-    {".pdf", "application/pdf"},
-    {".word", "application/msword"},
-    {".png", "image/png"},
-    {".gif", "image/gif"},
-    {".jpg", "image/jpeg"},
-    {".jpeg", "image/jpeg"},
-    {".au", "audio/basic"},
-    {".mpeg", "video/mpeg"},
-    {".mpg", "video/mpeg"}, 
-    {".avi", "video/x-msvideo"},
-    {".gz", "application/x-gzip"},
-    {".tar", "application/x-tar"},
-    {".css", "text/css"},
-    {".js", "text/javascript"},
-};
\ No newline at end of file
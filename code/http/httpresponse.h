@@ -2,46 +2,129 @@
 #define HTTP_RESPONSE_H
 
 #include <unordered_map>
+#include <vector>
 #include <fcntl.h>       // open
 #include <unistd.h>      // close
 #include <sys/stat.h>    // stat
 #include <sys/mman.h>    // mmap, munmap
+#include <strings.h>     // strcasecmp
 
 #include "../buffer/buffer.h"
 #include "../log/log.h"
+#include "filecache.h"
+
+// 响应正文中的一段文件内容：在 Buffer 中已写入 buffPos 字节（相对 MakeResponse 开始时）之后，
+// 发送文件 [offset, offset + len) 这段数据。整文件响应只有一段，多段 Range 响应每个分段一段。
+struct BodyPart {
+    size_t buffPos;
+    size_t offset;
+    size_t len;
+};
+
+// 未缓存的响应正文占用的资源：本次请求自行 mmap 的映射或 sendfile 用的 fd（缓存命中时正文就是 FileEntry 本身）。
+// 由 HttpResponse::ReleaseBody() 转交给发送队列，最后一个引用它的分段发送完（或连接关闭）时释放，
+// 这样同一个 HttpResponse 可以立即去生成下一个流水线请求的响应。
+struct ResponseBody {
+    ResponseBody() : mm(nullptr), mmLen(0), fd(-1) {}
+    ~ResponseBody() {
+        if (mm) { munmap(mm, mmLen); }
+        if (fd >= 0) { close(fd); }
+    }
+    ResponseBody(const ResponseBody&) = delete;
+    ResponseBody& operator=(const ResponseBody&) = delete;
+
+    char* mm;
+    size_t mmLen;
+    int fd;
+};
 
 class HttpResponse {
 public:
     HttpResponse();
     ~HttpResponse();
 
-    void Init(const std::string& srcDir, std::string& path, bool isKeepAlive = false, int code = -1);// 初始化
+    void Init(const char* srcDir, const std::string& path, bool isKeepAlive = false, int code = -1);// 初始化
+    void SetRange(const char* range) { range_.assign(range); }// 设置请求的 Range 头（Init 之后调用）
+    // 设置条件请求头 If-None-Match / If-Modified-Since（Init 之后调用，仅 GET 请求）
+    void SetConditional(const char* ifNoneMatch, const char* ifModifiedSince) {
+        ifNoneMatch_.assign(ifNoneMatch);
+        ifModifiedSince_.assign(ifModifiedSince);
+    }
+    // 设置请求的 Accept-Encoding 头（Init 之后调用，仅 GET 请求），用于选择 br / gzip 压缩变体
+    void SetAcceptEncoding(const char* acceptEncoding) { acceptEncoding_.assign(acceptEncoding); }
+    // 使用内存中生成的正文代替文件（Init 之后调用），例如 /metrics
+    void SetContent(const std::string& type, std::string body) {
+        hasContent_ = true;
+        contentType_ = type;
+        content_ = std::move(body);
+    }
     void MakeResponse(Buffer& buff);// 生成响应报文
-    void UnmapFile();// 解除文件映射
+    void UnmapFile();// 解除文件映射（或释放对缓存条目的引用）
+    // 转交正文资源（MakeResponse 之后调用）：缓存命中时是 FileEntry 的引用（不另外分配），
+    // 否则是持有映射/fd 的 ResponseBody；没有正文时返回 nullptr
+    std::shared_ptr<const void> ReleaseBody();
     char* File();// 获取文件地址
+    int FileFd() const { return fileFd_; }// 获取 sendfile 用的文件描述符（未使用 sendfile 时为 -1）
     size_t FileLen() const;// 获取文件长度
+    const std::vector<BodyPart>& Parts() const { return parts_; }// 需要发送的文件分段
     void ErrorContent(Buffer& buff, std::string message);// 将错误信息添加到响应报文
     int Code() const { return code_; }// 获取响应状态码
 
+    // 不进 FileCache 的大文件中，长度不小于该值的走 sendfile 零拷贝发送，其余按请求 mmap
+    static size_t sendfileThreshold;
+
 private:
+    // 响应头直接追加到 Buffer：状态行与 Connection 头是预先拼好的字面量，数字直接格式化到 BeginWrite()，
+    // Date 每个线程每秒格式化一次，整个过程不分配内存
     void AddStateLine_(Buffer &buff);
     void AddHeader_(Buffer &buff);
     void AddContent_(Buffer &buff);
+    static void AddDate_(Buffer &buff);
+    static void AppendNum_(Buffer &buff, uint64_t v);
+    static size_t FormatNum_(char* out, uint64_t v);    // 十进制写入 out（至少 20 字节），返回长度
+    size_t AddPartHead_(Buffer* buff, const char* type, size_t first, size_t last, size_t size) const;
 
     void ErrorHtml_();
-    std::string GetFileType_();
+    bool Stat_();
+    bool OpenFile_();
+    void ParseRange_();
+    bool IsNotModified_();
+    static bool MatchETag_(const std::string& list, const char* etag, size_t len);
+    void NegotiateEncoding_();
+    static double AcceptQ_(const std::string& list, const std::string& coding);
+    static bool IsCompressible_(const std::string& type);
+    void AddFileHeaders_(Buffer &buff, bool withLength);
+    const char* GetFileType_() const;
+    static const char* StatusLine_(int code, size_t* len);  // "HTTP/1.1 200 OK\r\n"，未知状态码返回 nullptr
+    static std::string StatusText_(int code);
 
     int code_;// 状态码
     bool isKeepAlive_;// 是否保持连接
 
     std::string path_;// 请求路径
     std::string srcDir_;// 站点根目录
+    std::string fullPath_;// srcDir_ + path_，Stat_ 时更新（复用容量，稳态不分配）
 
-    char* mmFile_; // mmap文件指针
+    std::shared_ptr<const FileEntry> file_; // 命中 FileCache 的文件（小文件）
+    char* mmFile_; // 未缓存的大文件：本次请求自行 mmap 的文件指针
+    int fileFd_;   // 超过 sendfileThreshold 的大文件：保持打开供 sendfile 使用
     struct stat mmFileStat_;// 文件状态
 
-    static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;  // 后缀类型集
-    static const std::unordered_map<int, std::string> CODE_STATUS;          // 编码状态集
+    std::string range_;     // 请求的 Range 头（为空表示整文件）
+    std::string ifNoneMatch_;       // 请求的 If-None-Match 头
+    std::string ifModifiedSince_;   // 请求的 If-Modified-Since 头
+    std::string acceptEncoding_;    // 请求的 Accept-Encoding 头
+    bool hasContent_;               // 正文由 SetContent 给出，不查找文件
+    std::string contentType_;
+    std::string content_;
+    bool vary_;             // 响应内容随 Accept-Encoding 变化（可压缩类型），需要输出 Vary
+    std::vector<std::pair<size_t, size_t>> ranges_;  // 解析后可满足的区间 [first, last]
+    std::vector<BodyPart> parts_;   // 本次响应要发送的文件分段
+    size_t buffStart_;      // MakeResponse 开始时 Buffer 中已有的可读字节数
+
+    static const size_t MAX_RANGES = 16;    // 单个请求允许的最多区间数，超过则忽略 Range
+    static const char* BOUNDARY;            // multipart/byteranges 的分隔符
+
     static const std::unordered_map<int, std::string> CODE_PATH;            // 编码路径集
 };
 
@@ -0,0 +1,252 @@
+#include "accesslog.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <errno.h>
+#include <algorithm>
+
+namespace {
+int64_t ClockNs(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// 每个线程记录当前段里已经写过字典记录的 pathId（直接映射，冲突时重复写一条字典记录，无害）
+struct SeenPaths {
+    static const size_t SIZE = 1024;
+    uint32_t seq = 0;
+    const void* seg = nullptr;
+    uint32_t ids[SIZE] = {0};
+};
+} // namespace
+
+AccessLog::AccessLog() : cur_(nullptr), segmentBytes_(DEFAULT_SEGMENT_BYTES), nextSeq_(0), wallOffset_(0) {}
+
+AccessLog::~AccessLog() {
+    Close();
+}
+
+AccessLog* AccessLog::Instance() {
+    static AccessLog inst;
+    return &inst;
+}
+
+bool AccessLog::Init(const char* dir, size_t segmentBytes) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (cur_.load() || !dir || !*dir) {
+        return false;
+    }
+    dir_ = dir;
+    for (size_t pos = dir_.find('/', 1); ; pos = dir_.find('/', pos + 1)) {    // 逐级创建
+        mkdir(dir_.substr(0, pos).c_str(), 0777);
+        if (pos == std::string::npos) {
+            break;
+        }
+    }
+    segmentBytes_ = std::max(segmentBytes, MIN_SEGMENT_BYTES) / ACCESS_RECORD_SIZE * ACCESS_RECORD_SIZE;
+    Segment* seg = OpenSegment_();
+    cur_.store(seg, std::memory_order_release);
+    return seg != nullptr;
+}
+
+void AccessLog::Close() {
+    std::lock_guard<std::mutex> locker(mtx_);
+    Segment* seg = cur_.exchange(nullptr);
+    if (seg) {
+        CloseSegment_(seg, true);
+    }
+    for (Segment* old : retired_) {
+        CloseSegment_(old, false);
+    }
+    retired_.clear();
+}
+
+// 在 dir_ 下新建一个段：预分配磁盘空间后整体映射，写入时不会再因为分配块而阻塞或 SIGBUS
+AccessLog::Segment* AccessLog::OpenSegment_() {
+    int64_t wallNs = ClockNs(CLOCK_REALTIME);
+    wallOffset_.store(wallNs - ClockNs(CLOCK_MONOTONIC), std::memory_order_relaxed);
+    time_t sec = static_cast<time_t>(wallNs / 1000000000);
+    struct tm t;
+    localtime_r(&sec, &t);
+    char name[256];
+    snprintf(name, sizeof(name), "%s/access-%04d%02d%02d-%02d%02d%02d-%d-%u.bin", dir_.c_str(),
+             t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, (int)getpid(), nextSeq_);
+
+    int fd = open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return nullptr;
+    }
+    char* base = nullptr;
+    if (posix_fallocate(fd, 0, segmentBytes_) == 0) {
+        void* addr = mmap(nullptr, segmentBytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        base = addr == MAP_FAILED ? nullptr : static_cast<char*>(addr);
+    }
+    close(fd);
+    if (!base) {
+        unlink(name);
+        return nullptr;
+    }
+    AccessLogHeader header = {};
+    memcpy(header.magic, ACCESS_LOG_MAGIC, sizeof(header.magic));
+    header.version = ACCESS_LOG_VERSION;
+    header.recordSize = ACCESS_RECORD_SIZE;
+    header.createdNs = wallNs;
+    header.pid = getpid();
+    header.seq = nextSeq_;
+    memcpy(base, &header, sizeof(header));
+
+    Segment* seg = new Segment;
+    seg->base = base;
+    seg->size = segmentBytes_;
+    seg->next.store(sizeof(header), std::memory_order_relaxed);
+    seg->seq = nextSeq_++;
+    seg->path = name;
+    seg->writers.store(0, std::memory_order_relaxed);
+    seg->retired.store(false, std::memory_order_relaxed);
+    seg->unmapped.store(false, std::memory_order_relaxed);
+    return seg;
+}
+
+void AccessLog::Unmap_(Segment* seg) {
+    if (!seg->unmapped.exchange(true)) {
+        munmap(seg->base, seg->size);
+    }
+}
+
+// 写者计数与 retired 标志都用 seq_cst：写者先加计数再看 retired，换段先置 retired 再看计数，
+// 两边至少有一边看到对方，映射不会在写者还在用时解除
+bool AccessLog::Enter_(Segment* seg) {
+    seg->writers.fetch_add(1);
+    if (seg->retired.load()) {
+        Leave_(seg);
+        return false;
+    }
+    return true;
+}
+
+void AccessLog::Leave_(Segment* seg) {
+    if (seg->writers.fetch_sub(1) == 1 && seg->retired.load()) {
+        Unmap_(seg);
+    }
+}
+
+// 调用时已没有写者。truncate：截掉预分配但没有用到的部分（写满换下的段不需要）
+void AccessLog::CloseSegment_(Segment* seg, bool truncate) {
+    size_t used = std::min(seg->next.load(), seg->size);
+    Unmap_(seg);
+    if (truncate && ::truncate(seg->path.c_str(), static_cast<off_t>(used)) != 0) {
+        // 截断失败只是多占磁盘，解码时末尾的空白记录会被跳过
+    }
+    delete seg;
+}
+
+void AccessLog::Rotate_(Segment* full) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (cur_.load(std::memory_order_relaxed) != full) {
+        return;     // 其他线程已经换过段（或已关闭）
+    }
+    // 新段创建失败（例如磁盘满）时停止记录，不影响请求处理
+    cur_.store(OpenSegment_(), std::memory_order_release);
+    retired_.push_back(full);
+    full->retired.store(true);
+    if (full->writers.load() == 0) {
+        Unmap_(full);   // 否则由最后一个离开的写者解除
+    }
+}
+
+// 先写数据、最后以 release 写 type：解码时 type 非 0 的记录内容完整
+void AccessLog::Commit_(char* slot, const void* rec, uint8_t type) {
+    memcpy(slot + 1, static_cast<const char*>(rec) + 1, ACCESS_RECORD_SIZE - 1);
+    __atomic_store_n(reinterpret_cast<uint8_t*>(slot), type, __ATOMIC_RELEASE);
+}
+
+bool AccessLog::EnsurePath_(Segment* seg, uint32_t id, const char* path, size_t len) {
+    static thread_local SeenPaths seen;
+    if (seen.seg != seg || seen.seq != seg->seq) {
+        memset(seen.ids, 0, sizeof(seen.ids));
+        seen.seg = seg;
+        seen.seq = seg->seq;
+    }
+    uint32_t& slotId = seen.ids[id % SeenPaths::SIZE];
+    if (slotId == id) {
+        return true;
+    }
+    char* slot = Reserve_(seg);
+    if (!slot) {
+        return false;
+    }
+    AccessPathRecord rec = {};
+    rec.len = static_cast<uint8_t>(std::min(len, AccessPathRecord::PATH_MAX_LEN));
+    rec.pathId = id;
+    memcpy(rec.path, path, rec.len);
+    Commit_(slot, &rec, ACCESS_RECORD_PATH);
+    slotId = id;
+    return true;
+}
+
+void AccessLog::Append(AccessRecord& rec, int64_t monoNs, const char* path, size_t pathLen) {
+    rec.pathId = PathId(path, pathLen);
+    rec.timeNs = monoNs + wallOffset_.load(std::memory_order_relaxed);
+    // 字典记录与请求记录必须落在同一个段里：段写满就换段重来
+    for (int retry = 0; retry < 3; retry++) {
+        Segment* seg = cur_.load(std::memory_order_acquire);
+        if (!seg) {
+            return;
+        }
+        if (!Enter_(seg)) {
+            continue;   // 读到 cur_ 之后这个段已被换下
+        }
+        char* slot = nullptr;
+        bool ok = EnsurePath_(seg, rec.pathId, path, pathLen) && (slot = Reserve_(seg));
+        if (ok) {
+            Commit_(slot, &rec, ACCESS_RECORD_REQUEST);
+        }
+        Leave_(seg);
+        if (ok) {
+            return;
+        }
+        Rotate_(seg);
+    }
+}
+
+uint8_t AccessLog::MethodCode(const char* method, size_t len) {
+    switch (len) {
+    case 3:
+        if (!memcmp(method, "GET", 3)) { return ACCESS_METHOD_GET; }
+        if (!memcmp(method, "PUT", 3)) { return ACCESS_METHOD_PUT; }
+        break;
+    case 4:
+        if (!memcmp(method, "POST", 4)) { return ACCESS_METHOD_POST; }
+        if (!memcmp(method, "HEAD", 4)) { return ACCESS_METHOD_HEAD; }
+        break;
+    case 5:
+        if (!memcmp(method, "PATCH", 5)) { return ACCESS_METHOD_PATCH; }
+        break;
+    case 6:
+        if (!memcmp(method, "DELETE", 6)) { return ACCESS_METHOD_DELETE; }
+        break;
+    case 7:
+        if (!memcmp(method, "OPTIONS", 7)) { return ACCESS_METHOD_OPTIONS; }
+        break;
+    default:
+        break;
+    }
+    return ACCESS_METHOD_OTHER;
+}
+
+const char* AccessLog::MethodName(uint8_t code) {
+    static const char* const NAMES[] = {"-", "GET", "POST", "HEAD", "PUT", "DELETE", "OPTIONS", "PATCH"};
+    return code < sizeof(NAMES) / sizeof(NAMES[0]) ? NAMES[code] : "-";
+}
+
+uint32_t AccessLog::PathId(const char* path, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ static_cast<uint8_t>(path[i])) * 16777619u;
+    }
+    return h ? h : 1;   // 0 在 SeenPaths 中表示空位
+}
@@ -0,0 +1,142 @@
+#ifndef ACCESS_LOG_H
+#define ACCESS_LOG_H
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * 二进制访问日志：与 Log 分开的一条通道，每个请求一条定长记录，不做任何格式化
+ *  - 记录写进预分配（posix_fallocate）并 mmap 的段文件，写入 = 段写者计数的进出 + 一次 fetch_add 占位 + 64 字节拷贝，
+ *    多个 Reactor/worker 线程并发写不加锁；段写满时才加锁换新段（默认 256MB 一段，约 400 万条）
+ *  - 段文件：dir/access-<YYYYmmdd-HHMMSS>-<pid>-<seq>.bin，开头是 AccessLogHeader，之后是记录；
+ *    关闭时截断到实际长度，进程崩溃时末尾是预分配的 0（type 为 0 的记录解码时跳过）
+ *  - 路径不进请求记录：记录里只放路径的 32 位哈希 pathId，每个线程在每个段中第一次遇到某个路径时
+ *    先写一条 ACCESS_RECORD_PATH 字典记录，段文件可以单独解码（解码工具：tools/accesslog_decode）
+ * 记录格式变化时增加 ACCESS_LOG_VERSION。
+ */
+enum ACCESS_RECORD_TYPE : uint8_t {
+    ACCESS_RECORD_NONE = 0,     // 预分配的空白或未写完的记录
+    ACCESS_RECORD_REQUEST = 1,
+    ACCESS_RECORD_PATH = 2,
+};
+
+enum ACCESS_METHOD : uint8_t {
+    ACCESS_METHOD_OTHER, ACCESS_METHOD_GET, ACCESS_METHOD_POST, ACCESS_METHOD_HEAD,
+    ACCESS_METHOD_PUT, ACCESS_METHOD_DELETE, ACCESS_METHOD_OPTIONS, ACCESS_METHOD_PATCH,
+};
+
+enum ACCESS_FLAG : uint16_t {
+    ACCESS_FLAG_KEEP_ALIVE = 1,
+};
+
+struct AccessRecord {
+    uint8_t type;           // ACCESS_RECORD_REQUEST，最后写入
+    uint8_t method;         // ACCESS_METHOD
+    uint16_t status;
+    uint16_t peerPort;      // 主机字节序
+    uint16_t flags;         // ACCESS_FLAG
+    uint32_t peerAddr;      // IPv4，网络字节序
+    int32_t fd;
+    int64_t timeNs;         // 响应生成的时间（CLOCK_REALTIME，纳秒）
+    uint64_t bytes;         // 响应字节数（状态行 + 头部 + 正文）
+    uint64_t bodyBytes;     // 请求体字节数
+    uint32_t latencyUs;     // 从开始解析请求到响应进入发送队列
+    uint32_t pathId;
+    uint8_t reserved[16];
+};
+
+struct AccessPathRecord {
+    uint8_t type;           // ACCESS_RECORD_PATH，最后写入
+    uint8_t len;            // path 的长度（超过 PATH_MAX_LEN 时截断）
+    uint16_t reserved;
+    uint32_t pathId;
+    char path[56];          // 不以 '\0' 结尾
+
+    static const size_t PATH_MAX_LEN = sizeof(path);
+};
+
+struct AccessLogHeader {
+    char magic[8];          // ACCESS_LOG_MAGIC
+    uint32_t version;
+    uint32_t recordSize;
+    int64_t createdNs;      // CLOCK_REALTIME，纳秒
+    int32_t pid;
+    uint32_t seq;           // 本进程的第几个段
+    uint8_t reserved[32];
+};
+
+static const char ACCESS_LOG_MAGIC[8] = {'T', 'W', 'S', 'A', 'L', 'O', 'G', '\0'};
+static const uint32_t ACCESS_LOG_VERSION = 1;
+static const size_t ACCESS_RECORD_SIZE = 64;
+static_assert(sizeof(AccessRecord) == ACCESS_RECORD_SIZE, "AccessRecord must be 64 bytes");
+static_assert(sizeof(AccessPathRecord) == ACCESS_RECORD_SIZE, "AccessPathRecord must be 64 bytes");
+static_assert(sizeof(AccessLogHeader) == ACCESS_RECORD_SIZE, "AccessLogHeader must be 64 bytes");
+
+class AccessLog {
+public:
+    static AccessLog* Instance();
+
+    // 打开访问日志：dir 不存在时创建；segmentBytes 为每个段文件的大小（向下取整到记录大小）
+    bool Init(const char* dir, size_t segmentBytes);
+    // 截断并关闭当前段。调用时不能再有线程在 Append（WebServer 在停止所有线程后调用）
+    void Close();
+
+    bool IsOpen() const { return cur_.load(std::memory_order_relaxed) != nullptr; }
+
+    // 写一条请求记录：填好除 type、timeNs、pathId 以外的字段，monoNs 为 Metrics::Now() 的时间
+    void Append(AccessRecord& rec, int64_t monoNs, const char* path, size_t pathLen);
+
+    static uint8_t MethodCode(const char* method, size_t len);
+    static const char* MethodName(uint8_t code);
+    static uint32_t PathId(const char* path, size_t len);   // FNV-1a，不会返回 0
+
+    static const size_t DEFAULT_SEGMENT_BYTES = 256 * 1024 * 1024;
+    static const size_t MIN_SEGMENT_BYTES = 64 * 1024;
+
+private:
+    AccessLog();
+    ~AccessLog();
+
+    struct Segment {
+        char* base;
+        size_t size;
+        std::atomic<size_t> next;   // 下一条记录的偏移（可能超过 size，表示已写满）
+        uint32_t seq;
+        std::string path;
+        // 正在写这个段的线程数；换下后 retired 置位，最后一个写者离开时（或换段时已没有写者）解除映射
+        std::atomic<int> writers;
+        std::atomic<bool> retired;
+        std::atomic<bool> unmapped;
+    };
+
+    // 在 seg 中占一个位置，写满时返回 nullptr
+    static char* Reserve_(Segment* seg) {
+        size_t off = seg->next.fetch_add(ACCESS_RECORD_SIZE, std::memory_order_relaxed);
+        return off + ACCESS_RECORD_SIZE <= seg->size ? seg->base + off : nullptr;
+    }
+    static void Commit_(char* slot, const void* rec, uint8_t type);
+    // 开始/结束写 seg：Enter_ 返回 false 表示 seg 已被换下（映射可能已解除），应重新读 cur_
+    static bool Enter_(Segment* seg);
+    static void Leave_(Segment* seg);
+    static void Unmap_(Segment* seg);
+    bool EnsurePath_(Segment* seg, uint32_t id, const char* path, size_t len);  // seg 写满时返回 false
+    Segment* OpenSegment_();
+    void CloseSegment_(Segment* seg, bool truncate);
+    void Rotate_(Segment* full);
+
+    std::mutex mtx_;                    // 只保护换段与 Init/Close
+    std::atomic<Segment*> cur_;
+    // 换下来的段：映射按写者计数解除，但刚读到 cur_ 还没进入 Enter_ 的线程仍持有指针，
+    // 所以 Segment 本身保留到 Close（每个段只占几十字节）
+    std::vector<Segment*> retired_;
+    std::string dir_;
+    size_t segmentBytes_;
+    uint32_t nextSeq_;
+    std::atomic<int64_t> wallOffset_;   // CLOCK_REALTIME - CLOCK_MONOTONIC，每次换段时重新校准
+};
+
+#endif //ACCESS_LOG_H
@@ -1,93 +1,150 @@
 #include "log.h"
-// 构造函数：初始化成员变量的默认值
+#include <ctype.h>
+
+// 单生产者（所属线程）单消费者（后台线程）的字节环形缓冲区
+// 每条记录为 4 字节长度 + 内容，按 4 字节对齐；尾部放不下时写一个 WRAP 标记并从头开始
+struct LogRing {
+    explicit LogRing(size_t cap) : buf(new char[cap]), cap(cap), head(0), tail(0), retired(false) {}
+
+    static const uint32_t WRAP = 0xFFFFFFFFu;
+
+    std::unique_ptr<char[]> buf;
+    const size_t cap;               // 2 的幂
+    std::atomic<size_t> head;       // 生产者写位置（单调递增）
+    char pad_[64];                  // head 与 tail 分属不同缓存行
+    std::atomic<size_t> tail;       // 消费者读位置（单调递增）
+    std::atomic<bool> retired;      // 所属线程已退出，读空后移除
+};
+
+namespace {
+// 线程退出时把环形缓冲区标记为退役，由后台线程写完剩余数据后释放
+struct RingHolder {
+    std::shared_ptr<LogRing> ring;
+    ~RingHolder() {
+        if (ring) { ring->retired = true; }
+    }
+};
+
+// 线程本地的时间前缀缓存：同一秒内只格式化微秒部分
+struct TimeCache {
+    time_t sec = -1;
+    char text[32];      // "YYYY-MM-DD HH:MM:SS"
+    size_t len = 0;
+};
+
+inline size_t Align4(size_t n) { return (n + 3) & ~static_cast<size_t>(3); }
+
+const char* LevelTitle(int level) {
+    switch (level) {
+    case 0: return "[debug]: ";
+    case 1: return "[info] : ";
+    case 2: return "[warn] : ";
+    case 3: return "[error]: ";
+    default: return "[info] : ";
+    }
+}
+}
 
+// 构造函数：初始化成员变量的默认值
 Log::Log(){
     lineCount_ = 0;      // 当前日志文件已写入的行数
     isOpen_ = false;     // 日志是否已打开（默认未打开）
     level_ = 1;          // 日志默认等级（可由 init 覆盖）
-    toDay_ = 0;          // 记录当前日志文件对应的日期（目前仅记录日-of-month）
+    toDay_ = 0;          // 当前日志文件对应的日期（yyyymmdd）
     fp_ = nullptr;       // 文件指针，尚未打开
-    path_ = nullptr;     // 日志目录路径（指针形式，注意生命周期问题）
-    suffix_ = nullptr;   // 日志后缀（指针形式）
     MAX_LINES_ = MAX_LINES; // 每个日志文件最大行数（默认常量）
     isAsync_ = false;    // 是否异步写日志（默认为 false）
+    blockWhenFull_ = false;
+    ringBytes_ = 0;
+    wake_ = false;
+    closing_ = false;
+    flushRequested_ = false;
+    dropped_ = 0;
+    reportedDropped_ = 0;
+    cachedSec_ = -1;
+    cachedTimeLen_ = 0;
 }
 
-// 析构函数：程序结束或 Logger 被销毁时需要清理资源
+// 析构函数：通知后台线程写完所有缓冲区后退出，再关闭文件
 Log::~Log(){
-    // 如果存在后台写线程并且可 join，则进行关闭流程
     if (writeThread_ && writeThread_->joinable()) {
-        // 试图让后台线程把队列剩余的任务处理完
-        while (!deque_->empty()) {
-            deque_->flush(); // 唤醒消费者（write 线程）处理队列中的任务
+        {
+            std::lock_guard<std::mutex> locker(wakeMtx_);
+            closing_ = true;
         }
-        deque_->Close();      // 关闭阻塞队列，通知 pop 的线程尽快返回
-        writeThread_->join(); // 等待写线程退出
+        wakeCond_.notify_one();
+        writeThread_->join();
     }
-
-    // 关闭并释放日志文件
+    std::lock_guard<std::mutex> locker(mtx_);
     if (fp_) {
-        std::lock_guard<std::mutex> locker(mtx_); // 加锁保护文件操作
-        flush();    // 把缓冲刷入磁盘
-        fclose(fp_); // 关闭文件流
+        Drain_();
+        fflush(fp_);
+        fclose(fp_);
+        fp_ = nullptr;
     }
 }
 
 // 初始化日志系统：设置路径、后缀、是否异步、启动写线程并打开文件
-void Log::init(int level, const char* path, const char* suffix, int maxQueueCapacity) {
-    isOpen_ = true;
+void Log::init(int level, const char* path, const char* suffix, int maxQueueCapacity, bool blockWhenFull) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (fp_) {
+        Drain_();       // 之前缓冲的日志写入旧文件
+    }
     level_ = level;
-    path_ = path;       // 注意：这里直接保存传入的指针，若 path 是临时字符串会产生悬空指针风险
-    suffix_ = suffix;   // 推荐改为 std::string 保存副本以保证安全
+    path_ = path;
+    suffix_ = suffix;
+    blockWhenFull_ = blockWhenFull;
 
-    // 如果指定了队列容量 > 0，则启用异步模式
+    // 如果指定了队列容量 > 0，则启用异步模式；容量按行数换算为每线程缓冲区字节数（取 2 的幂）
     if (maxQueueCapacity > 0) {
-        isAsync_ = true;
-        if (!deque_) {
-            // 创建阻塞队列（容量为 maxQueueCapacity）
-            std::unique_ptr<BlockQueue<std::string>> new_deque(new BlockQueue<std::string>(maxQueueCapacity));
-            deque_ = std::move(new_deque);
-
-            // 创建并启动写线程，线程函数为静态 FlushLogThread
-            std::unique_ptr<std::thread> new_thread(new std::thread(FlushLogThread));
-            writeThread_ = std::move(new_thread);
+        size_t bytes = 64 * 1024;
+        while (bytes < static_cast<size_t>(maxQueueCapacity) * AVG_LINE_LEN) {
+            bytes <<= 1;
+        }
+        if (!writeThread_) {
+            ringBytes_ = bytes;     // 已创建的缓冲区沿用原大小
+            writeThread_.reset(new std::thread(FlushLogThread));
         }
+        isAsync_ = true;
     }
     else {
         isAsync_ = false;
     }
 
     lineCount_ = 0;
-
-    // 获取本地时间（注意 localtime 非线程安全）
     time_t timer = time(nullptr);
-    struct tm *sysTime = localtime(&timer); // 非线程安全版本，建议使用 localtime_r
-    struct tm t = *sysTime;                 // 这里把结果拷贝到局部变量 t，避免后续被覆盖
+    struct tm t;
+    localtime_r(&timer, &t);
+    OpenFile_(t, 0);
+    isOpen_ = true;
+}
 
-    // 生成日志文件名： path/YYYY_MM_DD + suffix
+// 打开 path/YYYY_MM_DD[-part]suffix，目录不存在时先创建
+void Log::OpenFile_(const struct tm& t, int part) {
     char fileName[LOG_PATH_LEN] = {0};
-    snprintf(fileName, LOG_PATH_LEN - 1, "%s/%04d_%02d_%02d%s",
-             path_, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, suffix_);
-    
-    toDay_ = t.tm_mday; // 仅记录日-of-month（存在跨月/跨年判断错误的隐患）
-
-    {
-        // 打开文件、或创建目录后打开（用锁保护文件打开操作）
-        std::lock_guard<std::mutex> locker(mtx_);
-        if (fp_) {
-            flush();
-            fclose(fp_);
-        }
+    if (part == 0) {
+        snprintf(fileName, LOG_PATH_LEN - 1, "%s/%04d_%02d_%02d%s",
+                 path_.c_str(), t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, suffix_.c_str());
+    } else {
+        snprintf(fileName, LOG_PATH_LEN - 1, "%s/%04d_%02d_%02d-%d%s",
+                 path_.c_str(), t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, part, suffix_.c_str());
+    }
+    toDay_ = (t.tm_year + 1900) * 10000 + (t.tm_mon + 1) * 100 + t.tm_mday;
 
-        fp_ = fopen(fileName, "a"); // 以追加方式打开
-        if (fp_ == nullptr) {
-            // 如果打开失败，尝试创建目录（**注意**：这里传入的是 fileName 的目录部分应为 path_，
-            // 但原代码对 path_ 做 mkdir，需要确保 path_ 指向目录而不是带文件名的字符串）
-            mkdir(path_, 0777);      // 仅在目录不存在时调用（此处没有检测返回值）
-            fp_ = fopen(fileName, "a"); // 再次尝试打开
-        }
-        assert(fp_ != nullptr); // 调试断言：文件打开失败则程序中断；生产环境建议做更稳健的错误处理
+    if (fp_) {
+        fflush(fp_);
+        fclose(fp_);
+    }
+    fp_ = fopen(fileName, "a"); // 以追加方式打开
+    if (fp_ == nullptr) {
+        mkdir(path_.c_str(), 0777);
+        fp_ = fopen(fileName, "a");
+    }
+    assert(fp_ != nullptr);
+    if (!fileBuff_) {
+        fileBuff_.reset(new char[FILE_BUFF_SIZE]);
     }
+    setvbuf(fp_, fileBuff_.get(), _IOFBF, FILE_BUFF_SIZE);  // 大缓冲：一次 write 写出一批日志
 }
 
 // 懒汉式单例：局部静态对象（C++11 起局部静态变量初始化是线程安全的）
@@ -101,130 +158,381 @@ void Log::FlushLogThread() {
     Log::Instance()->AsyncWrite_();
 }
 
-// 异步写日志线程函数：不断从队列 pop 日志并写入文件
+// 后台线程：每 POLL_INTERVAL_MS（或被唤醒时）取出所有缓冲区的数据写入文件，每 FLUSH_INTERVAL_MS 刷盘一次
 void Log::AsyncWrite_() {
-    std::string str = "";
-    // pop() 返回 false 表示队列关闭或退出条件；循环直到无法再 pop 为止
-    while (deque_->pop(str)) {
-        std::lock_guard<std::mutex> locker(mtx_); // 写文件要保护 fp_
-        fputs(str.c_str(), fp_); // 将字符串写入文件（未做错误检查）
-        // 注意：这里没有对 lineCount_、切文件等逻辑进行处理，可能需要在此处增加文件滚动逻辑
+    typedef std::chrono::steady_clock SteadyClock;
+    SteadyClock::time_point lastFlush = SteadyClock::now();
+    while (true) {
+        bool closing;
+        {
+            std::unique_lock<std::mutex> locker(wakeMtx_);
+            if (!wake_ && !closing_) {
+                wakeCond_.wait_for(locker, std::chrono::milliseconds(POLL_INTERVAL_MS));
+            }
+            wake_ = false;
+            closing = closing_;
+        }
+        std::lock_guard<std::mutex> locker(mtx_);
+        while (Drain_()) {
+        }
+        SteadyClock::time_point now = SteadyClock::now();
+        if (fp_ && (flushRequested_.exchange(false) || closing ||
+                    now - lastFlush >= std::chrono::milliseconds(FLUSH_INTERVAL_MS))) {
+            fflush(fp_);
+            lastFlush = now;
+        }
+        if (closing) {
+            break;
+        }
     }
 }
 
-// 将输出内容整理为日志条并写入（或入队）
+LogRing* Log::LocalRing_() {
+    static thread_local RingHolder holder;
+    if (!holder.ring) {
+        holder.ring = std::make_shared<LogRing>(ringBytes_);
+        std::lock_guard<std::mutex> locker(ringsMtx_);
+        rings_.push_back(holder.ring);
+    }
+    return holder.ring.get();
+}
+
+// 格式化一行：缓存的时间前缀 + 微秒 + 级别 + 内容 + 换行，返回长度
+size_t Log::FormatLine_(char* line, int level, const char* format, va_list ap) {
+    static thread_local TimeCache cache;
+    struct timeval now = {0, 0};
+    gettimeofday(&now, nullptr);
+    if (now.tv_sec != cache.sec) {
+        struct tm t;
+        localtime_r(&now.tv_sec, &t);
+        cache.len = strftime(cache.text, sizeof(cache.text), "%Y-%m-%d %H:%M:%S", &t);
+        cache.sec = now.tv_sec;
+    }
+    size_t n = cache.len;
+    memcpy(line, cache.text, n);
+    n += snprintf(line + n, 16, ".%06ld ", static_cast<long>(now.tv_usec));
+    memcpy(line + n, LevelTitle(level), 9);
+    n += 9;
+    int m = vsnprintf(line + n, MAX_LINE_LEN - n - 1, format, ap);
+    if (m > 0) {
+        n += std::min(static_cast<size_t>(m), MAX_LINE_LEN - n - 2);   // 超长截断
+    }
+    line[n++] = '\n';
+    return n;
+}
+
+// 将输出内容整理为日志条并写入本线程的缓冲区（同步模式直接写文件）
 void Log::write(int level, const char *format, ...) {
-    // 获取当前时间（精确到微秒）
+    char rec[MAX_LINE_LEN + 1];
+    rec[0] = static_cast<char>(LOG_TEXT);
+    va_list valst;
+    va_start(valst, format);
+    size_t len = FormatLine_(rec + 1, level, format, valst);
+    va_end(valst);
+    Push_(rec, len + 1);
+}
+
+// 补上时间戳后提交一条延迟格式化的记录
+void Log::Commit_(int level, const char* format, LogEncoder& enc) {
     struct timeval now = {0, 0};
     gettimeofday(&now, nullptr);
-    time_t tSec = now.tv_sec;
-    struct tm *sysTime = localtime(&tSec); // 非线程安全，建议 localtime_r
-    struct tm t = *sysTime;                // 拷贝一份，避免后续被覆盖
-    va_list valst;                         // 可变参数列表
+    LogRecordHead head;
+    head.kind = LOG_DEFERRED;
+    head.level = static_cast<uint8_t>(level);
+    head.argc = enc.Argc();
+    head.usec = static_cast<int32_t>(now.tv_usec);
+    head.sec = now.tv_sec;
+    head.format = format;
+    memcpy(enc.Data(), &head, sizeof(head));
+    Push_(enc.Data(), enc.Size());
+}
 
-    // 第一段：检查是否需要滚动日志文件（按天或按行）
-    {
-        std::lock_guard<std::mutex> locker(mtx_); // 加锁检查/切换文件，防止并发修改 fp_ 等
-        // 日志不是今天，或行数达到阈值时需要切文件
-        if (toDay_ != t.tm_mday || (lineCount_ && (lineCount_ % MAX_LINES_ == 0))) {
-            char newFile[LOG_PATH_LEN];
-            char tail[36] = {0};
-            // tail 使用 toDay_ 的拆分（注意 toDay_ 存储格式决定拆分方式）
-            snprintf(tail, 36, "%s.%04d_%02d_%02d%s",
-                     path_, toDay_ / 10000, toDay_ % 10000 / 100, toDay_ % 100, suffix_);
-            if(toDay_ != t.tm_mday) {
-                // 新的一天：用新的文件名
-                snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s%s", path_, tail, suffix_);
-                toDay_ = t.tm_mday;
-                lineCount_ = 0;
-            }
-            else {
-                // 按行数滚动：生成带序号的文件名
-                snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s.%d%s", path_, tail, (lineCount_ / MAX_LINES_), suffix_);
-            }
-            // 把缓冲刷入磁盘并切换文件
-            flush();
-            fclose(fp_);
-            fp_ = fopen(newFile, "a");
-            assert(fp_ != nullptr);
-            // 注意：此处没有对 fopen 失败做充分处理（仅 assert），生产环境应当有容错
+// 写入本线程的环形缓冲区：不加锁，只在跨过半满或缓冲区满时唤醒后台线程
+void Log::Push_(const char* rec, size_t len) {
+    if (!isAsync_) {
+        std::lock_guard<std::mutex> locker(mtx_);
+        Emit_(rec, len);
+        fflush(fp_);
+        return;
+    }
+
+    LogRing* ring = LocalRing_();
+    const size_t need = Align4(4 + len);
+    const size_t mask = ring->cap - 1;
+    size_t head = ring->head.load(std::memory_order_relaxed);
+    size_t pos = head & mask;
+    size_t skip = (ring->cap - pos < need) ? ring->cap - pos : 0;   // 尾部放不下，跳到开头
+    size_t used;
+    while ((used = head - ring->tail.load(std::memory_order_acquire)) + skip + need > ring->cap) {
+        if (!blockWhenFull_) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            Wake_();
+            return;
         }
+        Wake_();
+        std::this_thread::yield();  // 等待后台线程腾出空间
     }
+    char* buf = ring->buf.get();
+    if (skip) {
+        uint32_t wrap = LogRing::WRAP;
+        memcpy(buf + pos, &wrap, 4);
+        head += skip;
+        pos = 0;
+    }
+    uint32_t len32 = static_cast<uint32_t>(len);
+    memcpy(buf + pos, &len32, 4);
+    memcpy(buf + pos + 4, rec, len);
+    ring->head.store(head + need, std::memory_order_release);
+    // 跨过半满时唤醒后台线程，平时由它定时轮询
+    if (used < ring->cap / 2 && used + skip + need >= ring->cap / 2) {
+        Wake_();
+    }
+}
 
-    // 第二段：格式化日志内容并写入 buffer 或队列
-    {
-        std::lock_guard<std::mutex> locker(mtx_); // 持锁保护 buff_ 与 fp_ 的并发访问
+void Log::Emit_(const char* rec, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    if (rec[0] == LOG_TEXT) {
+        WriteLine_(rec + 1, len - 1);
+        return;
+    }
+    char line[MAX_LINE_LEN];
+    WriteLine_(line, Decode_(rec, len, line));
+}
 
-        lineCount_++; // 增加行计数（注意：此处是提前增加，如果后续写入失败计数会不准确）
+// 按 format 格式化延迟记录：逐个转换符取出参数，统一成 long long / double / char* 再交给 snprintf。
+// 长度修饰符按参数实际宽度重写（h/hh 保留截断语义）；类型与转换符不符或参数不足时按参数类型/原样输出。
+size_t Log::Decode_(const char* rec, size_t len, char* line) {
+    LogRecordHead head;
+    memcpy(&head, rec, sizeof(head));
+    if (head.sec != cachedSec_) {
+        struct tm t;
+        time_t sec = static_cast<time_t>(head.sec);
+        localtime_r(&sec, &t);
+        cachedTimeLen_ = strftime(cachedTime_, sizeof(cachedTime_), "%Y-%m-%d %H:%M:%S", &t);
+        cachedSec_ = head.sec;
+    }
+    const size_t cap = MAX_LINE_LEN - 1;    // 留一个字节给换行
+    size_t n = cachedTimeLen_;
+    memcpy(line, cachedTime_, n);
+    n += snprintf(line + n, 16, ".%06ld ", static_cast<long>(head.usec));
+    memcpy(line + n, LevelTitle(head.level), 9);
+    n += 9;
 
-        // 写入时间前缀到缓冲区（假定缓冲区有至少 48 字节可写）
-        int n = snprintf(buff_.BeginWrite(), 48, "%04d-%02d-%02d %02d:%02d:%02d.%06ld ",
-                         t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
-                         t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);
-        buff_.HasWritten(n); // 推进写位置
-        AppendLogLevelTitle_(level); // 追加日志级别字符串（比如 [info]）
+    const char* arg = rec + sizeof(head);
+    const char* argEnd = rec + len;
+    int argLeft = head.argc;
+    // 取下一个参数：type 为其类型，成功时 arg 推进到下一个参数
+    auto next = [&](uint8_t& type, int64_t& i, uint64_t& u, double& d, const char*& str, uint32_t& slen) {
+        if (argLeft <= 0 || arg >= argEnd) { return false; }
+        type = static_cast<uint8_t>(*arg++);
+        switch (type) {
+        case LOG_ARG_INT: memcpy(&i, arg, 8); arg += 8; break;
+        case LOG_ARG_UINT: case LOG_ARG_PTR: memcpy(&u, arg, 8); arg += 8; break;
+        case LOG_ARG_DOUBLE: memcpy(&d, arg, 8); arg += 8; break;
+        default: memcpy(&slen, arg, 4); str = arg + 4; arg += 4 + slen; break;
+        }
+        argLeft--;
+        return true;
+    };
+    auto append = [&](int m) {
+        if (m > 0) { n += std::min(static_cast<size_t>(m), cap - n - 1); }
+    };
 
-        // 格式化可变参数（日志内容）写入 buffer 的可写区域
-        va_start(valst, format);
-        int m = vsnprintf(buff_.BeginWrite(), buff_.WritableBytes(), format, valst);
-        va_end(valst);
-        buff_.HasWritten(m); // 推进写位置（注意：若 m 大于 WritableBytes，表示被截断，应检查并处理）
+    for (const char* p = head.format; *p && n + 1 < cap; p++) {
+        if (*p != '%') {
+            line[n++] = *p;
+            continue;
+        }
+        if (p[1] == '%') {
+            line[n++] = '%';
+            p++;
+            continue;
+        }
+        // 解析 %[flags][width][.precision][length]conv
+        const char* start = p++;
+        char spec[32];
+        size_t sl = 0;
+        spec[sl++] = '%';
+        bool ok = true;
+        while (*p && strchr("-+ #0", *p)) { if (sl < 20) spec[sl++] = *p; p++; }
+        for (int part = 0; part < 2 && ok; part++) {     // 宽度、精度（支持 *）
+            if (part == 1) {
+                if (*p != '.') { break; }
+                if (sl < 20) spec[sl++] = *p;
+                p++;
+            }
+            if (*p == '*') {
+                uint8_t t = LOG_ARG_INT; int64_t i = 0; uint64_t u = 0; double d; const char* str; uint32_t slen;
+                ok = next(t, i, u, d, str, slen);
+                sl += snprintf(spec + sl, sizeof(spec) - sl, "%d",
+                               static_cast<int>(t == LOG_ARG_INT ? i : static_cast<int64_t>(u)) % 1000);
+                p++;
+            } else {
+                while (isdigit(static_cast<unsigned char>(*p))) { if (sl < 20) spec[sl++] = *p; p++; }
+            }
+        }
+        int shortness = 0;      // 1: h, 2: hh
+        while (*p && strchr("hlLqjzt", *p)) {
+            if (*p == 'h') { shortness++; }
+            p++;
+        }
+        const char conv = *p;
+        uint8_t type; int64_t i = 0; uint64_t u = 0; double d = 0; const char* str = nullptr; uint32_t slen = 0;
+        if (!conv || !ok || !next(type, i, u, d, str, slen)) {
+            // 参数不足（或格式串截断）：原样输出转换符
+            size_t specLen = conv ? p - start + 1 : p - start;
+            specLen = std::min(specLen, cap - n - 1);
+            memcpy(line + n, start, specLen);
+            n += specLen;
+            if (!conv) { break; }
+            continue;
+        }
+        const size_t room = cap - n;
+        if (strchr("di", conv) && (type == LOG_ARG_INT || type == LOG_ARG_UINT)) {
+            long long v = type == LOG_ARG_INT ? i : static_cast<long long>(u);
+            if (shortness == 1) { v = static_cast<short>(v); }
+            if (shortness >= 2) { v = static_cast<signed char>(v); }
+            memcpy(spec + sl, "lld", 4);
+            append(snprintf(line + n, room, spec, v));
+        } else if (strchr("uoxX", conv) && (type == LOG_ARG_INT || type == LOG_ARG_UINT)) {
+            unsigned long long v = type == LOG_ARG_UINT ? u : static_cast<unsigned long long>(i);
+            if (shortness == 1) { v = static_cast<unsigned short>(v); }
+            if (shortness >= 2) { v = static_cast<unsigned char>(v); }
+            spec[sl] = 'l'; spec[sl + 1] = 'l'; spec[sl + 2] = conv; spec[sl + 3] = '\0';
+            append(snprintf(line + n, room, spec, v));
+        } else if (conv == 'c' && (type == LOG_ARG_INT || type == LOG_ARG_UINT)) {
+            memcpy(spec + sl, "c", 2);
+            append(snprintf(line + n, room, spec, static_cast<int>(type == LOG_ARG_INT ? i : u)));
+        } else if (strchr("fFeEgGaA", conv) && type == LOG_ARG_DOUBLE) {
+            spec[sl] = conv; spec[sl + 1] = '\0';
+            append(snprintf(line + n, room, spec, d));
+        } else if (conv == 's' && type == LOG_ARG_STR) {
+            memcpy(spec + sl, ".*s", 4);
+            // 用精度限定长度（字符串不以 '\0' 结尾）；格式里自带的精度更小时以它为准
+            const char* dot = static_cast<const char*>(memchr(spec, '.', sl));
+            int prec = static_cast<int>(slen);
+            if (dot) {
+                prec = std::min(prec, atoi(dot + 1));
+                sl = dot - spec;
+                memcpy(spec + sl, ".*s", 4);
+            }
+            append(snprintf(line + n, room, spec, prec, str));
+        } else if (conv == 'p' && type == LOG_ARG_PTR) {
+            append(snprintf(line + n, room, "%p", reinterpret_cast<void*>(static_cast<uintptr_t>(u))));
+        } else {
+            // 类型与转换符不符：按参数自身类型输出
+            switch (type) {
+            case LOG_ARG_INT: append(snprintf(line + n, room, "%lld", static_cast<long long>(i))); break;
+            case LOG_ARG_UINT: append(snprintf(line + n, room, "%llu", static_cast<unsigned long long>(u))); break;
+            case LOG_ARG_DOUBLE: append(snprintf(line + n, room, "%g", d)); break;
+            case LOG_ARG_PTR: append(snprintf(line + n, room, "%p", reinterpret_cast<void*>(static_cast<uintptr_t>(u)))); break;
+            default: append(snprintf(line + n, room, "%.*s", static_cast<int>(slen), str)); break;
+            }
+        }
+    }
+    line[n++] = '\n';
+    return n;
+}
 
-        // 追加换行（原代码把 '\0' 也写入，这里保留原行为但建议只写 '\n'）
-        buff_.Append("\n\0", 2);
+// 取出所有缓冲区中已提交的日志写入文件；退役且读空的缓冲区移除
+bool Log::Drain_() {
+    bool any = false;
+    std::lock_guard<std::mutex> locker(ringsMtx_);
+    for (size_t i = 0; i < rings_.size();) {
+        LogRing* ring = rings_[i].get();
+        bool retired = ring->retired.load(std::memory_order_acquire);
+        size_t tail = ring->tail.load(std::memory_order_relaxed);
+        size_t head = ring->head.load(std::memory_order_acquire);
+        const size_t mask = ring->cap - 1;
+        while (tail != head) {
+            size_t pos = tail & mask;
+            uint32_t len;
+            memcpy(&len, ring->buf.get() + pos, 4);
+            if (len == LogRing::WRAP) {
+                tail += ring->cap - pos;
+                continue;
+            }
+            Emit_(ring->buf.get() + pos + 4, len);
+            tail += Align4(4 + len);
+            any = true;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+        if (retired && tail == ring->head.load(std::memory_order_acquire)) {
+            rings_.erase(rings_.begin() + i);
+        } else {
+            i++;
+        }
+    }
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != reportedDropped_) {
+        char line[128];
+        int n = snprintf(line, sizeof(line), "%s%llu log lines dropped (buffer full)\n", LevelTitle(2),
+                         static_cast<unsigned long long>(dropped - reportedDropped_));
+        WriteLine_(line, n);
+        reportedDropped_ = dropped;
+    }
+    return any;
+}
 
-        // 如果异步模式且队列存在且未满，则把日志字符串移入队列由后台线程写入
-        if (isAsync_ && deque_ && !deque_->full()) {
-            deque_->push_back(buff_.RetrieveAllToStr()); // RetrieveAllToStr 会返回字符串并清空 buff_
+// 写一行；日期变化或行数达到上限时切换文件
+void Log::WriteLine_(const char* line, size_t len) {
+    if (!fp_) {
+        return;
+    }
+    if (lineCount_ && lineCount_ % MAX_LINES_ == 0) {
+        time_t timer = time(nullptr);
+        struct tm t;
+        localtime_r(&timer, &t);
+        int today = (t.tm_year + 1900) * 10000 + (t.tm_mon + 1) * 100 + t.tm_mday;
+        if (today != toDay_) {
+            lineCount_ = 0;
+            OpenFile_(t, 0);
+        } else {
+            OpenFile_(t, lineCount_ / MAX_LINES_);
         }
-        else {
-            // 否则同步方式直接写入文件（fputs 在锁内，会阻塞写线程）
-            fputs(buff_.Peek(), fp_);
+    } else if ((lineCount_ & 1023) == 0) {
+        // 每 1024 行检查一次日期，避免逐行调用 time()
+        time_t timer = time(nullptr);
+        struct tm t;
+        localtime_r(&timer, &t);
+        if ((t.tm_year + 1900) * 10000 + (t.tm_mon + 1) * 100 + t.tm_mday != toDay_) {
+            lineCount_ = 0;
+            OpenFile_(t, 0);
         }
-        buff_.RetrieveAll();    // 清空缓冲区，准备下一条日志
     }
+    lineCount_++;
+    fwrite(line, 1, len, fp_);
 }
 
-// 在日志中追加级别前缀（如 [debug] / [info] / [warn] / [error]）
-void Log::AppendLogLevelTitle_(int level) {
-    switch (level) {
-    case 0:
-        buff_.Append("[debug]: ", 9);
-        break;
-    case 1:
-        buff_.Append("[info] : ", 9);
-        break;
-    case 2:
-        buff_.Append("[warn] : ", 9);
-        break;
-    case 3:
-        buff_.Append("[error]: ", 9);
-        break;
-    default:
-        buff_.Append("[info] : ", 9);
-        break;
-    }
-}
-
-// flush：唤醒异步队列消费者并把文件流缓冲刷到磁盘
+void Log::Wake_() {
+    {
+        std::lock_guard<std::mutex> locker(wakeMtx_);
+        wake_ = true;
+    }
+    wakeCond_.notify_one();
+}
+
+// flush：同步模式直接刷盘；异步模式请求后台线程写出并刷盘
 void Log::flush() {
     if (isAsync_) {
-        deque_->flush(); // 唤醒消费者处理剩余消息（BlockQueue::flush 实现为 notify_one）
+        flushRequested_ = true;
+        Wake_();
+        return;
     }
     std::lock_guard<std::mutex> locker(mtx_);
     if (fp_) {
-        fflush(fp_); // 把 stdio 缓冲区数据写到磁盘（或底层文件）
+        fflush(fp_);
     }
 }
 
-// 获取日志等级（线程安全）
+// 获取日志等级（无锁：后台线程写文件时持有 mtx_，不能让每条日志的级别判断等它）
 int Log::GetLevel() {
-    std::lock_guard<std::mutex> locker(mtx_);
-    return level_;
+    return level_.load(std::memory_order_relaxed);
 }
 
-// 设置日志等级（线程安全）
+// 设置日志等级
 void Log::SetLevel(int level) {
-    std::lock_guard<std::mutex> locker(mtx_);   
-    level_ = level;
+    level_.store(level, std::memory_order_relaxed);
 }
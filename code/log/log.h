@@ -4,77 +4,239 @@
 #include <mutex>
 #include <string>
 #include <thread>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <condition_variable>
+#include <chrono>
 #include <sys/time.h>
+#include <time.h>
 #include <string.h>
+#include <stdio.h>
+#include <stdint.h>
 #include <stdarg.h>           // vastart va_end
+#include <algorithm>
+#include <type_traits>
 #include <assert.h>
 #include <sys/stat.h>         // mkdir
 #include "blockqueue.h"
 #include "../buffer/buffer.h"
 
+struct LogRing;
+
+/*
+ * 延迟格式化：LOG_* 宏只把参数按类型原样编码进一条记录，后台线程再按 format 格式化。
+ * 记录 = LogRecordHead + 逐个参数（1 字节类型 + 数据；字符串拷贝内容）。
+ * 格式化时以参数的实际类型为准：转换符与类型不符时按类型的默认格式输出，不会出现 printf 的未定义行为。
+ */
+enum LOG_RECORD_KIND : uint8_t { LOG_TEXT, LOG_DEFERRED };
+enum LOG_ARG_TYPE : uint8_t { LOG_ARG_INT, LOG_ARG_UINT, LOG_ARG_DOUBLE, LOG_ARG_STR, LOG_ARG_PTR };
+
+struct LogRecordHead {
+    uint8_t kind;           // LOG_DEFERRED（LOG_TEXT 记录只有 kind 一个字节，后面是格式化好的整行）
+    uint8_t level;
+    uint16_t argc;
+    int32_t usec;
+    int64_t sec;
+    const char* format;     // 字符串字面量（LOG_BASE 用 "" format 保证），生命周期覆盖整个进程
+};
+
+class LogEncoder {
+public:
+    LogEncoder(char* buf, size_t cap) : buf_(buf), cap_(cap), len_(sizeof(LogRecordHead)), argc_(0) {}
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type Add(T v) {
+        Put_(LOG_ARG_INT, static_cast<int64_t>(v));
+    }
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type Add(T v) {
+        Put_(LOG_ARG_UINT, static_cast<uint64_t>(v));
+    }
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type Add(T v) {
+        Put_(LOG_ARG_DOUBLE, static_cast<double>(v));
+    }
+    template <typename T>
+    typename std::enable_if<std::is_enum<T>::value>::type Add(T v) {
+        Put_(LOG_ARG_INT, static_cast<int64_t>(v));
+    }
+    template <typename T>
+    void Add(T* p) {
+        Put_(LOG_ARG_PTR, reinterpret_cast<uintptr_t>(p));
+    }
+    void Add(const char* s) { AddStr_(s ? s : "(null)", s ? strlen(s) : 6); }
+    void Add(char* s) { Add(static_cast<const char*>(s)); }
+    void Add(const std::string& s) { AddStr_(s.data(), s.size()); }
+
+    char* Data() { return buf_; }
+    size_t Size() const { return len_; }
+    uint16_t Argc() const { return argc_; }
+
+private:
+    template <typename V>
+    void Put_(LOG_ARG_TYPE type, V v) {
+        if (len_ + 1 + sizeof(V) > cap_) { return; }   // 放不下的参数丢弃，格式化时原样输出转换符
+        buf_[len_] = static_cast<char>(type);
+        memcpy(buf_ + len_ + 1, &v, sizeof(V));
+        len_ += 1 + sizeof(V);
+        argc_++;
+    }
+    void AddStr_(const char* s, size_t n) {
+        if (len_ + 1 + sizeof(uint32_t) > cap_) { return; }
+        n = std::min(n, cap_ - len_ - 1 - sizeof(uint32_t));    // 过长的字符串截断
+        uint32_t n32 = static_cast<uint32_t>(n);
+        buf_[len_] = static_cast<char>(LOG_ARG_STR);
+        memcpy(buf_ + len_ + 1, &n32, sizeof(n32));
+        memcpy(buf_ + len_ + 1 + sizeof(n32), s, n);
+        len_ += 1 + sizeof(n32) + n;
+        argc_++;
+    }
+
+    char* buf_;
+    size_t cap_;
+    size_t len_;
+    uint16_t argc_;
+};
+
+/*
+ * Log：异步日志（单例）
+ *  - 每个写日志的线程有自己的单生产者单消费者环形缓冲区（LogRing），写一行只做参数编码和一次拷贝（格式化由后台线程完成），
+ *    不加锁、不通知后台线程（缓冲区过半时才唤醒一次）
+ *  - 时间前缀按秒缓存（后台线程一份，printf 风格的 write 每线程一份），同一秒内不再调用 localtime_r
+ *  - 后台线程定期把所有环形缓冲区的数据批量写入带大缓冲的文件流，按时间间隔或缓冲写满时刷盘
+ *  - 缓冲区满时按配置丢弃（计数并在日志中报告）或等待后台线程腾出空间
+ *  - maxQueueCapacity 为 0 时退化为同步日志：加锁直接写文件并逐行刷盘
+ */
 class Log {
 public:
-    // 初始化日志实例（阻塞队列最大容量、日志保存路径、日志文件后缀）
-    void init(int level, const char* path = "./log", 
+    // 初始化日志实例（日志等级、日志保存路径、日志文件后缀、每线程缓冲的日志行数、缓冲区满时是否等待）
+    void init(int level, const char* path = "./log",
                 const char* suffix =".log",
-                int maxQueueCapacity = 1024);
+                int maxQueueCapacity = 1024,
+                bool blockWhenFull = false);
 
     static Log* Instance();
     static void FlushLogThread();   // 异步写日志公有方法，调用私有方法asyncWrite
-    
-    void write(int level, const char *format,...);  // 将输出内容按照标准格式整理
-    void flush();
+
+    void write(int level, const char *format,...);  // 将输出内容按照标准格式整理（在调用线程格式化）
+
+    // LOG_* 宏使用的入口：只拷贝参数，格式化在后台线程进行（同步模式下当场格式化）
+    template <typename... Args>
+    void Write(int level, const char* format, const Args&... args) {
+        char rec[MAX_RECORD_LEN];
+        LogEncoder enc(rec, sizeof(rec));
+        int expand[] = {0, (enc.Add(args), 0)...};
+        (void)expand;
+        Commit_(level, format, enc);
+    }
+    void flush();   // 请求后台线程尽快写出并刷盘（异步模式下不等待完成）
 
     int GetLevel();
     void SetLevel(int level);
     bool IsOpen() { return isOpen_; }
-    
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }   // 因缓冲区满丢弃的行数
+
+    static const int MAX_LINE_LEN = 4096;       // 单行日志最大长度（超出部分截断）
+    static const int FLUSH_INTERVAL_MS = 1000;  // 后台线程刷盘间隔
+    static const int POLL_INTERVAL_MS = 20;     // 后台线程检查缓冲区的间隔
+    static const int AVG_LINE_LEN = 128;        // 按行数换算缓冲区字节数时的平均行长
+    static const int MAX_RECORD_LEN = 2048;     // 单条延迟格式化记录（参数编码后）的最大长度
+
 private:
     Log();
-    void AppendLogLevelTitle_(int level);
     virtual ~Log();
     void AsyncWrite_(); // 异步写日志方法
 
+    LogRing* LocalRing_();                  // 当前线程的环形缓冲区（首次使用时创建并登记）
+    size_t FormatLine_(char* line, int level, const char* format, va_list ap);
+    void Commit_(int level, const char* format, LogEncoder& enc);
+    void Push_(const char* rec, size_t len);        // 放入本线程缓冲区（同步模式直接写文件）
+    void Emit_(const char* rec, size_t len);        // 格式化一条记录并写入文件（持 mtx_ 调用）
+    size_t Decode_(const char* rec, size_t len, char* line);    // 延迟格式化记录 -> 一行文本
+    bool Drain_();                          // 取出所有缓冲区的数据写入文件（持 mtx_ 调用），有数据返回 true
+    void WriteLine_(const char* line, size_t len);  // 写一行并处理按天/按行数切换文件（持 mtx_ 调用）
+    void OpenFile_(const struct tm& t, int part);   // 打开 path/YYYY_MM_DD[-part]suffix（持 mtx_ 调用）
+    void Wake_();
+
 private:
     static const int LOG_PATH_LEN = 256;    // 日志文件最长文件名
     static const int LOG_NAME_LEN = 256;    // 日志最长名字
     static const int MAX_LINES = 50000;     // 日志文件内的最长日志条数
+    static const size_t FILE_BUFF_SIZE = 256 * 1024;    // 文件流缓冲区，批量写入磁盘
 
-    const char* path_;          //路径名
-    const char* suffix_;        //后缀名
+    std::string path_;          //路径名
+    std::string suffix_;        //后缀名
 
     int MAX_LINES_;             // 最大日志行数
 
     int lineCount_;             //日志行数记录
-    int toDay_;                 //按当天日期区分文件
+    int toDay_;                 //按当天日期区分文件（yyyymmdd）
+
+    bool isOpen_;
 
-    bool isOpen_;               
- 
-    Buffer buff_;       // 输出的内容，缓冲区
-    int level_;         // 日志等级
+    std::atomic<int> level_;    // 日志等级（写日志前无锁读取）
     bool isAsync_;      // 是否开启异步日志
+    bool blockWhenFull_;    // 缓冲区满时等待（true）还是丢弃（false）
+    size_t ringBytes_;      // 每个线程环形缓冲区的字节数（2 的幂）
 
     FILE* fp_;                                          //打开log的文件指针
-    std::unique_ptr<BlockQueue<std::string>> deque_;    //阻塞队列
+    std::unique_ptr<char[]> fileBuff_;                  //文件流缓冲区
     std::unique_ptr<std::thread> writeThread_;          //写线程的指针
-    std::mutex mtx_;                                    //同步日志必需的互斥量
+    std::mutex mtx_;                                    //消费者一侧的锁：文件与各缓冲区的读端
+
+    std::mutex ringsMtx_;                               //保护 rings_ 的登记与移除
+    std::vector<std::shared_ptr<LogRing>> rings_;       //所有线程的环形缓冲区
+
+    std::mutex wakeMtx_;
+    std::condition_variable wakeCond_;
+    bool wake_;                                         //有线程请求后台线程立即处理
+    bool closing_;                                      //析构中，后台线程写完剩余数据后退出
+    std::atomic<bool> flushRequested_;
+    std::atomic<uint64_t> dropped_;
+    uint64_t reportedDropped_;                          //已在日志中报告过的丢弃行数
+    time_t cachedSec_;                                  //消费者一侧的时间前缀缓存（持 mtx_ 使用）
+    char cachedTime_[32];
+    size_t cachedTimeLen_;
 };
 
+// 编译期最低日志等级：低于它的 LOG_* 调用展开为空语句，参数也不会被求值
+// 例如 make LOG_MIN_LEVEL=1 去掉所有 LOG_DEBUG
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+// "" format 要求 format 是字符串字面量：记录中只保存它的指针，由后台线程稍后使用
 #define LOG_BASE(level, format, ...) \
     do {\
         Log* log = Log::Instance();\
         if (log->IsOpen() && log->GetLevel() <= level) {\
-            log->write(level, format, ##__VA_ARGS__); \
-            log->flush();\
+            log->Write(level, "" format, ##__VA_ARGS__); \
         }\
     } while(0);
 
 // 四个宏定义，主要用于不同类型的日志输出，也是外部使用日志的接口
 // ...表示可变参数，__VA_ARGS__就是将...的值复制到这里
 // 前面加上##的作用是：当可变参数的个数为0时，这里的##可以把把前面多余的","去掉,否则会编译出错。
-#define LOG_DEBUG(format, ...) do {LOG_BASE(0, format, ##__VA_ARGS__)} while(0);    
+#if LOG_MIN_LEVEL <= 0
+#define LOG_DEBUG(format, ...) do {LOG_BASE(0, format, ##__VA_ARGS__)} while(0);
+#else
+#define LOG_DEBUG(format, ...) do {} while(0);
+#endif
+#if LOG_MIN_LEVEL <= 1
 #define LOG_INFO(format, ...) do {LOG_BASE(1, format, ##__VA_ARGS__)} while(0);
+#else
+#define LOG_INFO(format, ...) do {} while(0);
+#endif
+#if LOG_MIN_LEVEL <= 2
 #define LOG_WARN(format, ...) do {LOG_BASE(2, format, ##__VA_ARGS__)} while(0);
+#else
+#define LOG_WARN(format, ...) do {} while(0);
+#endif
+#if LOG_MIN_LEVEL <= 3
 #define LOG_ERROR(format, ...) do {LOG_BASE(3, format, ##__VA_ARGS__)} while(0);
+#else
+#define LOG_ERROR(format, ...) do {} while(0);
+#endif
 
 #endif //LOG_H
@@ -1,12 +1,20 @@
 #include <unistd.h>
+#include <stdio.h>
 #include "server/webserver.h"
+#include "config/config.h"
 
-int main() {
-    // 守护进程 后台运行 
-    WebServer server(
-        1316, 3, 60000, false,             /* 端口 ET模式 timeoutMs 优雅退出  */
-        3306, "root", "200389", "mydb", /* Mysql配置 */
-        12, 6, true, 1, 1024);             /* 连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量 */
+// 用法：server [配置文件]（示例见仓库根目录的 server.conf）
+// 不带配置文件时使用默认配置：端口 1316、ET 模式、超时 60s、MySQL root/mydb、经典模式（单 epoll + 线程池）
+//   kill -HUP  重新加载配置文件（日志等级、超时、文件缓存上限）
+//   kill -USR2 热重启（监听 socket 交给新进程，旧进程排空后退出）
+//   kill -TERM 排空连接后退出
+int main(int argc, char* argv[]) {
+    Config config;
+    std::string err;
+    if (argc > 1 && !config.Load(argv[1], &err)) {
+        fprintf(stderr, "Load config %s failed: %s\n", argv[1], err.c_str());
+        return 1;
+    }
+    WebServer server(config, argv);
     server.Start();
-} 
-
+}
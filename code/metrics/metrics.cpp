@@ -0,0 +1,215 @@
+#include "metrics.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>     // strcmp
+#include <algorithm>
+
+// 单写者：只有所属线程修改，输出线程只读，因此用 relaxed 的 load + store 代替 fetch_add
+struct Metrics::Shard {
+    struct Hist {
+        std::atomic<uint64_t> buckets[HIST_BUCKETS];
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sumNs;
+    };
+    std::atomic<uint64_t> counters[COUNTER_NUM];
+    Hist hists[HIST_NUM];
+
+    Shard() {
+        for (auto& c : counters) { c.store(0, std::memory_order_relaxed); }
+        for (auto& h : hists) {
+            for (auto& b : h.buckets) { b.store(0, std::memory_order_relaxed); }
+            h.count.store(0, std::memory_order_relaxed);
+            h.sumNs.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    static void Add(std::atomic<uint64_t>& v, uint64_t n) {
+        v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // 把 other 的数值加到本分片（持 mtx_ 调用，本分片不能是某个线程正在写的分片）
+    void Merge(const Shard& other) {
+        for (int i = 0; i < COUNTER_NUM; i++) {
+            Add(counters[i], other.counters[i].load(std::memory_order_relaxed));
+        }
+        for (int i = 0; i < HIST_NUM; i++) {
+            for (int j = 0; j < HIST_BUCKETS; j++) {
+                Add(hists[i].buckets[j], other.hists[i].buckets[j].load(std::memory_order_relaxed));
+            }
+            Add(hists[i].count, other.hists[i].count.load(std::memory_order_relaxed));
+            Add(hists[i].sumNs, other.hists[i].sumNs.load(std::memory_order_relaxed));
+        }
+    }
+};
+
+// 线程退出时把分片的数值交给 Metrics
+struct Metrics::LocalHolder {
+    Shard shard;
+    bool registered = false;
+    ~LocalHolder() {
+        if (registered) { Metrics::Instance()->Unregister_(&shard); }
+    }
+};
+
+namespace {
+// 输出时的名字与标签，下标与枚举一一对应；同名的相邻项合并为一个指标族
+struct MetricDesc {
+    const char* name;
+    const char* label;  // 不带标签时为 nullptr
+    const char* help;
+};
+
+const MetricDesc COUNTER_DESC[COUNTER_NUM] = {
+    {"http_accepted_connections_total", nullptr, "Accepted client connections."},
+    {"http_rejected_connections_total", nullptr, "Connections refused because the server was full."},
+    {"http_requests_total", nullptr, "Requests answered (including error responses)."},
+    {"http_sent_bytes_total", "source=\"buffer\"", "Bytes written to clients by source."},
+    {"http_sent_bytes_total", "source=\"mmap\"", "Bytes written to clients by source."},
+    {"http_sent_bytes_total", "source=\"sendfile\"", "Bytes written to clients by source."},
+    {"http_timer_expired_total", nullptr, "Connections closed by the idle timer."},
+    {"http_write_yields_total", nullptr, "Writes that stopped at the per-turn byte budget."},
+    {"http_timer_deferred_total", nullptr, "Idle-timer checks postponed because a worker owned the connection."},
+    {"http_stale_tasks_total", nullptr, "Worker tasks dropped because the connection was closed or reused."},
+    {"http_use_after_close_total", nullptr, "Reads, writes or parses attempted on a closed connection."},
+};
+
+const MetricDesc HIST_DESC[HIST_NUM] = {
+    {"http_stage_seconds", "stage=\"read\"", "Time spent per connection stage."},
+    {"http_stage_seconds", "stage=\"parse\"", "Time spent per connection stage."},
+    {"http_stage_seconds", "stage=\"response\"", "Time spent per connection stage."},
+    {"http_stage_seconds", "stage=\"write\"", "Time spent per connection stage."},
+    {"threadpool_task_wait_seconds", nullptr, "Time from ThreadPool::AddTask to task start."},
+    {"sqlpool_wait_seconds", nullptr, "Time spent waiting for a connection in SqlConnRAII."},
+};
+
+void AppendF(std::string* out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+void AppendF(std::string* out, const char* format, ...) {
+    char line[256];
+    va_list ap;
+    va_start(ap, format);
+    int n = vsnprintf(line, sizeof(line), format, ap);
+    va_end(ap);
+    if (n > 0) {
+        out->append(line, std::min(static_cast<size_t>(n), sizeof(line) - 1));
+    }
+}
+
+void AppendFamily(std::string* out, const MetricDesc* desc, int i, const char* type) {
+    if (i == 0 || strcmp(desc[i - 1].name, desc[i].name) != 0) {
+        AppendF(out, "# HELP %s %s\n# TYPE %s %s\n", desc[i].name, desc[i].help, desc[i].name, type);
+    }
+}
+} // namespace
+
+Metrics* Metrics::Instance() {
+    static Metrics metrics;
+    return &metrics;
+}
+
+Metrics::Metrics() : retired_(new Shard()) {}
+
+Metrics::~Metrics() {
+    delete retired_;
+}
+
+Metrics::Shard* Metrics::Local_() {
+    static thread_local LocalHolder holder;
+    if (!holder.registered) {
+        holder.registered = true;
+        Instance()->Register_(&holder.shard);
+    }
+    return &holder.shard;
+}
+
+void Metrics::Register_(Shard* shard) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    shards_.push_back(shard);
+}
+
+void Metrics::Unregister_(Shard* shard) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    for (size_t i = 0; i < shards_.size(); i++) {
+        if (shards_[i] == shard) {
+            shards_[i] = shards_.back();
+            shards_.pop_back();
+            break;
+        }
+    }
+    retired_->Merge(*shard);
+}
+
+void Metrics::Count(METRIC_COUNTER counter, uint64_t n) {
+    Shard::Add(Local_()->counters[counter], n);
+}
+
+void Metrics::Observe(METRIC_HISTOGRAM hist, int64_t ns) {
+    Shard::Hist& h = Local_()->hists[hist];
+    uint64_t v = ns > 0 ? static_cast<uint64_t>(ns) : 0;
+    int bits = v ? 64 - __builtin_clzll(v) : 0;     // v < 2^bits
+    int idx = std::max(0, bits - HIST_BASE_SHIFT);
+    if (idx < HIST_BUCKETS) {
+        Shard::Add(h.buckets[idx], 1);
+    }
+    Shard::Add(h.count, 1);
+    Shard::Add(h.sumNs, v);
+}
+
+void Metrics::AddGauge(const char* name, const char* help, std::function<double()> fn) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    gauges_.push_back({name, help, std::move(fn)});
+}
+
+void Metrics::ClearGauges() {
+    std::lock_guard<std::mutex> locker(mtx_);
+    gauges_.clear();
+}
+
+void Metrics::Render(std::string* out) {
+    Shard total;
+    std::vector<Gauge> gauges;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        total.Merge(*retired_);
+        for (Shard* shard : shards_) {
+            total.Merge(*shard);
+        }
+        gauges = gauges_;
+    }
+    for (int i = 0; i < COUNTER_NUM; i++) {
+        const MetricDesc& d = COUNTER_DESC[i];
+        AppendFamily(out, COUNTER_DESC, i, "counter");
+        unsigned long long v = total.counters[i].load(std::memory_order_relaxed);
+        if (d.label) {
+            AppendF(out, "%s{%s} %llu\n", d.name, d.label, v);
+        } else {
+            AppendF(out, "%s %llu\n", d.name, v);
+        }
+    }
+    for (int i = 0; i < HIST_NUM; i++) {
+        const MetricDesc& d = HIST_DESC[i];
+        const Shard::Hist& h = total.hists[i];
+        AppendFamily(out, HIST_DESC, i, "histogram");
+        const char* label = d.label ? d.label : "";
+        const char* sep = d.label ? "," : "";
+        unsigned long long cumulative = 0;
+        for (int j = 0; j < HIST_BUCKETS; j++) {
+            cumulative += h.buckets[j].load(std::memory_order_relaxed);
+            double le = static_cast<double>(1ULL << (j + HIST_BASE_SHIFT)) / 1e9;
+            AppendF(out, "%s_bucket{%s%sle=\"%.9g\"} %llu\n", d.name, label, sep, le, cumulative);
+        }
+        // 分片在输出过程中仍在写入，桶与总数不是同一时刻读到的；保证 +Inf 不小于前面的桶
+        unsigned long long count = std::max(cumulative,
+                                            static_cast<unsigned long long>(h.count.load(std::memory_order_relaxed)));
+        AppendF(out, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", d.name, label, sep, count);
+        double sum = static_cast<double>(h.sumNs.load(std::memory_order_relaxed)) / 1e9;
+        if (d.label) {
+            AppendF(out, "%s_sum{%s} %.9g\n%s_count{%s} %llu\n", d.name, label, sum, d.name, label, count);
+        } else {
+            AppendF(out, "%s_sum %.9g\n%s_count %llu\n", d.name, sum, d.name, count);
+        }
+    }
+    for (const Gauge& g : gauges) {
+        AppendF(out, "# HELP %s %s\n# TYPE %s gauge\n%s %.17g\n",
+                g.name.c_str(), g.help.c_str(), g.name.c_str(), g.name.c_str(), g.fn());
+    }
+}
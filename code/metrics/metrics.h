@@ -0,0 +1,97 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <functional>
+
+// 计数器：同一个名字的多个计数器（不同标签）在输出时合并为一个指标族
+enum METRIC_COUNTER {
+    COUNTER_ACCEPTED,           // accept 成功的连接
+    COUNTER_REJECTED,           // 连接数已满被拒绝的连接
+    COUNTER_REQUESTS,           // 已生成响应的请求（包括错误请求）
+    COUNTER_SENT_BUFF,          // 从写缓冲区发送的字节（响应头、错误页面、内联正文）
+    COUNTER_SENT_MMAP,          // 从内存正文发送的字节（mmap 映射的文件或缓存的压缩变体）
+    COUNTER_SENT_SENDFILE,      // sendfile 发送的字节
+    COUNTER_TIMER_EXPIRED,      // 超时被关闭的连接
+    COUNTER_WRITE_YIELDS,       // 写预算用完、让出后再继续写的次数
+    COUNTER_TIMER_DEFERRED,     // 超时到期时连接正在 worker 上处理、推迟检查的次数（每 DEFER_RETRY_MS 重新检查一次）
+    COUNTER_STALE_TASKS,        // 开始执行时连接已关闭或 fd 已被复用、直接丢弃的任务
+    COUNTER_USE_AFTER_CLOSE,    // 在已关闭的连接上读、写或处理（竞争导致，正常应为 0）
+    COUNTER_NUM
+};
+
+// 直方图：记录耗时（纳秒），按 2 的幂分桶
+enum METRIC_HISTOGRAM {
+    HIST_READ,                  // HttpConn::read
+    HIST_PARSE,                 // 单个请求的解析（HttpRequest::parse）
+    HIST_RESPONSE,              // 单个响应的生成（HttpResponse::MakeResponse 及入队）
+    HIST_WRITE,                 // HttpConn::write
+    HIST_TASK_WAIT,             // 任务从提交到线程池到开始执行
+    HIST_SQL_WAIT,              // SqlConnRAII 获取连接的等待
+    HIST_NUM
+};
+
+/*
+ * Metrics：进程内的指标（单例），由 WebServer 在 /metrics 上以 Prometheus 文本格式输出
+ *  - 每个线程一个分片（第一次记录时登记），热路径只对本线程分片做 relaxed 的读-加-写，
+ *    不加锁、也没有跨线程竞争的原子 RMW；输出时把所有分片相加
+ *  - 线程退出时分片的数值并入 retired_，计数不会因为线程结束而回退
+ *  - 直方图第 i 个桶的上界为 2^(i+7) 纳秒（128ns ~ 17s），超过的只计入 +Inf
+ *  - 瞬时值（活跃连接数、队列深度等）不在热路径维护，由 AddGauge 注册的回调在输出时读取
+ */
+class Metrics {
+public:
+    static Metrics* Instance();
+
+    // 热路径接口，只访问当前线程的分片
+    static void Count(METRIC_COUNTER counter, uint64_t n = 1);
+    static void Observe(METRIC_HISTOGRAM hist, int64_t ns);
+    static void ObserveSince(METRIC_HISTOGRAM hist, int64_t startNs) {
+        Observe(hist, Now() - startNs);
+    }
+    // 单调时钟（纳秒）
+    static int64_t Now() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    // 注册一个在输出时求值的瞬时值；回调在请求 /metrics 的线程中执行，必须线程安全
+    void AddGauge(const char* name, const char* help, std::function<double()> fn);
+    void ClearGauges();     // 回调引用的对象销毁前调用
+
+    // 以 Prometheus 文本格式（0.0.4）输出所有指标
+    void Render(std::string* out);
+
+    static const int HIST_BUCKETS = 28;
+    static const int HIST_BASE_SHIFT = 7;   // 第 0 个桶的上界 2^7 纳秒
+
+    struct Shard;   // 一个线程的全部计数
+
+private:
+    Metrics();
+    ~Metrics();
+
+    struct LocalHolder;
+    static Shard* Local_();
+    void Register_(Shard* shard);
+    void Unregister_(Shard* shard);     // 线程退出：数值并入 retired_
+
+    struct Gauge {
+        std::string name;
+        std::string help;
+        std::function<double()> fn;
+    };
+
+    std::mutex mtx_;                    // 保护 shards_ / retired_ / gauges_（热路径不使用）
+    std::vector<Shard*> shards_;
+    Shard* retired_;
+    std::vector<Gauge> gauges_;
+};
+
+#endif //METRICS_H
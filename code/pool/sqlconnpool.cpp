@@ -1,74 +1,388 @@
 #include "sqlconnpool.h"
+#include <string.h>  // strlen
+
+// 线程退出时把槽里的连接还给连接池
+struct SqlConnPool::LocalHolder {
+    SqlConnPool *pool = nullptr;
+    LocalSlot slot;
+    ~LocalHolder() {
+        if(pool) { pool->Unregister_(&slot); }
+    }
+};
 
 SqlConnPool* SqlConnPool::Instance() {
     static SqlConnPool connPool;
     return &connPool;
 }
 
-//获取连接
-MYSQL* SqlConnPool::GetConn() {
-    MYSQL *conn = nullptr;
+SqlConnPool::LocalSlot* SqlConnPool::Local_() {
+    static thread_local LocalHolder holder;
+    if(!holder.pool) {
+        std::lock_guard<std::mutex> locker(mtx_);
+        holder.pool = this;
+        slots_.push_back(&holder.slot);
+    }
+    return &holder.slot;
+}
 
-    if(connQue_.empty()) {
-        LOG_WARN("SqlConnPool busy!");
-        return nullptr;
+void SqlConnPool::Unregister_(LocalSlot *slot) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    for(size_t i = 0; i < slots_.size(); i++) {
+        if(slots_[i] == slot) {
+            slots_[i] = slots_.back();
+            slots_.pop_back();
+            break;
+        }
     }
+    MYSQL *conn = slot->conn.exchange(nullptr, std::memory_order_acq_rel);
+    if(conn && isClose_) {
+        total_--;
+        Close_(conn);
+    } else if(conn) {
+        Clock::time_point now = Clock::now();
+        idle_.push_back({conn, now, now});
+        cond_.notify_one();
+    }
+}
 
-    sem_wait(&semId_);// P 操作
-    {
-        std::lock_guard<std::mutex> locker(mtx_);
-        conn = connQue_.front();
-        connQue_.pop();
+MYSQL* SqlConnPool::StealParked_() {
+    for(LocalSlot *slot : slots_) {
+        MYSQL *conn = slot->conn.exchange(nullptr, std::memory_order_acq_rel);
+        if(conn) {
+            return conn;
+        }
     }
+    return nullptr;
+}
 
-    return conn;
+//获取连接：先取本线程上次归还的连接，再取空闲队列，未达到上限时新建，否则等待归还
+MYSQL* SqlConnPool::GetConn() {
+    MYSQL *conn = Local_()->conn.exchange(nullptr, std::memory_order_acq_rel);
+    if(conn) {
+        return conn;
+    }
+
+    std::unique_lock<std::mutex> locker(mtx_);
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(WAIT_MS);
+    while(!isClose_) {
+        if(!idle_.empty()) {
+            conn = idle_.back().conn;
+            idle_.pop_back();
+            return conn;
+        }
+        if(total_ < MAX_CONN_) {
+            total_++;
+            locker.unlock();
+            conn = Open_();
+            if(conn) {
+                return conn;
+            }
+            locker.lock();
+            total_--;
+            cond_.notify_one();
+            return nullptr;
+        }
+        if((conn = StealParked_())) {
+            return conn;
+        }
+        if(Clock::now() >= deadline) {
+            break;
+        }
+        // 槽里的连接归还时不会通知，分小段等待并重新检查
+        waiters_++;
+        cond_.wait_until(locker, std::min(deadline, Clock::now() + std::chrono::milliseconds(50)));
+        waiters_--;
+    }
+    LOG_WARN("SqlConnPool busy!");
+    return nullptr;
 }
-//归还连接
+//归还连接：没有线程在等待时放进本线程的槽，否则放回空闲队列并唤醒等待者
 void SqlConnPool::FreeConn(MYSQL *conn) {
     assert(conn);
-    {
-        std::lock_guard<std::mutex> locker(mtx_);
-        connQue_.push(conn);
+    if(hasBroken_.load(std::memory_order_acquire)) {
+        std::unique_lock<std::mutex> locker(mtx_);
+        if(broken_.erase(conn)) {
+            hasBroken_ = !broken_.empty();
+            total_--;
+            locker.unlock();
+            delete conn;
+            cond_.notify_one();
+            return;
+        }
+    }
+    LocalSlot *slot = Local_();
+    if(waiters_.load(std::memory_order_relaxed) == 0 && !isClose_) {
+        MYSQL *expected = nullptr;
+        slot->since.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        if(slot->conn.compare_exchange_strong(expected, conn, std::memory_order_acq_rel)) {
+            return;
+        }
     }
-    sem_post(&semId_);// V 操作
+    std::unique_lock<std::mutex> locker(mtx_);
+    if(isClose_) {
+        total_--;
+        locker.unlock();
+        Close_(conn);
+        return;
+    }
+    Clock::time_point now = Clock::now();
+    idle_.push_back({conn, now, now});
+    locker.unlock();
+    cond_.notify_one();
 }
-//获取空闲连接数
+//获取空闲连接数（包括放在线程槽里的）
 int SqlConnPool::GetFreeConnCount() {
     std::lock_guard<std::mutex> locker(mtx_);
-    return connQue_.size();
+    int count = idle_.size();
+    for(LocalSlot *slot : slots_) {
+        if(slot->conn.load(std::memory_order_relaxed)) {
+            count++;
+        }
+    }
+    return count;
 }
-//初始化    
+//取得预编译语句
+MYSQL_STMT* SqlConnPool::GetStmt(MYSQL *conn, const char *sql) {
+    assert(conn && sql);
+    std::unordered_map<std::string, MYSQL_STMT *>* cache;
+    {
+        std::lock_guard<std::mutex> locker(stmtMtx_);
+        cache = &stmts_[conn];
+    }
+    auto it = cache->find(sql);
+    if(it != cache->end()) {
+        return it->second;
+    }
+    MYSQL_STMT *stmt = mysql_stmt_init(conn);
+    if(!stmt) {
+        LOG_ERROR("MySQL stmt init error!");
+        return nullptr;
+    }
+    if(mysql_stmt_prepare(stmt, sql, strlen(sql))) {
+        LOG_ERROR("MySQL prepare error: %s", mysql_stmt_error(stmt));
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+    (*cache)[sql] = stmt;
+    return stmt;
+}
+//关闭连接上的预编译语句，连接已断开时重连
+void SqlConnPool::ResetStmts(MYSQL *conn) {
+    assert(conn);
+    CloseStmts_(conn);
+    if(mysql_ping(conn) != 0) {
+        LOG_WARN("MySQL connection lost: %s, reconnecting", mysql_error(conn));
+        if(Reconnect_(conn) == CONNECT_INIT_FAILED) {
+            std::lock_guard<std::mutex> locker(mtx_);
+            broken_.insert(conn);   // 借用者归还时释放
+            hasBroken_ = true;
+        }
+    }
+}
+
+void SqlConnPool::CloseStmts_(MYSQL *conn) {
+    std::unordered_map<std::string, MYSQL_STMT *> old;
+    {
+        std::lock_guard<std::mutex> locker(stmtMtx_);
+        auto it = stmts_.find(conn);
+        if(it == stmts_.end()) {
+            return;
+        }
+        old.swap(it->second);
+        stmts_.erase(it);
+    }
+    for(auto& item : old) {
+        mysql_stmt_close(item.second);
+    }
+}
+//新建连接：句柄由连接池分配，重连时在同一地址上重新 mysql_init，借用者持有的指针保持有效
+MYSQL* SqlConnPool::Open_() {
+    MYSQL *conn = new MYSQL;
+    CONNECT_RESULT ret = Connect_(conn);
+    if(ret != CONNECT_OK) {
+        if(ret == CONNECT_FAILED) {
+            mysql_close(conn);
+        }
+        delete conn;
+        return nullptr;
+    }
+    return conn;
+}
+
+SqlConnPool::CONNECT_RESULT SqlConnPool::Connect_(MYSQL *conn) {
+    if(!mysql_init(conn)) {
+        LOG_ERROR("MySQL init error!");
+        return CONNECT_INIT_FAILED;
+    }
+    if(!mysql_real_connect(conn, host_.c_str(), user_.c_str(), pwd_.c_str(),
+                           dbName_.c_str(), port_, nullptr, 0)) {
+        LOG_ERROR("MySQL connect error: %s", mysql_error(conn));
+        return CONNECT_FAILED;   // 句柄保持已初始化状态，之后仍可 ping/重连/关闭
+    }
+    return CONNECT_OK;
+}
+
+SqlConnPool::CONNECT_RESULT SqlConnPool::Reconnect_(MYSQL *conn) {
+    CloseStmts_(conn);
+    mysql_close(conn);
+    return Connect_(conn);
+}
+
+void SqlConnPool::Close_(MYSQL *conn) {
+    CloseStmts_(conn);
+    mysql_close(conn);
+    delete conn;
+}
+//初始化：并行建立最小数量的连接，启动后台检查线程
 void SqlConnPool::Init(const char* host, int port,
-                       const char* user,const char* pwd, 
-                       const char* dbName, int connSize) {
+                       const char* user,const char* pwd,
+                       const char* dbName, int connSize, int minConn) {
     assert(connSize > 0);
+    host_ = host;
+    port_ = port;
+    user_ = user;
+    pwd_ = pwd;
+    dbName_ = dbName;
+    MAX_CONN_ = connSize;
+    minConn_ = std::max(0, std::min(minConn, connSize));
+    isClose_ = false;
 
-    for(int i = 0; i < connSize; ++i) {
-        MYSQL *conn = nullptr;
-        conn = mysql_init(conn);
+    // 每个连接的握手都要等网络往返，逐个建立时启动时间随连接数线性增长
+    std::vector<MYSQL *> conns(minConn_, nullptr);
+    std::vector<std::thread> openers;
+    for(int i = 0; i < minConn_; ++i) {
+        openers.emplace_back([this, &conns, i] { conns[i] = Open_(); });
+    }
+    for(auto& t : openers) {
+        t.join();
+    }
+    Clock::time_point now = Clock::now();
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        for(MYSQL *conn : conns) {
+            if(conn) {
+                idle_.push_back({conn, now, now});
+                total_++;
+            }
+        }
+    }
+    if(total_ < minConn_) {
+        LOG_ERROR("MySQL connect: %d of %d connections opened", total_, minConn_);
+    }
+    keeper_ = std::thread(&SqlConnPool::Keeper_, this);
+}
 
-        if(!conn) {
-            LOG_ERROR("MySQL init error!");
-            assert(conn);
+void SqlConnPool::Keeper_() {
+    std::unique_lock<std::mutex> locker(mtx_);
+    while(!isClose_) {
+        keeperCond_.wait_for(locker, std::chrono::seconds(PING_INTERVAL_SEC));
+        if(isClose_) {
+            break;
         }
+        Clock::time_point now = Clock::now();
+        const Clock::duration pingAfter = std::chrono::seconds(PING_INTERVAL_SEC);
+        const Clock::duration closeAfter = std::chrono::seconds(IDLE_TIMEOUT_SEC);
 
-        conn = mysql_real_connect(conn, host, user, pwd, dbName, port, nullptr, 0);
-        if(!conn) {
-            LOG_ERROR("MySQL connect error!");
+        // 长时间放在线程槽里的连接（该线程不用数据库了）收回空闲队列，参与检查与收缩
+        for(LocalSlot *slot : slots_) {
+            Clock::time_point since{Clock::duration(slot->since.load(std::memory_order_relaxed))};
+            if(now - since >= pingAfter) {
+                MYSQL *conn = slot->conn.exchange(nullptr, std::memory_order_acq_rel);
+                if(conn) {
+                    idle_.push_front({conn, since, since});
+                }
+            }
         }
-        connQue_.push(conn);
-    }
+        // 取出需要检查的空闲连接，在锁外 ping / 关闭
+        std::vector<Idle> check;
+        for(auto it = idle_.begin(); it != idle_.end();) {
+            if(now - it->lastCheck >= pingAfter) {
+                check.push_back(*it);
+                it = idle_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        int closable = total_ - minConn_;
+        locker.unlock();
 
-    MAX_CONN_ = connSize;
-    sem_init(&semId_, 0, MAX_CONN_);// 初始化信号量
+        int closed = 0;
+        int dropped = 0;    // 重连时 mysql_init 失败、已释放的连接
+        for(Idle& item : check) {
+            if(closable > 0 && now - item.lastUsed >= closeAfter) {
+                Close_(item.conn);
+                closable--;
+                closed++;
+                item.conn = nullptr;
+            } else if(mysql_ping(item.conn) != 0) {
+                LOG_WARN("MySQL ping failed: %s, reconnecting", mysql_error(item.conn));
+                if(Reconnect_(item.conn) == CONNECT_INIT_FAILED) {
+                    delete item.conn;   // 句柄未初始化，不能留在队列里再 ping；缺的连接在下面补足
+                    dropped++;
+                    item.conn = nullptr;
+                }   // 连接失败时留在队列里，下一轮再试
+            }
+            item.lastCheck = now;
+        }
+
+        locker.lock();
+        total_ -= closed + dropped;
+        for(const Idle& item : check) {
+            if(item.conn) {
+                idle_.push_front(item);
+            }
+        }
+        // 数据库恢复后补足最小连接数
+        int need = minConn_ - total_;
+        if(need > 0) {
+            total_ += need;
+            locker.unlock();
+            std::vector<MYSQL *> opened;
+            for(int i = 0; i < need; i++) {
+                MYSQL *conn = Open_();
+                if(!conn) {
+                    break;
+                }
+                opened.push_back(conn);
+            }
+            locker.lock();
+            total_ -= need - static_cast<int>(opened.size());
+            now = Clock::now();
+            for(MYSQL *conn : opened) {
+                idle_.push_back({conn, now, now});
+            }
+        }
+        if(closed > 0) {
+            LOG_INFO("SqlConnPool shrink: closed %d idle connections, %d left", closed, total_);
+        }
+        cond_.notify_all();
+    }
 }
 //销毁所有连接
 void SqlConnPool::ClosePool() {
-    std::lock_guard<std::mutex> locker(mtx_);
-    while(!connQue_.empty()) {
-        auto item = connQue_.front();
-        connQue_.pop();
-        mysql_close(item);
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if(isClose_) {
+            return;
+        }
+        isClose_ = true;
+    }
+    keeperCond_.notify_all();
+    cond_.notify_all();
+    if(keeper_.joinable()) {
+        keeper_.join();
+    }
+    std::deque<Idle> idle;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        while(MYSQL *conn = StealParked_()) {
+            idle_.push_back({conn, Clock::time_point(), Clock::time_point()});
+        }
+        idle.swap(idle_);
+        total_ -= idle.size();  // 借出中的连接在 FreeConn 时关闭
+    }
+    for(const Idle& item : idle) {
+        Close_(item.conn);
     }
     mysql_library_end();
 }
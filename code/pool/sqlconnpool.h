@@ -3,34 +3,105 @@
 
 #include <mysql/mysql.h>
 #include <string>
-#include <queue>
+#include <deque>
+#include <algorithm>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <atomic>
+#include <chrono>
 #include <mutex>
-#include <semaphore.h>
+#include <condition_variable>
 #include <thread>
 #include "../log/log.h"
+#include "../metrics/metrics.h"
 
+/*
+ * SqlConnPool：弹性的 MySQL 连接池（单例）
+ *  - 连接数在 [minConn, connSize] 之间：启动时并行建立 minConn 个，空闲连接用完时按需新建，
+ *    超过 IDLE_TIMEOUT_SEC 没用的连接由后台线程关闭（保留 minConn 个）
+ *  - 后台线程定期 mysql_ping 长时间空闲的连接，断开的连接就地重连（MYSQL* 地址不变，借用者无感知）
+ *  - 线程亲和：FreeConn 把连接先放在当前线程的槽里，同一线程下一次 GetConn 直接取回，不经过全局锁；
+ *    其他线程拿不到连接时会从这些槽里取走
+ */
 class SqlConnPool {
 public:
     static SqlConnPool *Instance();// 单例模式
 
-    MYSQL *GetConn();// 获取连接
+    MYSQL *GetConn();// 获取连接，最多等待 WAIT_MS，取不到返回 nullptr
     void FreeConn(MYSQL * conn);// 将连接归还到连接池
     int GetFreeConnCount();// 获取空闲连接数
 
+    // 取得 conn 上 sql 对应的预编译语句（第一次使用时 mysql_stmt_prepare，之后复用），失败返回 nullptr
+    // 只能由当前借用 conn 的线程调用
+    MYSQL_STMT *GetStmt(MYSQL *conn, const char *sql);
+    // 执行出错后由借用者调用：关闭 conn 上所有预编译语句（下次使用时重新 prepare），连接已断开时就地重连
+    void ResetStmts(MYSQL *conn);
+
     void Init(const char* host, int port,
-              const char* user,const char* pwd, 
-              const char* dbName, int connSize);// 初始化
+              const char* user,const char* pwd,
+              const char* dbName, int connSize,
+              int minConn = MIN_CONN);// 初始化，connSize 为最大连接数
     void ClosePool();// 销毁所有连接
 
+    static const int MIN_CONN = 2;              // 默认的最小连接数
+    static const int WAIT_MS = 1000;            // GetConn 在连接数已满时的最长等待
+    static const int PING_INTERVAL_SEC = 30;    // 空闲超过该时间的连接会被 ping 检查
+    static const int IDLE_TIMEOUT_SEC = 300;    // 空闲超过该时间且多于最小连接数时关闭
+
 private:
     SqlConnPool() = default;
     ~SqlConnPool() { ClosePool(); }
 
-    int MAX_CONN_;// 最大连接数
+    typedef std::chrono::steady_clock Clock;
+    struct Idle {
+        MYSQL *conn;
+        Clock::time_point lastUsed;     // 最近一次归还的时间（决定是否收缩）
+        Clock::time_point lastCheck;    // 最近一次使用或 ping 的时间（决定是否需要 ping）
+    };
+    // 每个线程一个槽，存放该线程最近归还的连接；owner 与其他线程都通过原子交换取走
+    struct LocalSlot {
+        std::atomic<MYSQL *> conn{nullptr};
+        std::atomic<int64_t> since{0};  // 放入槽的时间（Clock 的计数）
+    };
+    struct LocalHolder;
+
+    LocalSlot *Local_();                // 当前线程的槽（第一次调用时注册）
+    void Unregister_(LocalSlot *slot);  // 线程退出：槽中的连接还给空闲队列
+    MYSQL *StealParked_();              // 持 mtx_ 调用：从其他线程的槽里取一个连接
+
+    // Connect_ 的结果：CONNECT_FAILED 时句柄已初始化（之后仍可 ping/重连/关闭），
+    // CONNECT_INIT_FAILED 时 mysql_init 失败，句柄未初始化，不能再 mysql_close / mysql_ping
+    enum CONNECT_RESULT { CONNECT_OK, CONNECT_FAILED, CONNECT_INIT_FAILED };
+    MYSQL *Open_();                     // 新建一个连接（不持锁），失败返回 nullptr
+    CONNECT_RESULT Connect_(MYSQL *conn);     // 在已分配的句柄上建立连接
+    CONNECT_RESULT Reconnect_(MYSQL *conn);   // 关闭并在同一句柄上重连
+    void Close_(MYSQL *conn);           // 关闭并释放连接
+    void CloseStmts_(MYSQL *conn);
+    void Keeper_();                     // 后台线程：收回长时间放在槽里的连接、ping、收缩、补足最小连接数
+
+    std::string host_, user_, pwd_, dbName_;
+    int port_ = 0;
 
-    std::queue<MYSQL *> connQue_;// 连接池
+    int MAX_CONN_ = 0;// 最大连接数
+    int minConn_ = 0;
+    int total_ = 0;// 已建立（包括借出、放在槽里、正在建立）的连接数
+    std::atomic<bool> isClose_{true};
+
+    std::deque<Idle> idle_;// 空闲连接，尾部为最近归还
+    std::vector<LocalSlot *> slots_;// 已注册的线程槽
+    std::atomic<int> waiters_{0};// 正在等待连接的线程数，大于 0 时 FreeConn 不再放入线程槽
+    // 借用者 ResetStmts 重连时 mysql_init 失败的句柄：归还时直接释放（不 mysql_close）并减少 total_
+    std::unordered_set<MYSQL *> broken_;
+    std::atomic<bool> hasBroken_{false};
     std::mutex mtx_;// 互斥锁
-    sem_t semId_;// 信号量
+    std::condition_variable cond_;// 有连接归还时唤醒等待者
+    std::condition_variable keeperCond_;
+    std::thread keeper_;
+
+    // 每个连接的预编译语句：conn -> (sql -> stmt)，连接被借出期间只有借用者访问它自己的那一项
+    std::unordered_map<MYSQL *, std::unordered_map<std::string, MYSQL_STMT *>> stmts_;
+    std::mutex stmtMtx_;// 保护 stmts_ 的结构（查找/插入连接项）
 };
 
 /* 资源在对象构造初始化 资源在对象析构时释放*/
@@ -39,15 +110,17 @@ public:
     // 从 connpool 获取连接，并把连接地址写回到调用者提供的指针 sql
     SqlConnRAII(MYSQL** sql, SqlConnPool *connpool) {
         assert(connpool);
+        int64_t start = Metrics::Now();
         *sql = connpool->GetConn();
+        Metrics::ObserveSince(HIST_SQL_WAIT, start);
         sql_ = *sql;
         connpool_ = connpool;
     }
-    
+
     ~SqlConnRAII() {
         if(sql_) { connpool_->FreeConn(sql_); }
     }
-    
+
 private:
     MYSQL *sql_;
     SqlConnPool* connpool_;
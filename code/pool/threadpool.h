@@ -1,11 +1,262 @@
 #ifndef THREADPOOL_H
 #define THREADPOOL_H
 
-#include <queue>
-#include <functional>
+#include <new>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+#include <pthread.h>
+#include <sched.h>
 
+/*
+ * Task：只能移动的可调用对象，替代 std::function<void()>
+ * 不超过 INLINE_SIZE 字节的可调用对象（如 std::bind(&Reactor::OnRead_, this, client)）直接放在对象内部，
+ * 入队、出队都不分配内存；更大的可调用对象才退化为堆上分配。
+ */
+class Task
+{
+public:
+    static const size_t INLINE_SIZE = 48;
+
+    Task() : ops_(nullptr) {}
+
+    template <typename F, typename = typename std::enable_if<
+                              !std::is_same<typename std::decay<F>::type, Task>::value>::type>
+    Task(F &&f) : ops_(nullptr)
+    {
+        typedef typename std::decay<F>::type Fn;
+        Construct_<Fn>(std::forward<F>(f), std::integral_constant<bool, IsInline_<Fn>()>());
+    }
+
+    Task(Task &&other) noexcept : ops_(other.ops_)
+    {
+        if (ops_)
+        {
+            ops_->move(storage_, other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            ops_ = other.ops_;
+            if (ops_)
+            {
+                ops_->move(storage_, other.storage_);
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task() { Reset(); }
+
+    void operator()() { ops_->invoke(storage_); }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    void Reset()
+    {
+        if (ops_)
+        {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    struct Ops
+    {
+        void (*invoke)(void *);
+        void (*move)(void *dst, void *src); // 移动构造到 dst 并析构 src
+        void (*destroy)(void *);
+    };
+
+    template <typename Fn>
+    static constexpr bool IsInline_()
+    {
+        return sizeof(Fn) <= INLINE_SIZE && alignof(Fn) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible<Fn>::value;
+    }
+
+    // 内联存储：可调用对象直接构造在 storage_ 中
+    template <typename Fn, typename F>
+    void Construct_(F &&f, std::true_type)
+    {
+        static const Ops ops = {
+            [](void *p) { (*static_cast<Fn *>(p))(); },
+            [](void *dst, void *src) {
+                new (dst) Fn(std::move(*static_cast<Fn *>(src)));
+                static_cast<Fn *>(src)->~Fn();
+            },
+            [](void *p) { static_cast<Fn *>(p)->~Fn(); },
+        };
+        new (storage_) Fn(std::forward<F>(f));
+        ops_ = &ops;
+    }
+
+    // 堆存储：storage_ 中只保存指针
+    template <typename Fn, typename F>
+    void Construct_(F &&f, std::false_type)
+    {
+        static const Ops ops = {
+            [](void *p) { (**static_cast<Fn **>(p))(); },
+            [](void *dst, void *src) { *static_cast<Fn **>(dst) = *static_cast<Fn **>(src); },
+            [](void *p) { delete *static_cast<Fn **>(p); },
+        };
+        *reinterpret_cast<Fn **>(storage_) = new Fn(std::forward<F>(f));
+        ops_ = &ops;
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[INLINE_SIZE];
+    const Ops *ops_;
+};
+
+/*
+ * TaskQueue：有界多生产者多消费者无锁队列（Dmitry Vyukov 的 bounded MPMC queue）
+ * 每个槽位带一个序号，生产者/消费者通过 CAS 认领槽位后独占地构造/取出 Task，
+ * 因此 Task 可以原地存放在槽位中而不必逐个分配。
+ */
+class TaskQueue
+{
+public:
+    explicit TaskQueue(size_t capacity) : cells_(new Cell[capacity]), mask_(capacity - 1),
+                                          pad0_(), enqueuePos_(0), pad1_(), dequeuePos_(0)
+    {
+        // 容量必须是 2 的幂
+        for (size_t i = 0; i < capacity; i++)
+        {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~TaskQueue()
+    {
+        Task task;
+        while (Pop(task))
+        {
+        }
+    }
+
+    TaskQueue(const TaskQueue &) = delete;
+    TaskQueue &operator=(const TaskQueue &) = delete;
+
+    // 队列满时返回 false，task 保持不变
+    bool Push(Task &task)
+    {
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true)
+        {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        new (cell->data) Task(std::move(task));
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 队列空时返回 false
+    bool Pop(Task &task)
+    {
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true)
+        {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        Task *slot = reinterpret_cast<Task *>(cell->data);
+        task = std::move(*slot);
+        slot->~Task();
+        cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 近似的排队任务数（并发下可能过时），只用于监控
+    size_t Size() const
+    {
+        size_t enq = enqueuePos_.load(std::memory_order_relaxed);
+        size_t deq = dequeuePos_.load(std::memory_order_relaxed);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    // 近似判断（并发下可能过时），只用于空闲线程休眠前的检查
+    bool Empty() const
+    {
+        return enqueuePos_.load(std::memory_order_seq_cst) == dequeuePos_.load(std::memory_order_seq_cst);
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> seq;
+        alignas(Task) unsigned char data[sizeof(Task)];
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    const size_t mask_;
+    // 生产者与消费者的位置分开放在不同缓存行，避免伪共享
+    // （用填充而不是 alignas(64)：C++14 的 new 不保证超对齐）
+    char pad0_[64];
+    std::atomic<size_t> enqueuePos_;
+    char pad1_[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeuePos_;
+};
+
+/*
+ * ThreadPool：工作窃取线程池
+ *  - 每个 worker 一个无锁任务队列；外部线程（Reactor）提交的任务轮询放入各 worker 的队列，
+ *    worker 线程内提交的任务放入自己的队列
+ *  - worker 先取自己的队列，为空时依次从其他 worker 的队列窃取
+ *  - 空闲 worker 先自旋 SPIN_COUNT 轮再休眠；提交方只在确实有线程休眠时才加锁唤醒
+ *  - 析构（或 Shutdown）时等待所有已提交的任务执行完，再 join 全部线程
+ */
 class ThreadPool
 {
 public:
@@ -13,44 +264,26 @@ public:
     ThreadPool(ThreadPool &&) = default;
     ~ThreadPool()
     {
-        if (pool_)
-        {
-            std::unique_lock<std::mutex> lock(pool_->mutex_);
-            pool_->closed_ = true;
-        }
-        pool_->cond_.notify_all();
+        Shutdown();
     }
 
     explicit ThreadPool(int threadCount = 8) : pool_(std::make_shared<POOL>())
     {
-        pool_->closed_ = false;
+        if (threadCount <= 0)
+        {
+            threadCount = 1;
+        }
         for (int i = 0; i < threadCount; ++i)
         {
-            std::thread([pool = pool_]
-                        {
-                std::unique_lock<std::mutex> lock(pool->mutex_);
-                while (true)
-                {
-                    if (!pool->tasks_.empty())
-                    {
-                        auto task = std::move(pool->tasks_.front());
-                        pool->tasks_.pop();
-                        lock.unlock();
-                        task();
-                        lock.lock();
-                    }
-                    else if (pool->closed_)
-                    {
-                        break;
-                    }
-                    else
-                    {
-                        pool->cond_.wait(lock);
-                    }
-                } })
-                .detach();
+            pool_->queues_.emplace_back(new TaskQueue(QUEUE_CAPACITY));
+        }
+        for (int i = 0; i < threadCount; ++i)
+        {
+            pool_->threads_.emplace_back([pool = pool_.get(), i]
+                                         { pool->Run(i); });
         }
     }
+
     template <typename T>
     void AddTask(T &&task)
     {
@@ -58,22 +291,215 @@ public:
         {
             throw std::runtime_error("ThreadPool is not initialized");
         }
+        pool_->Submit(Task(std::forward<T>(task)));
+    }
+
+    // 停止接收新任务，执行完已提交的任务后 join 所有线程（可重复调用）
+    void Shutdown()
+    {
+        if (!pool_ || pool_->threads_.empty())
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> locker(pool_->mutex_);
+            pool_->closed_ = true;
+        }
+        pool_->cond_.notify_all();
+        for (auto &t : pool_->threads_)
+        {
+            if (t.joinable())
+            {
+                t.join();
+            }
+        }
+        pool_->threads_.clear();
+    }
+
+    // 把第 i 个 worker 绑定到 cpus[i % cpus.size()]（cpus 为空时不绑定），全部成功返回 true
+    bool PinWorkers(const std::vector<int> &cpus)
+    {
+        bool ok = true;
+        if (!pool_ || cpus.empty())
+        {
+            return ok;
+        }
+        for (size_t i = 0; i < pool_->threads_.size(); i++)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpus[i % cpus.size()], &set);
+            ok = pthread_setaffinity_np(pool_->threads_[i].native_handle(), sizeof(set), &set) == 0 && ok;
+        }
+        return ok;
+    }
+
+    // 所有 worker 队列中排队的任务数（近似值，用于 /metrics）
+    size_t QueueDepth() const
+    {
+        size_t depth = 0;
+        if (pool_)
         {
-            std::unique_lock<std::mutex> lock(pool_->mutex_);
-            pool_->tasks_.emplace(std::forward<T>(task));
+            for (const auto &q : pool_->queues_)
+            {
+                depth += q->Size();
+            }
         }
-        pool_->cond_.notify_one();
+        return depth;
     }
 
+    static const size_t QUEUE_CAPACITY = 1024; // 每个 worker 队列的容量（2 的幂）
+    static const int SPIN_COUNT = 64;          // 休眠前的自旋轮数
+
 private:
     struct POOL
     {
-        std::mutex mutex_;
+        POOL() : closed_(false), sleepers_(0), next_(0) {}
+
+        // 当前线程若是本线程池的 worker，返回其下标，否则返回 -1
+        int CurrentIndex()
+        {
+            return Current_().pool == this ? Current_().index : -1;
+        }
+
+        void Submit(Task task)
+        {
+            const size_t n = queues_.size();
+            int self = CurrentIndex();
+            if (self >= 0)
+            {
+                // worker 内提交：放入自己的队列，满了直接执行，避免 worker 互相等待
+                if (!queues_[self]->Push(task))
+                {
+                    task();
+                    return;
+                }
+            }
+            else
+            {
+                size_t start = next_.fetch_add(1, std::memory_order_relaxed);
+                for (size_t k = 0; !queues_[(start + k) % n]->Push(task); k++)
+                {
+                    if (k + 1 >= n)
+                    {
+                        std::this_thread::yield(); // 所有队列都满：等待 worker 消化（反压）
+                        k = static_cast<size_t>(-1);
+                    }
+                }
+            }
+            Wake_();
+        }
+
+        void Run(int index)
+        {
+            Current_().pool = this;
+            Current_().index = index;
+            Task task;
+            while (true)
+            {
+                if (TryGet_(index, task))
+                {
+                    task();
+                    task.Reset();
+                    continue;
+                }
+                bool found = false;
+                for (int i = 0; i < SPIN_COUNT && !found; i++)
+                {
+                    CpuRelax_();
+                    found = TryGet_(index, task);
+                }
+                if (found)
+                {
+                    task();
+                    task.Reset();
+                    continue;
+                }
+                std::unique_lock<std::mutex> locker(mutex_);
+                if (closed_ && !HasWork_())
+                {
+                    break;
+                }
+                sleepers_.fetch_add(1, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                // 登记休眠后再检查一次，与 Wake_ 中"先入队、再读 sleepers_"配对，避免丢失唤醒
+                if (!HasWork_() && !closed_)
+                {
+                    cond_.wait(locker);
+                }
+                sleepers_.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        std::vector<std::unique_ptr<TaskQueue>> queues_;
+        std::vector<std::thread> threads_;
+        std::mutex mutex_; // 只用于休眠/唤醒
         std::condition_variable cond_;
         bool closed_;
-        std::queue<std::function<void()>> tasks_;
+        std::atomic<int> sleepers_; // 正在休眠（或准备休眠）的 worker 数
+        std::atomic<size_t> next_;  // 外部提交的轮询起点
+
+    private:
+        struct WorkerSlot
+        {
+            POOL *pool = nullptr;
+            int index = -1;
+        };
+
+        static WorkerSlot &Current_()
+        {
+            static thread_local WorkerSlot slot;
+            return slot;
+        }
+
+        // 先取自己的队列，再从其他队列窃取
+        bool TryGet_(int index, Task &task)
+        {
+            const size_t n = queues_.size();
+            for (size_t k = 0; k < n; k++)
+            {
+                if (queues_[(index + k) % n]->Pop(task))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool HasWork_() const
+        {
+            for (const auto &q : queues_)
+            {
+                if (!q->Empty())
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void Wake_()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (sleepers_.load(std::memory_order_seq_cst) > 0)
+            {
+                {
+                    std::lock_guard<std::mutex> locker(mutex_);
+                }
+                cond_.notify_one();
+            }
+        }
+
+        static void CpuRelax_()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#else
+            std::this_thread::yield();
+#endif
+        }
     };
     std::shared_ptr<POOL> pool_;
 };
 
-#endif // THREADPOOL_H
\ No newline at end of file
+#endif // THREADPOOL_H
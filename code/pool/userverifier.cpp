@@ -0,0 +1,248 @@
+#include "userverifier.h"
+
+namespace {
+const char* SELECT_PWD = "SELECT password FROM user WHERE username=? LIMIT 1";
+const char* INSERT_USER = "INSERT INTO user(username, password) VALUES(?, ?)";
+
+void BindString(MYSQL_BIND& bind, const std::string& str, unsigned long* len) {
+    memset(&bind, 0, sizeof(bind));
+    *len = str.size();
+    bind.buffer_type = MYSQL_TYPE_STRING;
+    bind.buffer = const_cast<char*>(str.data());
+    bind.buffer_length = str.size();
+    bind.length = len;
+}
+} // namespace
+
+UserVerifier::UserVerifier() : maxQueue_(MAX_QUEUE), isClose_(true) {
+    if (getrandom(salt_, sizeof(salt_), 0) != static_cast<ssize_t>(sizeof(salt_))) {
+        // 取不到随机数时退化为时间与地址，仍然保证缓存中没有明文密码
+        uint64_t seed[2] = {static_cast<uint64_t>(Clock::now().time_since_epoch().count()),
+                            reinterpret_cast<uintptr_t>(this)};
+        memcpy(salt_, seed, sizeof(salt_));
+    }
+}
+
+UserVerifier::~UserVerifier() {
+    Shutdown();
+}
+
+UserVerifier* UserVerifier::Instance() {
+    static UserVerifier verifier;
+    return &verifier;
+}
+
+void UserVerifier::Init(int threadNum, size_t maxQueue) {
+    assert(threadNum > 0);
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (!isClose_) {
+        return;
+    }
+    isClose_ = false;
+    maxQueue_ = maxQueue;
+    for (int i = 0; i < threadNum; i++) {
+        threads_.emplace_back(&UserVerifier::Worker_, this);
+    }
+}
+
+void UserVerifier::Shutdown() {
+    std::deque<Job> left;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (isClose_) {
+            return;
+        }
+        isClose_ = true;
+    }
+    cond_.notify_all();
+    for (auto& t : threads_) {
+        t.join();
+    }
+    threads_.clear();
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        left.swap(jobs_);
+    }
+    for (Job& job : left) {
+        job.cb(VERIFY_BUSY);
+    }
+}
+
+bool UserVerifier::Submit(const std::string& name, const std::string& pwd, bool isLogin, Callback cb) {
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (isClose_ || jobs_.size() >= maxQueue_) {
+            return false;
+        }
+        jobs_.push_back({name, pwd, isLogin, std::move(cb)});
+    }
+    cond_.notify_one();
+    return true;
+}
+
+UserVerifier::RESULT UserVerifier::Verify(const std::string& name, const std::string& pwd, bool isLogin) {
+    RESULT result;
+    if (TryCache(name, pwd, isLogin, &result)) {
+        return result;
+    }
+    result = Query_(name, pwd, isLogin);
+    if (result == VERIFY_OK) {
+        CachePut_(name, pwd);
+    }
+    return result;
+}
+
+void UserVerifier::Worker_() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> locker(mtx_);
+            cond_.wait(locker, [this] { return isClose_ || !jobs_.empty(); });
+            if (isClose_) {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        RESULT result = Query_(job.name, job.pwd, job.isLogin);
+        if (result == VERIFY_OK) {
+            CachePut_(job.name, job.pwd);
+        }
+        job.cb(result);
+    }
+}
+
+UserVerifier::RESULT UserVerifier::Query_(const std::string& name, const std::string& pwd, bool isLogin) {
+    if (name.empty() || pwd.empty()) {
+        return VERIFY_FAIL;
+    }
+    LOG_INFO("Verify name:%s (%s)", name, isLogin ? "login" : "register");
+    MYSQL* sql = nullptr;
+    SqlConnRAII conn(&sql, SqlConnPool::Instance());
+    if (!sql) {
+        LOG_WARN("Verify name:%s, no MySQL connection", name);
+        return VERIFY_FAIL;
+    }
+    bool ok = false;
+    bool done = isLogin ? Login_(sql, name, pwd, &ok) : Register_(sql, name, pwd, &ok);
+    if (!done) {
+        SqlConnPool::Instance()->ResetStmts(sql);   // 语句可能已失效（例如连接断开），下次重新 prepare
+        return VERIFY_FAIL;
+    }
+    return ok ? VERIFY_OK : VERIFY_FAIL;
+}
+
+// 查询密码并比较；语句执行成功返回 true，*ok 为是否匹配
+bool UserVerifier::Login_(MYSQL* sql, const std::string& name, const std::string& pwd, bool* ok) {
+    MYSQL_STMT* stmt = SqlConnPool::Instance()->GetStmt(sql, SELECT_PWD);
+    if (!stmt) {
+        return false;
+    }
+    MYSQL_BIND param;
+    unsigned long nameLen;
+    BindString(param, name, &nameLen);
+    char buf[256];
+    unsigned long len = 0;
+    MYSQL_BIND result;
+    memset(&result, 0, sizeof(result));
+    result.buffer_type = MYSQL_TYPE_STRING;
+    result.buffer = buf;
+    result.buffer_length = sizeof(buf);
+    result.length = &len;
+    if (mysql_stmt_bind_param(stmt, &param) || mysql_stmt_execute(stmt) ||
+        mysql_stmt_bind_result(stmt, &result) || mysql_stmt_store_result(stmt)) {
+        LOG_ERROR("Login query error: %s", mysql_stmt_error(stmt));
+        return false;
+    }
+    int ret = mysql_stmt_fetch(stmt);
+    // 被截断（密码超过 buf）时 len 是完整长度，与 pwd 长度必然不同
+    *ok = (ret == 0 && len == pwd.size() && memcmp(buf, pwd.data(), len) == 0);
+    mysql_stmt_free_result(stmt);
+    return ret == 0 || ret == MYSQL_NO_DATA || ret == MYSQL_DATA_TRUNCATED;
+}
+
+// 用户名不存在时插入；语句执行成功返回 true，*ok 为是否注册成功
+bool UserVerifier::Register_(MYSQL* sql, const std::string& name, const std::string& pwd, bool* ok) {
+    MYSQL_STMT* select = SqlConnPool::Instance()->GetStmt(sql, SELECT_PWD);
+    MYSQL_STMT* insert = SqlConnPool::Instance()->GetStmt(sql, INSERT_USER);
+    if (!select || !insert) {
+        return false;
+    }
+    MYSQL_BIND param[2];
+    unsigned long lens[2];
+    BindString(param[0], name, &lens[0]);
+    BindString(param[1], pwd, &lens[1]);
+    if (mysql_stmt_bind_param(select, param) || mysql_stmt_execute(select) || mysql_stmt_store_result(select)) {
+        LOG_ERROR("Register query error: %s", mysql_stmt_error(select));
+        return false;
+    }
+    bool exists = mysql_stmt_num_rows(select) > 0;
+    mysql_stmt_free_result(select);
+    if (exists) {
+        *ok = false;    // 用户名已存在
+        return true;
+    }
+    if (mysql_stmt_bind_param(insert, param) || mysql_stmt_execute(insert)) {
+        LOG_ERROR("Register insert error: %s", mysql_stmt_error(insert));
+        return false;
+    }
+    *ok = mysql_stmt_affected_rows(insert) == 1;
+    return true;
+}
+
+std::string UserVerifier::Hash_(const std::string& name, const std::string& pwd) const {
+    std::string input(reinterpret_cast<const char*>(salt_), sizeof(salt_));
+    input += name;
+    input.push_back('\0');
+    input += pwd;
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const unsigned char*>(input.data()), input.size(), digest);
+    return std::string(reinterpret_cast<const char*>(digest), sizeof(digest));
+}
+
+bool UserVerifier::TryCache(const std::string& name, const std::string& pwd, bool isLogin, RESULT* result) {
+    if (name.empty() || pwd.empty()) {
+        *result = VERIFY_FAIL;
+        return true;
+    }
+    std::string hash = isLogin ? Hash_(name, pwd) : std::string();   // 锁外计算
+    std::lock_guard<std::mutex> locker(cacheMtx_);
+    auto it = index_.find(name);
+    if (it == index_.end()) {
+        return false;
+    }
+    if (Clock::now() >= it->second->expires) {
+        lru_.erase(it->second);
+        index_.erase(it);
+        return false;
+    }
+    if (!isLogin) {
+        *result = VERIFY_FAIL;  // 用户名已存在
+        return true;
+    }
+    if (it->second->hash != hash) {
+        return false;           // 密码不同：交给数据库判断
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    *result = VERIFY_OK;
+    return true;
+}
+
+void UserVerifier::CachePut_(const std::string& name, const std::string& pwd) {
+    std::string hash = Hash_(name, pwd);
+    Clock::time_point expires = Clock::now() + std::chrono::seconds(CACHE_TTL_SEC);
+    std::lock_guard<std::mutex> locker(cacheMtx_);
+    auto it = index_.find(name);
+    if (it != index_.end()) {
+        it->second->hash.swap(hash);
+        it->second->expires = expires;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+    lru_.push_front({name, hash, expires});
+    index_[name] = lru_.begin();
+    while (lru_.size() > CACHE_CAPACITY) {
+        index_.erase(lru_.back().name);
+        lru_.pop_back();
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef USER_VERIFIER_H
+#define USER_VERIFIER_H
+
+#include <mysql/mysql.h>
+#include <openssl/sha.h>    // SHA256
+#include <sys/random.h>     // getrandom
+#include <string.h>
+#include <assert.h>
+#include <string>
+#include <deque>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include "sqlconnpool.h"
+#include "../log/log.h"
+
+/*
+ * UserVerifier：登录/注册的异步校验（单例）
+ *  - 专用的数据库线程从有界队列取任务，借用 SqlConnPool 的连接执行预编译语句（不再拼接 SQL），
+ *    慢查询只占用数据库线程，不占用处理静态请求的 worker / Reactor
+ *  - Submit 不阻塞：队列满时直接返回 false，调用方回复 503
+ *  - 校验成功的用户名与加盐的 SHA-256(密码) 放进有界 LRU 缓存（带过期时间），
+ *    命中时 TryCache 直接给出结果，不进队列；注册时缓存中已有的用户名直接判定为已存在
+ *  - 完成回调在数据库线程中调用，调用者自己负责把结果转回所属线程（Reactor::RunInLoop）
+ */
+class UserVerifier {
+public:
+    enum RESULT {
+        VERIFY_OK,      // 登录成功 / 注册成功
+        VERIFY_FAIL,    // 用户名或密码错误 / 用户名已存在 / 数据库出错
+        VERIFY_BUSY,    // 队列已满，没有执行
+    };
+    typedef std::function<void(RESULT)> Callback;
+
+    static UserVerifier* Instance();
+
+    // 启动 threadNum 个数据库线程（通常不超过连接池大小）
+    void Init(int threadNum, size_t maxQueue = MAX_QUEUE);
+    // 停止数据库线程：正在执行的任务完成，排队中的任务以 VERIFY_BUSY 回调
+    void Shutdown();
+
+    // 只查缓存：命中时写入 *result 并返回 true
+    bool TryCache(const std::string& name, const std::string& pwd, bool isLogin, RESULT* result);
+    // 提交异步校验，cb 在数据库线程中调用；未初始化或队列满时返回 false（cb 不会被调用）
+    bool Submit(const std::string& name, const std::string& pwd, bool isLogin, Callback cb);
+    // 同步校验（先查缓存），在调用线程中执行
+    RESULT Verify(const std::string& name, const std::string& pwd, bool isLogin);
+
+    static const size_t MAX_QUEUE = 1024;        // 默认的排队上限
+    static const size_t CACHE_CAPACITY = 4096;   // 缓存的用户数上限
+    static const int CACHE_TTL_SEC = 300;        // 缓存条目的有效期
+
+private:
+    UserVerifier();
+    ~UserVerifier();
+
+    struct Job {
+        std::string name;
+        std::string pwd;
+        bool isLogin;
+        Callback cb;
+    };
+
+    typedef std::chrono::steady_clock Clock;
+    struct CacheNode {
+        std::string name;
+        std::string hash;               // SHA-256(salt + name + '\0' + pwd)
+        Clock::time_point expires;
+    };
+
+    void Worker_();
+    RESULT Query_(const std::string& name, const std::string& pwd, bool isLogin);
+    bool Login_(MYSQL* sql, const std::string& name, const std::string& pwd, bool* ok);
+    bool Register_(MYSQL* sql, const std::string& name, const std::string& pwd, bool* ok);
+    std::string Hash_(const std::string& name, const std::string& pwd) const;
+    void CachePut_(const std::string& name, const std::string& pwd);
+
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    std::deque<Job> jobs_;
+    size_t maxQueue_;
+    bool isClose_;
+    std::vector<std::thread> threads_;
+
+    std::mutex cacheMtx_;
+    std::list<CacheNode> lru_;          // 头部为最近使用
+    std::unordered_map<std::string, std::list<CacheNode>::iterator> index_;
+    unsigned char salt_[16];            // 进程启动时随机生成，缓存中不保存明文密码
+};
+
+#endif //USER_VERIFIER_H
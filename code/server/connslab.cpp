@@ -0,0 +1,17 @@
+#include "connslab.h"
+
+ConnSlab::ConnSlab(int capacity, int prealloc) : conns_(capacity) {
+    assert(capacity > 0);
+    for (int fd = 0; fd < prealloc && fd < capacity; fd++) {
+        conns_[fd].reset(new HttpConn());
+    }
+}
+
+HttpConn* ConnSlab::Acquire(int fd) {
+    assert(fd >= 0 && fd < static_cast<int>(conns_.size()));
+    std::unique_ptr<HttpConn>& slot = conns_[fd];
+    if (!slot) {
+        slot.reset(new HttpConn());
+    }
+    return slot.get();
+}
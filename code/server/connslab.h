@@ -0,0 +1,48 @@
+#ifndef CONN_SLAB_H
+#define CONN_SLAB_H
+
+#include <vector>
+#include <memory>
+#include <assert.h>
+
+#include "../http/httpconn.h"
+
+/*
+ * ConnSlab：以 fd 为下标的连接表（每个 Reactor 一个，仅本 Reactor 线程调用 Acquire）
+ *  - 下标表在构造时一次性分配好，查找就是一次数组访问，不会像 unordered_map 那样 rehash，
+ *    已交给 worker 线程/定时器的 HttpConn* 始终有效
+ *  - HttpConn 在某个 fd 第一次使用时创建（或构造时按 prealloc 预先创建），连接关闭后不释放，
+ *    同一 fd 的下一个连接直接复用它（连同已分配的读写缓冲区）
+ *  - HttpConn 每次 init 都会递增代数（generation），持有旧指针的一方据此判断连接是否已被复用
+ */
+class ConnSlab {
+public:
+    // capacity：支持的最大 fd（不含）；prealloc：预先创建 fd 为 [0, prealloc) 的 HttpConn
+    explicit ConnSlab(int capacity, int prealloc = 0);
+    ~ConnSlab() = default;
+
+    ConnSlab(const ConnSlab&) = delete;
+    ConnSlab& operator=(const ConnSlab&) = delete;
+
+    // 取得 fd 对应的 HttpConn（不存在时创建），fd 必须小于 Capacity()
+    HttpConn* Acquire(int fd);
+
+    // 直接下标访问，fd 从未使用过或越界时返回 nullptr
+    HttpConn* Get(int fd) const {
+        if (fd < 0 || fd >= static_cast<int>(conns_.size())) { return nullptr; }
+        return conns_[fd].get();
+    }
+
+    // 只有连接仍是 generation 那一代时才返回它（用于异步任务、回调中的校验）
+    HttpConn* Get(int fd, uint32_t generation) const {
+        HttpConn* conn = Get(fd);
+        return (conn && conn->GetGeneration() == generation) ? conn : nullptr;
+    }
+
+    int Capacity() const { return static_cast<int>(conns_.size()); }
+
+private:
+    std::vector<std::unique_ptr<HttpConn>> conns_;
+};
+
+#endif //CONN_SLAB_H
@@ -21,6 +21,9 @@ bool Epoller::ModFd(int fd, uint32_t events) {
     epoll_event ev = {0};
     ev.data.fd = fd;
     ev.events = events;
+#if defined(__SANITIZE_THREAD__)
+    tsanSync_.fetch_add(1, std::memory_order_release);
+#endif
     return 0 == epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev);
 }
 
@@ -31,7 +34,11 @@ bool Epoller::DelFd(int fd) {
 
 // 返回事件数量
 int Epoller::Wait(int timeoutMs) {
-    return epoll_wait(epollFd_, &events_[0], static_cast<int>(events_.size()), timeoutMs);
+    int n = epoll_wait(epollFd_, &events_[0], static_cast<int>(events_.size()), timeoutMs);
+#if defined(__SANITIZE_THREAD__)
+    tsanSync_.load(std::memory_order_acquire);
+#endif
+    return n;
 }
 
 // 获取事件的fd
@@ -0,0 +1,27 @@
+#ifndef POLLER_H
+#define POLLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/epoll.h>  // EPOLLIN 等事件掩码，两种实现共用
+
+/*
+ * Poller：Reactor 使用的 I/O 事件后端接口，事件掩码统一使用 EPOLL* 的取值
+ *  - Epoller    ：epoll，AddFd/ModFd/DelFd 立即生效（一次 epoll_ctl）
+ *  - UringPoller：io_uring 的 poll 请求，修改先排进提交队列，在下一次 Wait 时与等待合并成一次 io_uring_enter
+ * AddFd/ModFd/DelFd 可以在 worker 线程调用（经典模式下重新注册 EPOLLONESHOT），Wait 只在事件循环线程调用。
+ */
+class Poller {
+public:
+    virtual ~Poller() = default;
+
+    virtual bool AddFd(int fd, uint32_t events) = 0;
+    virtual bool ModFd(int fd, uint32_t events) = 0;
+    virtual bool DelFd(int fd) = 0;
+    // 等待事件，返回就绪的事件数（超时返回 0，出错返回 -1）
+    virtual int Wait(int timeoutMs = -1) = 0;
+    virtual int GetEventFd(size_t i) const = 0;
+    virtual uint32_t GetEvents(size_t i) const = 0;
+};
+
+#endif //POLLER_H
@@ -0,0 +1,732 @@
+#include "reactor.h"
+
+using namespace std;
+
+Reactor::Reactor(int listenFd, uint32_t listenEvent, uint32_t connEvent,
+                 int timeoutMS, ThreadPool *threadpool, int wheelTickMS, bool useUring, int maxConn) : listenFd_(listenFd), wakeupFd_(-1), idleFd_(-1),
+                                                          maxConn_(maxConn > 0 && maxConn < MAX_FD ? maxConn : static_cast<int>(MAX_FD)), listenPending_(false), listenPaused_(false),
+                                                          listenEvent_(listenEvent), connEvent_(connEvent),
+                                                          timeoutMS_(timeoutMS), isClose_(false), isUring_(false),
+                                                          persistent_(!threadpool && (connEvent & EPOLLET)), draining_(false), threadpool_(threadpool),
+                                                          users_(MAX_FD)
+{
+    if (persistent_)
+    {
+        // 只有本线程处理连接，不需要 ONESHOT；EPOLLOUT 一直关注，ET 下只在发送缓冲区由满变为可写时上报
+        connEvent_ = (connEvent_ & ~EPOLLONESHOT) | EPOLLOUT;
+    }
+    if (useUring)
+    {
+        std::unique_ptr<UringPoller> uring(new UringPoller());
+        if (uring->IsValid())
+        {
+            epoller_ = std::move(uring);
+            isUring_ = true;
+        }
+    }
+    if (!epoller_)
+    {
+        epoller_.reset(new Epoller());
+    }
+    if (wheelTickMS > 0)
+    {
+        // 超时时间需要落在一圈之内才不用多圈等待：槽数取能覆盖 timeoutMS 的值
+        int slotNum = timeoutMS > 0 ? timeoutMS / wheelTickMS + 2 : 512;
+        timer_.reset(new TimeWheel(wheelTickMS, slotNum));
+    }
+    else
+    {
+        timer_.reset(new HeapTimer());
+    }
+}
+
+Reactor::~Reactor()
+{
+    if (wakeupFd_ >= 0)
+    {
+        close(wakeupFd_);
+    }
+    if (idleFd_ >= 0)
+    {
+        close(idleFd_);
+    }
+}
+
+// 把监听套接字与唤醒用的 eventfd 加入本 Reactor 的 epoller
+bool Reactor::Init()
+{
+    if (!epoller_->AddFd(listenFd_, listenEvent_ | EPOLLIN))
+    {
+        LOG_ERROR("Add listen error!");
+        return false;
+    }
+    SetFdNonblock(listenFd_);
+
+    wakeupFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeupFd_ < 0 || !epoller_->AddFd(wakeupFd_, EPOLLIN))
+    {
+        LOG_ERROR("Create wakeup eventfd error!");
+        return false;
+    }
+    idleFd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return true;
+}
+
+// 事件循环，等待和处理事件
+void Reactor::Loop()
+{
+    while (!isClose_)
+    {
+        int timeMS = -1; /* epoll wait timeout == -1 无事件将阻塞 */
+        if (timeoutMS_ > 0)
+        {
+            timeMS = timer_->GetNextTick(); // 获取下一次的超时等待事件
+            if (!deferred_.empty())
+            {
+                RearmDeferred_();
+                timeMS = (timeMS < 0 || timeMS > DEFER_RETRY_MS) ? DEFER_RETRY_MS : timeMS;
+            }
+        }
+        if (!yielded_.empty() || listenPending_)
+        {
+            timeMS = 0; // 有连接等着继续写或 accept：只收集已就绪的事件，不阻塞
+        }
+        if (draining_ && (timeMS < 0 || timeMS > DRAIN_TICK_MS))
+        {
+            timeMS = DRAIN_TICK_MS; // 排空时定期检查连接是否已空闲
+        }
+        if (listenPaused_)
+        {
+            int left = static_cast<int>(std::chrono::duration_cast<MS>(listenResume_ - Clock::now()).count());
+            if (left <= 0)
+            {
+                ResumeListen_();
+            }
+            else if (timeMS < 0 || timeMS > left)
+            {
+                timeMS = left; // 到期时恢复 accept
+            }
+        }
+        int eventCnt = epoller_->Wait(timeMS);
+        for (int i = 0; i < eventCnt; i++)
+        {
+            /* 处理事件 */
+            int fd = epoller_->GetEventFd(i);
+            uint32_t events = epoller_->GetEvents(i);
+            if (fd == listenFd_)
+            {
+                DealListen_();
+            }
+            else if (fd == wakeupFd_)
+            {
+                DealWakeup_();
+            }
+            else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            {
+                assert(users_.Get(fd));
+                CloseConn_(users_.Get(fd));
+            }
+            else if (persistent_)
+            {
+                // 读写可能在同一个事件里同时就绪
+                HttpConn *client = users_.Get(fd);
+                assert(client);
+                if (events & EPOLLIN)
+                {
+                    DealRead_(client);
+                }
+                if ((events & EPOLLOUT) && !client->IsClosed())
+                {
+                    DealWrite_(client);
+                }
+            }
+            else if (events & EPOLLIN)
+            {
+                assert(users_.Get(fd));
+                DealRead_(users_.Get(fd));
+            }
+            else if (events & EPOLLOUT)
+            {
+                assert(users_.Get(fd));
+                DealWrite_(users_.Get(fd));
+            }
+            else
+            {
+                LOG_ERROR("Unexpected event");
+            }
+        }
+        if (listenPending_)
+        {
+            DealListen_();
+        }
+        DealYielded_();
+        if (draining_)
+        {
+            DealDrain_();
+        }
+    }
+}
+
+void Reactor::Quit()
+{
+    isClose_ = true;
+    Wakeup_();
+}
+
+void Reactor::Drain(int timeoutMS)
+{
+    RunInLoop([this, timeoutMS]
+              {
+                  if (draining_)
+                  {
+                      return;
+                  }
+                  draining_ = true;
+                  drainDeadline_ = Clock::now() + MS(timeoutMS > 0 ? timeoutMS : 0);
+                  listenPending_ = false;
+                  if (listenFd_ >= 0)
+                  {
+                      epoller_->DelFd(listenFd_);
+                      close(listenFd_);
+                      listenFd_ = -1;
+                  }
+                  LOG_INFO("Reactor draining, deadline %dms", timeoutMS);
+              });
+}
+
+void Reactor::SetTimeout(int timeoutMS)
+{
+    RunInLoop([this, timeoutMS]
+              {
+                  if ((timeoutMS_ > 0) == (timeoutMS > 0))
+                  {
+                      timeoutMS_ = timeoutMS;
+                  }
+              });
+}
+
+// 已关闭的连接不算；到期后不再等待，直接关闭所有连接
+void Reactor::DealDrain_()
+{
+    bool expired = Clock::now() >= drainDeadline_;
+    int remaining = 0;
+    for (int fd = 0; fd < users_.Capacity(); fd++)
+    {
+        HttpConn *client = users_.Get(fd);
+        if (!client || client->IsClosed())
+        {
+            continue;
+        }
+        if (!client->InTask() && (expired || client->IsIdle())) // worker 正在处理的连接等它交还后再检查
+        {
+            CloseConn_(client);
+        }
+        else
+        {
+            remaining++;
+        }
+    }
+    if (remaining == 0)
+    {
+        LOG_INFO("Reactor drained%s", expired ? " (deadline exceeded)" : "");
+        isClose_ = true;
+    }
+}
+
+void Reactor::RunInLoop(std::function<void()> cb)
+{
+    {
+        std::lock_guard<std::mutex> locker(pendingMtx_);
+        pending_.push_back(std::move(cb));
+    }
+    Wakeup_();
+}
+
+void Reactor::Wakeup_()
+{
+    if (wakeupFd_ >= 0)
+    {
+        uint64_t one = 1;
+        ssize_t n = ::write(wakeupFd_, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+// 读空 eventfd 计数并执行 RunInLoop 提交的回调，退出标志由 Loop 检查
+void Reactor::DealWakeup_()
+{
+    uint64_t cnt = 0;
+    ssize_t n = ::read(wakeupFd_, &cnt, sizeof(cnt));
+    (void)n;
+    std::vector<std::function<void()>> cbs;
+    {
+        std::lock_guard<std::mutex> locker(pendingMtx_);
+        cbs.swap(pending_);
+    }
+    for (auto &cb : cbs)
+    {
+        cb();
+    }
+}
+
+// 让出的连接排在本轮所有就绪事件之后，快客户端不必等慢客户端的大文件（或大请求体）
+// 发送队列非空的接着写，否则是暂停的读，接着读
+void Reactor::DealYielded_()
+{
+    if (yielded_.empty())
+    {
+        return;
+    }
+    std::vector<std::pair<int, uint32_t>> conns;
+    conns.swap(yielded_);
+    for (const auto &item : conns)
+    {
+        HttpConn *client = users_.Get(item.first, item.second);
+        if (client && !client->IsClosed())
+        {
+            if (client->ToWriteBytes() > 0)
+            {
+                DealWrite_(client);
+            }
+            else
+            {
+                DealRead_(client);
+            }
+        }
+    }
+}
+
+// 过载：回复 503 后关闭。fd 是非阻塞的，发不出去就直接关闭，不会卡住事件循环
+void Reactor::RejectConn_(int fd)
+{
+    static const char BUSY[] = "HTTP/1.1 503 Service Unavailable\r\n"
+                               "Connection: close\r\nRetry-After: 1\r\nContent-Length: 0\r\n\r\n";
+    assert(fd >= 0);
+    // 先读掉已经到达的请求：接收缓冲区有未读数据时 close 会发 RST，客户端可能收不到 503
+    char discard[4096];
+    ssize_t n = recv(fd, discard, sizeof(discard), MSG_DONTWAIT);
+    n = send(fd, BUSY, sizeof(BUSY) - 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+    (void)n;
+    close(fd);
+    Metrics::Count(COUNTER_REJECTED);
+    LOG_DEBUG("Clients is full, reject fd[%d]", fd);
+}
+
+bool Reactor::AcceptOnFdLimit_()
+{
+    LOG_WARN("Out of file descriptors!");
+    if (idleFd_ < 0)
+    {
+        idleFd_ = open("/dev/null", O_RDONLY | O_CLOEXEC); // 上次没能重新预留：先再试一次
+    }
+    if (idleFd_ < 0)
+    {
+        PauseListen_(); // 仍然没有预留 fd：LT 监听会一直就绪，暂停 accept 一段时间
+        return false;
+    }
+    close(idleFd_);
+    int fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd >= 0)
+    {
+        RejectConn_(fd);
+    }
+    idleFd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return fd >= 0;
+}
+
+// 暂时不再关注监听 socket 的可读事件，Loop 到期后由 ResumeListen_ 恢复
+void Reactor::PauseListen_()
+{
+    if (listenPaused_ || listenFd_ < 0)
+    {
+        return;
+    }
+    if (!epoller_->ModFd(listenFd_, listenEvent_ & ~EPOLLIN))
+    {
+        LOG_ERROR("Pause listen error!");
+        return;
+    }
+    listenPaused_ = true;
+    listenPending_ = false;
+    listenResume_ = Clock::now() + MS(static_cast<int>(LISTEN_PAUSE_MS));
+    LOG_WARN("No spare fd, pause accept for %dms", LISTEN_PAUSE_MS);
+}
+
+void Reactor::ResumeListen_()
+{
+    listenPaused_ = false;
+    if (listenFd_ < 0)
+    {
+        return; // 已经 Drain：监听 socket 已关闭
+    }
+    if (idleFd_ < 0)
+    {
+        idleFd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+    if (!epoller_->ModFd(listenFd_, listenEvent_ | EPOLLIN))
+    {
+        LOG_ERROR("Resume listen error!");
+    }
+}
+
+// 关闭连接，主要逻辑是将该连接从epoller中删除，并关闭该连接的套接字
+void Reactor::CloseConn_(HttpConn *client)
+{
+    assert(client);
+    LOG_INFO("Client[%d] quit!", client->GetFd());
+    epoller_->DelFd(client->GetFd());
+    client->Close();
+}
+
+// 添加新客户端，主要逻辑是初始化HttpConn对象，并将其加入epoller和timer中
+void Reactor::AddClient_(int fd, sockaddr_in addr)
+{
+    assert(fd > 0);
+    HttpConn *client = users_.Acquire(fd);
+    client->init(fd, addr);
+    if (timeoutMS_ > 0)
+    {
+        AddTimer_(client, timeoutMS_);
+    }
+    epoller_->AddFd(fd, EPOLLIN | connEvent_); // fd 已由 accept4 设为非阻塞
+    LOG_INFO("Client[%d] in!", client->GetFd());
+}
+
+// 超时回调在本线程执行。经典模式下连接可能正在 worker 上处理（InTask），此时关闭会与 worker 竞争：
+// 记进 deferred_，tick 结束后由 RearmDeferred_ 重新加一个 DEFER_RETRY_MS 的定时器，交还之后再关闭
+// （不能在回调里直接 add：HeapTimer::tick 在回调返回后才弹出堆顶）
+void Reactor::AddTimer_(HttpConn *client, int timeoutMS)
+{
+    timer_->add(client->GetFd(), timeoutMS, [this, client]
+                {
+                    if (client->IsClosed())
+                    {
+                        return; // worker 已经关闭了连接
+                    }
+                    if (client->InTask())
+                    {
+                        Metrics::Count(COUNTER_TIMER_DEFERRED);
+                        deferred_.push_back({client->GetFd(), client->GetGeneration()});
+                        return;
+                    }
+                    Metrics::Count(COUNTER_TIMER_EXPIRED);
+                    CloseConn_(client);
+                });
+}
+
+void Reactor::RearmDeferred_()
+{
+    std::vector<std::pair<int, uint32_t>> conns;
+    conns.swap(deferred_);
+    for (const auto &item : conns)
+    {
+        HttpConn *client = users_.Get(item.first, item.second);
+        if (client && !client->IsClosed())
+        {
+            AddTimer_(client, DEFER_RETRY_MS);
+        }
+    }
+}
+
+// worker：任务开始时确认连接仍是提交时的那个。提交时已标记 BeginTask，正常情况下任务期间连接不会被关闭，
+// 丢弃的任务计入 COUNTER_STALE_TASKS
+bool Reactor::TaskAlive_(HttpConn *client, uint32_t gen)
+{
+    if (client->GetGeneration() == gen && !client->IsClosed())
+    {
+        return true;
+    }
+    Metrics::Count(COUNTER_STALE_TASKS);
+    LOG_WARN("Drop stale task for client[%d]", client->GetFd());
+    return false;
+}
+
+// 处理监听套接字：accept4 新的套接字（已是非阻塞），加入timer和epoller中；每次最多 ACCEPT_BATCH 个
+void Reactor::DealListen_()
+{
+    listenPending_ = false;
+    for (int i = 0; i < ACCEPT_BATCH; i++)
+    {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        int fd = accept4(listenFd_, (struct sockaddr *)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            if ((errno == EMFILE || errno == ENFILE) && AcceptOnFdLimit_())
+            {
+                continue;
+            }
+            return; // EAGAIN：监听队列已空
+        }
+        if (HttpConn::userCount >= maxConn_ || fd >= users_.Capacity())
+        {
+            RejectConn_(fd);
+            continue;
+        }
+        Metrics::Count(COUNTER_ACCEPTED);
+        AddClient_(fd, addr);
+    }
+    // 批量用完：LT 下剩余的连接会再次上报，ET 下不会再有边沿，本轮事件处理完后继续
+    if (listenEvent_ & EPOLLET)
+    {
+        listenPending_ = true;
+    }
+}
+
+// 处理读事件：经典模式交给线程池，内联模式直接在本线程读并处理
+void Reactor::DealRead_(HttpConn *client)
+{
+    assert(client);
+    ExtentTime_(client);
+    if (threadpool_)
+    {
+        // 从提交到 worker 交还连接，超时与排空不会关闭它（BeginTask）；代数仍作为兜底检查
+        uint32_t gen = client->GetGeneration();
+        uint32_t ticket = client->BeginTask();
+        int64_t queued = Metrics::Now();
+        threadpool_->AddTask([this, client, gen, ticket, queued]
+                             {
+                                 Metrics::ObserveSince(HIST_TASK_WAIT, queued);
+                                 if (TaskAlive_(client, gen))
+                                 {
+                                     OnRead_(client);
+                                 }
+                                 client->EndTask(ticket);
+                             });
+    }
+    else
+    {
+        OnRead_(client);
+    }
+}
+
+// 处理写事件：经典模式交给线程池，内联模式直接在本线程写
+void Reactor::DealWrite_(HttpConn *client)
+{
+    assert(client);
+    ExtentTime_(client);
+    if (threadpool_)
+    {
+        uint32_t gen = client->GetGeneration();
+        uint32_t ticket = client->BeginTask();
+        int64_t queued = Metrics::Now();
+        threadpool_->AddTask([this, client, gen, ticket, queued]
+                             {
+                                 Metrics::ObserveSince(HIST_TASK_WAIT, queued);
+                                 if (TaskAlive_(client, gen))
+                                 {
+                                     OnWrite_(client);
+                                 }
+                                 client->EndTask(ticket);
+                             });
+    }
+    else
+    {
+        OnWrite_(client);
+    }
+}
+
+void Reactor::ExtentTime_(HttpConn *client)
+{
+    assert(client);
+    if (timeoutMS_ > 0)
+    {
+        timer_->adjust(client->GetFd(), timeoutMS_);
+    }
+}
+
+void Reactor::OnRead_(HttpConn *client)
+{
+    assert(client);
+    int ret = -1;
+    int readErrno = 0;
+    ret = client->read(&readErrno); // 读取客户端套接字的数据，读到httpconn的读缓存区
+    if (ret <= 0 && readErrno != EAGAIN)
+    { // 读异常就关闭客户端
+        CloseConn_(client);
+        return;
+    }
+    // 业务逻辑的处理（先读后处理）
+    OnProcess(client);
+}
+
+/* 处理读（请求）数据的函数 */
+void Reactor::OnProcess(HttpConn *client)
+{
+    if (persistent_)
+    {
+        // 有响应就直接写；写完后读缓冲区里若还有流水线请求则继续处理，写不完就等 EPOLLOUT 边沿
+        // 发送队列排空后还要再处理一次，才能提交排在后面的登录/注册校验
+        bool waiting = false;
+        while (Process_(client, &waiting))
+        {
+            if (Flush_(client) != FLUSH_DONE || !client->CanProcess())
+            {
+                return;
+            }
+        }
+        if (!waiting && client->ReadPaused())
+        {
+            // 读缓冲区里的请求体已经取走，socket 中剩下的数据不会再有 EPOLLIN 边沿：本轮事件之后接着读
+            yielded_.push_back({client->GetFd(), client->GetGeneration()});
+        }
+        return;
+    }
+    // 首先调用process()进行逻辑处理
+    bool waiting = false;
+    if (Process_(client, &waiting))
+    {
+        // 读完事件就跟内核说可以写了
+        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT); // 响应成功，修改监听事件为写,等待OnWrite_()发送
+    }
+    else if (!waiting)
+    {
+        // 写完事件就跟内核说可以读了
+        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN);
+    }
+    // 等待校验结果时不重新注册，结果回来后由 OnVerified_ 继续
+}
+
+// 提交成功后结果可能立刻在别的线程回到连接上，因此之后不能再访问 client，由 *waiting 告诉调用者
+bool Reactor::Process_(HttpConn *client, bool *waiting)
+{
+    *waiting = false;
+    client->process();
+    std::string name, pwd;
+    bool isLogin = false;
+    if (client->TakeVerify(&name, &pwd, &isLogin))
+    {
+        int fd = client->GetFd();
+        uint32_t gen = client->GetGeneration();
+        if (UserVerifier::Instance()->Submit(name, pwd, isLogin, [this, fd, gen](UserVerifier::RESULT result)
+                                             { RunInLoop([this, fd, gen, result]
+                                                         { OnVerified_(fd, gen, result); }); }))
+        {
+            *waiting = true;
+            return false;
+        }
+        client->FinishVerify(UserVerifier::VERIFY_BUSY); // 队列已满：回复 503，继续处理后面的请求
+        client->process();
+    }
+    return client->ToWriteBytes() > 0;
+}
+
+// 在本线程中执行（连接表只在本线程修改）：代数不同说明连接已关闭且 fd 已被复用
+void Reactor::OnVerified_(int fd, uint32_t gen, UserVerifier::RESULT result)
+{
+    HttpConn *client = users_.Get(fd, gen);
+    if (!client || client->IsClosed() || !client->IsVerifying())
+    {
+        return;
+    }
+    if (threadpool_)
+    {
+        uint32_t ticket = client->BeginTask();
+        int64_t queued = Metrics::Now();
+        threadpool_->AddTask([this, client, gen, ticket, result, queued]
+                             {
+                                 Metrics::ObserveSince(HIST_TASK_WAIT, queued);
+                                 if (TaskAlive_(client, gen))
+                                 {
+                                     client->FinishVerify(result);
+                                     OnProcess(client);
+                                 }
+                                 client->EndTask(ticket);
+                             });
+    }
+    else
+    {
+        client->FinishVerify(result);
+        OnProcess(client);
+    }
+}
+
+// 写发送队列：EAGAIN 时等待 EPOLLOUT；写预算用完（ret > 0 而队列未空）时放进 yielded_；出错或不保持连接时关闭
+Reactor::FLUSH_RESULT Reactor::Flush_(HttpConn *client)
+{
+    int writeErrno = 0;
+    ssize_t ret = client->write(&writeErrno);
+    if (client->ToWriteBytes() == 0)
+    {
+        if (client->IsKeepAlive())
+        {
+            return FLUSH_DONE;
+        }
+    }
+    else if (ret > 0)
+    {
+        Metrics::Count(COUNTER_WRITE_YIELDS);
+        yielded_.push_back({client->GetFd(), client->GetGeneration()});
+        return FLUSH_YIELD;
+    }
+    else if (writeErrno == EAGAIN)
+    {
+        return FLUSH_PENDING;
+    }
+    CloseConn_(client);
+    return FLUSH_CLOSED;
+}
+
+void Reactor::OnWrite_(HttpConn *client)
+{
+    assert(client);
+    if (persistent_)
+    {
+        // EPOLLOUT 边沿：只在有积压时写（没有积压的边沿直接忽略）
+        // 让出时本轮不再处理新请求，留给 DealYielded_，否则同一连接在一轮内会写不止一份预算
+        if (client->ToWriteBytes() == 0)
+        {
+            return;
+        }
+        FLUSH_RESULT result = Flush_(client);
+        if ((result == FLUSH_DONE || result == FLUSH_PENDING) && client->CanProcess())
+        {
+            OnProcess(client);
+        }
+        return;
+    }
+    int ret = -1;
+    int writeErrno = 0;
+    ret = client->write(&writeErrno);
+    if (client->ToWriteBytes() == 0)
+    {
+        /* 传输完成 */
+        if (client->IsKeepAlive())
+        {
+            if (client->CanProcess())
+            {
+                OnProcess(client); // 读缓冲区里还有流水线请求（超过单次处理上限或不完整）或待提交的校验，不必等新的读事件
+                return;
+            }
+            epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN); // 回归换成监测读事件
+            return;
+        }
+    }
+    else if (ret > 0 || writeErrno == EAGAIN)
+    {
+        /* 缓冲区满了、用完了写预算（或 LT 模式下单次只写一部分），继续传输 */
+        if (ret > 0)
+        {
+            Metrics::Count(COUNTER_WRITE_YIELDS);
+        }
+        if (client->CanProcess())
+        {
+            OnProcess(client); // 发送队列已低于低水位：先生成后面的响应，OnProcess 会重新注册 EPOLLOUT
+            return;
+        }
+        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
+        return;
+    }
+    CloseConn_(client);
+}
+
+// 设置非阻塞
+int Reactor::SetFdNonblock(int fd)
+{
+    assert(fd > 0);
+    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
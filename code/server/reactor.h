@@ -0,0 +1,183 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <fcntl.h>       // fcntl()
+#include <unistd.h>      // close()
+#include <assert.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h> // eventfd()
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "epoller.h"
+#include "uringpoller.h"
+#include "../timer/heaptimer.h"
+#include "../timer/timewheel.h"
+
+#include "../log/log.h"
+#include "../pool/threadpool.h"
+#include "../pool/userverifier.h"
+#include "../metrics/metrics.h"
+
+#include "connslab.h"
+
+/*
+ * Reactor：一个事件循环（one loop per thread 中的 "loop"）
+ * 每个 Reactor 独占自己的 Poller（Epoller 或 UringPoller）、定时器（HeapTimer 或 TimeWheel）和连接表 users_（以 fd 为下标的 ConnSlab），
+ * 并在自己的监听 socket 上 accept（多 Reactor 模式下每个 Reactor 一个 SO_REUSEPORT 监听 fd）。
+ *
+ * 两种工作方式：
+ *  - threadpool 非空：经典模式，读写事件封装成任务交给线程池处理（与原 WebServer 行为一致）
+ *  - threadpool 为空：内联模式，读/解析/写都在本线程完成，稳态请求不经过任何共享锁
+ *
+ * 内联模式且连接为 ET 时，连接只注册一次 EPOLLIN|EPOLLOUT|EPOLLET（不用 EPOLLONESHOT）：
+ * 处理完请求直接写，写到 EAGAIN 才等 EPOLLOUT 边沿，稳态请求不再有 epoll_ctl(MOD)。
+ * 经典模式（需要 EPOLLONESHOT 保证同一连接只在一个 worker 上处理）与 LT 连接保持原有的逐次重新注册。
+ *
+ * 每次写最多发送 HttpConn::writeBudget 字节。预算用完而 socket 仍可写时：经典模式/LT 重新注册 EPOLLOUT
+ * （EPOLL_CTL_MOD 会立即重新上报就绪），persistent_ 模式放进 yielded_，本轮事件处理完后再写，
+ * 有让出的连接时 Wait 不阻塞。发送队列降到低水位以下（HttpConn::CanProcess）就继续处理流水线请求。
+ * 读也有上限：读缓冲区积压到 HttpConn::readHighWater 时 read 停下，请求体由 HttpRequest 边解析边取走，
+ * persistent_ 模式把没读完的连接放进 yielded_ 接着读，其余模式重新注册 EPOLLIN 时内核会再次上报。
+ *
+ * accept 用 accept4 直接得到非阻塞、CLOEXEC 的 fd，每次唤醒最多 accept ACCEPT_BATCH 个；ET 监听时批量用完就像
+ * yielded_ 一样在本轮事件之后继续。连接数达到 maxConn 时立即回复 503 并关闭（不读请求、不阻塞），
+ * fd 用尽（EMFILE）时放掉预留的 idleFd_ 接受并拒绝一个连接，监听 socket 不会在 LT 下一直就绪而空转；
+ * 预留 fd 也没能重新打开时先再试一次，仍失败就暂停监听 LISTEN_PAUSE_MS（去掉 EPOLLIN），到期后恢复。
+ *
+ * 登录/注册交给 UserVerifier 的数据库线程，结果经 RunInLoop 回到本线程；等待结果期间连接不占用 worker，
+ * 经典模式下也不重新注册事件（ONESHOT 保持解除状态）。
+ *
+ * 经典模式下连接从提交任务到 worker 交还（重新注册事件、关闭或等待校验）归 worker 所有（HttpConn::BeginTask）：
+ * 此期间到期的超时推迟 DEFER_RETRY_MS 再检查，排空也跳过它，本线程不会与 worker 同时访问同一个连接。
+ * bench/stress.sh 在四种触发模式下回放慢速、中途断开的请求来检查这一点（http_use_after_close_total 应为 0）。
+ */
+class Reactor {
+public:
+    // listenFd    : 本 Reactor 负责 accept 的监听 socket（由 WebServer 创建）
+    // listenEvent : 监听 socket 的事件掩码
+    // connEvent   : 连接 socket 的事件掩码
+    // timeoutMS   : 连接超时时间（毫秒），<=0 表示不启用超时
+    // threadpool  : 处理读写任务的线程池，为 nullptr 时内联处理
+    // wheelTickMS : >0 时用该 tick 粒度的 TimeWheel 管理超时，否则用 HeapTimer
+    // useUring    : 用 io_uring 代替 epoll 作为事件后端（内核不支持时退回 epoll，见 IsUring()）
+    // maxConn     : 所有 Reactor 合计的连接上限，超过后新连接直接回复 503（<=0 或超过 MAX_FD 时取 MAX_FD）
+    Reactor(int listenFd, uint32_t listenEvent, uint32_t connEvent,
+            int timeoutMS, ThreadPool* threadpool, int wheelTickMS = 0, bool useUring = false,
+            int maxConn = MAX_FD);
+    ~Reactor();
+
+    // 把监听 socket 注册到本 Reactor 的 epoll 上
+    bool Init();
+
+    // 事件循环：阻塞直到 Quit() 被调用
+    void Loop();
+
+    // 线程安全：通知事件循环退出（通过 eventfd 唤醒 epoll_wait）
+    void Quit();
+
+    // 线程安全：优雅退出。停止 accept 并关闭监听 socket（监听队列中尚未 accept 的连接留给共享该 socket 的新进程），
+    // 空闲连接立即关闭，其余连接处理完当前请求（回复 Connection: close，见 HttpConn::draining）后关闭；
+    // 连接全部关闭或超过 timeoutMS 后强制关闭剩余连接并退出事件循环
+    void Drain(int timeoutMS);
+
+    // 线程安全：修改连接超时时间（SIGHUP 重新加载配置），已有连接在下一次活动时按新值计算；
+    // 启用/关闭超时（<=0 与 >0 之间切换）需要重启
+    void SetTimeout(int timeoutMS);
+
+    // 线程安全：把 cb 交给事件循环线程执行（唤醒 epoll_wait 后在 DealWakeup_ 中调用）
+    void RunInLoop(std::function<void()> cb);
+
+    // 事件后端是否为 io_uring
+    bool IsUring() const { return isUring_; }
+
+    // 最大支持的文件描述符数量
+    static const int MAX_FD = 65536;
+
+    // 排空期间检查连接的间隔（毫秒）
+    static const int DRAIN_TICK_MS = 100;
+
+    // 超时到期时连接正在 worker 上处理：隔多久再检查（毫秒）
+    static const int DEFER_RETRY_MS = 10;
+
+    // 每次监听 socket 就绪时最多 accept 的连接数，连接风暴时不至于饿死已有连接的读写
+    static const int ACCEPT_BATCH = 64;
+
+    // fd 用尽且没有预留 fd 时暂停 accept 的时长（毫秒）
+    static const int LISTEN_PAUSE_MS = 100;
+
+    // helper：把 fd 设置为非阻塞（ET 模式必须）
+    static int SetFdNonblock(int fd);
+
+private:
+    // ------ 事件分发 ------
+    void DealListen_();
+    void DealWrite_(HttpConn* client);
+    void DealRead_(HttpConn* client);
+    void DealWakeup_();
+    void DealYielded_();    // 继续写上一轮用完写预算的连接，或继续读暂停的连接
+    void DealDrain_();      // 排空：关闭空闲（或超过期限）的连接，全部关闭后退出
+
+    void AddClient_(int fd, sockaddr_in addr);
+    void RejectConn_(int fd);      // 回复 503 并关闭（过载时丢弃新连接）
+    bool AcceptOnFdLimit_();       // EMFILE/ENFILE：用预留 fd 接受并拒绝一个连接，没有预留 fd 时暂停监听并返回 false
+    void PauseListen_();           // 去掉监听 socket 的 EPOLLIN，LISTEN_PAUSE_MS 后恢复
+    void ResumeListen_();
+    void ExtentTime_(HttpConn* client);
+    void AddTimer_(HttpConn* client, int timeoutMS);        // 超时关闭连接（worker 正在处理时推迟）
+    void RearmDeferred_();                                  // 给 deferred_ 中的连接重新加定时器
+    static bool TaskAlive_(HttpConn* client, uint32_t gen); // worker：连接没有在任务排队期间被关闭或复用
+    void CloseConn_(HttpConn* client);
+    void Wakeup_();
+
+    // 真正的读写与业务处理（经典模式下在 worker 线程中执行，内联模式下在本线程执行）
+    void OnRead_(HttpConn* client);
+    void OnWrite_(HttpConn* client);
+    void OnProcess(HttpConn* client);
+    bool Process_(HttpConn* client, bool* waiting); // process() 并提交待校验的登录/注册，有响应待发送时返回 true
+    void OnVerified_(int fd, uint32_t gen, UserVerifier::RESULT result);  // 本线程：校验结果回到连接
+    enum FLUSH_RESULT {
+        FLUSH_DONE,     // 全部写完且保持连接
+        FLUSH_PENDING,  // EAGAIN：等待 EPOLLOUT 边沿
+        FLUSH_YIELD,    // 写预算用完：已放进 yielded_
+        FLUSH_CLOSED,   // 出错或不保持连接：已关闭
+    };
+    FLUSH_RESULT Flush_(HttpConn* client);   // persistent_ 模式：写发送队列
+
+    int listenFd_;          // 监听 socket 的 fd（由 WebServer 持有并关闭；Drain 时由本 Reactor 关闭，之后为 -1）
+    int wakeupFd_;          // 用于 Quit() 唤醒 epoll_wait 的 eventfd
+    int idleFd_;            // 预留的 fd（/dev/null），进程 fd 用尽时临时释放
+    int maxConn_;           // 连接上限（全部 Reactor 合计，对比 HttpConn::userCount）
+    bool listenPending_;    // ET 监听：上次 accept 用完批量，监听队列里可能还有连接
+    bool listenPaused_;     // fd 用尽且没有预留 fd：暂停 accept 到 listenResume_
+    TimeStamp listenResume_;
+    uint32_t listenEvent_;  // 监听 socket 的事件掩码
+    uint32_t connEvent_;    // 连接 socket 的事件掩码
+    int timeoutMS_;         // 连接超时时间（毫秒）
+    std::atomic<bool> isClose_;
+    bool isUring_;
+    bool persistent_;       // 连接只注册一次（内联模式 + ET），兴趣集不随请求/响应变化
+    bool draining_;         // Drain 之后：不再 accept，等待连接关闭
+    TimeStamp drainDeadline_;
+
+    ThreadPool* threadpool_;                  // 不持有；为空表示内联处理
+    std::unique_ptr<Timer> timer_;            // 本 Reactor 连接的超时管理
+    std::unique_ptr<Poller> epoller_;         // 本 Reactor 的事件后端（epoll 或 io_uring）
+
+    // 连接表：以 fd 为下标保存每个连接的 HttpConn 对象（仅本 Reactor 线程创建，地址在 Reactor 生命周期内不变）
+    ConnSlab users_;
+
+    std::vector<std::pair<int, uint32_t>> yielded_; // persistent_ 模式：用完写预算或暂停读的连接（fd, 代数）
+    std::vector<std::pair<int, uint32_t>> deferred_; // 超时到期时正在 worker 上处理的连接（fd, 代数）
+
+    std::mutex pendingMtx_;                     // 保护 pending_
+    std::vector<std::function<void()>> pending_; // RunInLoop 提交、等待本线程执行的回调
+};
+
+#endif //REACTOR_H
@@ -0,0 +1,297 @@
+#include "uringpoller.h"
+
+UringPoller::UringPoller(int maxEvent, unsigned entries)
+    : ringFd_(-1), sqEntries_(0), sqRing_(MAP_FAILED), sqRingSize_(0), cqRing_(MAP_FAILED), cqRingSize_(0),
+      sqes_(static_cast<io_uring_sqe*>(MAP_FAILED)), sqesSize_(0), sqHead_(nullptr), sqTail_(nullptr), sqMask_(0),
+      sqeTail_(0), cqHead_(nullptr), cqTail_(nullptr), cqMask_(0), cqes_(nullptr), events_(maxEvent) {
+    assert(maxEvent > 0);
+    if (!Setup_(entries)) {
+        Teardown_();
+    }
+}
+
+UringPoller::~UringPoller() {
+    Teardown_();
+}
+
+// io_uring_setup 并映射 SQ/CQ 环与 SQE 数组
+bool UringPoller::Setup_(unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    ringFd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+    if (ringFd_ < 0) {
+        return false;
+    }
+    if (!(p.features & IORING_FEAT_EXT_ARG)) {  // Wait 的超时依赖 5.11 的 IORING_ENTER_EXT_ARG
+        return false;
+    }
+    sqEntries_ = p.sq_entries;
+    sqRingSize_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqRingSize_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single = p.features & IORING_FEAT_SINGLE_MMAP;   // SQ 与 CQ 环共用一次映射
+    if (single) {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+    sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        return false;
+    }
+    if (single) {
+        cqRing_ = sqRing_;
+    } else {
+        cqRing_ = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED) {
+            return false;
+        }
+    }
+    sqesSize_ = p.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                            ringFd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) {
+        return false;
+    }
+
+    char* sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    unsigned* sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    for (unsigned i = 0; i < p.sq_entries; i++) {
+        sqArray[i] = i;     // SQ 环的第 i 个位置固定对应第 i 个 SQE
+    }
+    sqeTail_ = *sqTail_;
+
+    char* cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+    return true;
+}
+
+void UringPoller::Teardown_() {
+    if (sqes_ != MAP_FAILED) {
+        munmap(sqes_, sqesSize_);
+        sqes_ = static_cast<io_uring_sqe*>(MAP_FAILED);
+    }
+    if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_) {
+        munmap(cqRing_, cqRingSize_);
+    }
+    cqRing_ = MAP_FAILED;
+    if (sqRing_ != MAP_FAILED) {
+        munmap(sqRing_, sqRingSize_);
+        sqRing_ = MAP_FAILED;
+    }
+    if (ringFd_ >= 0) {
+        close(ringFd_);
+        ringFd_ = -1;
+    }
+}
+
+// toSubmit 可以大于实际待提交数，内核只会提交 SQ 环中已发布的请求
+int UringPoller::Enter_(unsigned toSubmit, unsigned minComplete, unsigned flags, int timeoutMs) {
+    if (!(flags & IORING_ENTER_GETEVENTS)) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, ringFd_, toSubmit, 0, flags, nullptr, 0));
+    }
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if (timeoutMs >= 0) {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    return static_cast<int>(syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete,
+                                    flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg)));
+}
+
+// 取一个空闲 SQE，SQ 环满时先提交一次
+io_uring_sqe* UringPoller::GetSqe_() {
+    if (sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) {
+        Enter_(Pending_(), 0, 0, -1);
+        if (sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) {
+            return nullptr;
+        }
+    }
+    io_uring_sqe* sqe = &sqes_[sqeTail_ & sqMask_];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+// 填好 SQE 后发布给内核
+void UringPoller::Publish_() {
+    sqeTail_++;
+    __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+}
+
+unsigned UringPoller::Pending_() const {
+    return sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+}
+
+bool UringPoller::PrepPoll_(int fd) {
+    FdState& st = fds_[fd];
+    io_uring_sqe* sqe = GetSqe_();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    // ET/ONESHOT 不是 poll 的事件位；ERR/HUP 总会上报
+    sqe->poll32_events = st.events & (EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLPRI);
+    if ((st.events & EPOLLET) && !(st.events & EPOLLONESHOT)) {
+        sqe->len = IORING_POLL_ADD_MULTI;
+    }
+    sqe->user_data = (static_cast<uint64_t>(st.seq) << 32) | static_cast<uint32_t>(fd);
+    Publish_();
+    st.armed = true;
+    return true;
+}
+
+bool UringPoller::PrepRemove_(int fd) {
+    FdState& st = fds_[fd];
+    io_uring_sqe* sqe = GetSqe_();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = (static_cast<uint64_t>(st.seq) << 32) | static_cast<uint32_t>(fd);
+    sqe->user_data = REMOVE_TAG;
+    Publish_();
+    st.armed = false;
+    return true;
+}
+
+// 非事件循环线程（经典模式的 worker）的修改立即提交，事件循环线程的留到下一次 Wait
+void UringPoller::SubmitIfForeign_() {
+    if (std::this_thread::get_id() != loopThread_ && Pending_() > 0) {
+        Enter_(Pending_(), 0, 0, -1);
+    }
+}
+
+UringPoller::FdState* UringPoller::State_(int fd, bool create) {
+    if (fd < 0) {
+        return nullptr;
+    }
+    if (static_cast<size_t>(fd) >= fds_.size()) {
+        if (!create) {
+            return nullptr;
+        }
+        fds_.resize(std::max(static_cast<size_t>(fd) + 1, fds_.size() * 2));
+    }
+    return &fds_[fd];
+}
+
+bool UringPoller::AddFd(int fd, uint32_t events) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    FdState* st = State_(fd, true);
+    if (!st || st->registered) {
+        return false;
+    }
+    st->seq++;
+    st->events = events;
+    st->registered = true;
+    if (!PrepPoll_(fd)) {
+        st->registered = false;
+        return false;
+    }
+    SubmitIfForeign_();
+    return true;
+}
+
+bool UringPoller::ModFd(int fd, uint32_t events) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    FdState* st = State_(fd, false);
+    if (!st || !st->registered) {
+        return false;
+    }
+    if (st->armed && !PrepRemove_(fd)) {
+        return false;
+    }
+    st->seq++;
+    st->events = events;
+    bool ok = PrepPoll_(fd);
+    SubmitIfForeign_();
+    return ok;
+}
+
+bool UringPoller::DelFd(int fd) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    FdState* st = State_(fd, false);
+    if (!st || !st->registered) {
+        return false;
+    }
+    if (st->armed) {
+        PrepRemove_(fd);
+    }
+    st->seq++;
+    st->registered = false;
+    st->armed = false;
+    SubmitIfForeign_();
+    return true;
+}
+
+// 提交本轮累积的修改并等待事件，一次 io_uring_enter
+int UringPoller::Wait(int timeoutMs) {
+    unsigned toSubmit;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        loopThread_ = std::this_thread::get_id();
+        for (int fd : rearm_) {
+            FdState& st = fds_[fd];
+            if (st.registered && !st.armed) {
+                PrepPoll_(fd);
+            }
+        }
+        rearm_.clear();
+        toSubmit = Pending_();
+    }
+    bool ready = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) != *cqHead_;
+    int ret = Enter_(toSubmit, (ready || timeoutMs == 0) ? 0 : 1, IORING_ENTER_GETEVENTS, timeoutMs);
+    if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> locker(mtx_);
+    int n = 0;
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    // 超过 events_ 容量的完成事件留在 CQ 环中，下一次 Wait 立即返回再处理
+    while (head != tail && n < static_cast<int>(events_.size())) {
+        const io_uring_cqe& cqe = cqes_[head & cqMask_];
+        head++;
+        if (cqe.user_data == REMOVE_TAG) {
+            continue;
+        }
+        int fd = static_cast<int>(cqe.user_data & 0xffffffffu);
+        uint32_t seq = static_cast<uint32_t>(cqe.user_data >> 32);
+        FdState* st = State_(fd, false);
+        if (!st || !st->registered || st->seq != seq) {
+            continue;   // 已删除或已修改的旧注册
+        }
+        events_[n].fd = fd;
+        events_[n].events = cqe.res < 0 ? EPOLLERR : static_cast<uint32_t>(cqe.res);
+        n++;
+        if (cqe.flags & IORING_CQE_F_MORE) {
+            continue;   // multishot 请求仍然挂着
+        }
+        st->armed = false;
+        if (!(st->events & EPOLLONESHOT)) {
+            rearm_.push_back(fd);
+        }
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    return n;
+}
+
+int UringPoller::GetEventFd(size_t i) const {
+    assert(i < events_.size());
+    return events_[i].fd;
+}
+
+uint32_t UringPoller::GetEvents(size_t i) const {
+    assert(i < events_.size());
+    return events_[i].events;
+}
@@ -0,0 +1,104 @@
+#ifndef URING_POLLER_H
+#define URING_POLLER_H
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h> // __NR_io_uring_setup / __NR_io_uring_enter
+#include <sys/mman.h>    // mmap()
+#include <unistd.h>      // close(), syscall()
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+#include "poller.h"
+
+/*
+ * UringPoller：基于 io_uring 的 Poller（直接使用系统调用，不依赖 liburing）
+ *
+ * 每个注册的 fd 对应一个 IORING_OP_POLL_ADD 请求，AddFd/ModFd/DelFd 只是往提交队列里放 poll/poll-remove，
+ * 在事件循环线程中调用时不进内核：下一次 Wait 用一次 io_uring_enter 完成“提交本轮所有修改 + 等待事件”。
+ * 经典模式下 EPOLLONESHOT 的重新注册在 worker 线程发生，此时立即提交（不等待），以免事件循环睡在旧的注册上。
+ *
+ * 语义与 epoll 保持一致：
+ *  - EPOLLONESHOT：poll 请求本身就是一次性的，触发后直到 ModFd 才重新挂上
+ *  - 非 ONESHOT 的 ET：使用 multishot poll（IORING_POLL_ADD_MULTI），只在 fd 被唤醒（新数据到达、发送缓冲区腾出空间）时上报，
+ *    请求一直挂着，不需要重新提交
+ *  - 非 ONESHOT 的 LT（eventfd、LT 监听 socket）：触发后在下一次 Wait 前自动重新挂上，条件仍满足时会再次上报
+ *  - 每次注册带一个序号，DelFd/ModFd 之后旧请求的完成事件（包括 fd 被关闭又复用的情况）会被丢弃
+ */
+class UringPoller : public Poller {
+public:
+    explicit UringPoller(int maxEvent = 1024, unsigned entries = 4096);
+    ~UringPoller() override;
+
+    UringPoller(const UringPoller&) = delete;
+    UringPoller& operator=(const UringPoller&) = delete;
+
+    // io_uring 初始化是否成功（内核不支持、被 seccomp 禁用或缺少 IORING_FEAT_EXT_ARG 时为 false）
+    bool IsValid() const { return ringFd_ >= 0; }
+
+    bool AddFd(int fd, uint32_t events) override;
+    bool ModFd(int fd, uint32_t events) override;
+    bool DelFd(int fd) override;
+    int Wait(int timeoutMs = -1) override;
+    int GetEventFd(size_t i) const override;
+    uint32_t GetEvents(size_t i) const override;
+
+private:
+    struct FdState {
+        uint32_t seq = 0;       // 注册序号，写在请求的 user_data 高 32 位
+        uint32_t events = 0;    // 注册的事件掩码
+        bool registered = false;
+        bool armed = false;     // 是否有尚未完成的 poll 请求
+    };
+    struct Event {
+        int fd;
+        uint32_t events;
+    };
+
+    static const uint64_t REMOVE_TAG = ~0ULL;   // poll-remove 请求的 user_data，其完成事件直接丢弃
+
+    bool Setup_(unsigned entries);
+    void Teardown_();
+    int Enter_(unsigned toSubmit, unsigned minComplete, unsigned flags, int timeoutMs);
+
+    // 以下均持 mtx_ 调用
+    io_uring_sqe* GetSqe_();
+    void Publish_();
+    bool PrepPoll_(int fd);
+    bool PrepRemove_(int fd);
+    unsigned Pending_() const;
+    void SubmitIfForeign_();
+    FdState* State_(int fd, bool create);
+
+    int ringFd_;
+    unsigned sqEntries_;
+
+    void* sqRing_;
+    size_t sqRingSize_;
+    void* cqRing_;
+    size_t cqRingSize_;
+    io_uring_sqe* sqes_;
+    size_t sqesSize_;
+
+    unsigned* sqHead_;      // 内核推进
+    unsigned* sqTail_;      // 用户推进
+    unsigned sqMask_;
+    unsigned sqeTail_;      // 本地尾指针，Publish_ 时写回 sqTail_
+    unsigned* cqHead_;      // 用户推进
+    unsigned* cqTail_;      // 内核推进
+    unsigned cqMask_;
+    io_uring_cqe* cqes_;
+
+    std::mutex mtx_;                    // 保护提交队列与 fds_（worker 线程会调用 ModFd）
+    std::thread::id loopThread_;        // 调用 Wait 的线程，它的修改延迟到下一次 Wait 提交
+    std::vector<FdState> fds_;          // 以 fd 为下标
+    std::vector<int> rearm_;            // 本轮上报过、需要在下一次 Wait 前重新挂上的非 ONESHOT fd
+    std::vector<Event> events_;
+};
+
+#endif //URING_POLLER_H
@@ -1,33 +1,88 @@
 #include "webserver.h"
+#include <poll.h>
+#include <limits.h>      // PATH_MAX
+#include <sys/wait.h>
+#include <algorithm>
+
+extern char **environ;
 
 using namespace std;
+
+const char *WebServer::METRICS_PATH = "/metrics";
+const char *WebServer::LISTEN_FDS_ENV = "TINYWEBSERVER_LISTEN_FDS";
+const char *WebServer::READY_FD_ENV = "TINYWEBSERVER_READY_FD";
+
+namespace
+{
+    // 可热加载的配置项的默认值：从配置文件启动与 SIGHUP 重新加载时，文件中没有的键都取这些值
+    const int DEFAULT_TIMEOUT_MS = 60000;
+    const int DEFAULT_LOG_LEVEL = 1;
+    const int DEFAULT_CACHE_MAX_MB = 64;
+    const int DEFAULT_CACHE_MAX_FILE_KB = 1024;
+    const int DEFAULT_CACHE_CHECK_MS = 1000;
+    const int DEFAULT_DRAIN_TIMEOUT_MS = 5000;
+
+    // 只在启动时读取的配置项，SIGHUP 时有变化只记录警告
+    const char *const RESTART_KEYS[] = {
+        "port", "trig_mode", "opt_linger", "sql_port", "sql_user", "sql_password", "db_name",
+        "sql_pool_num", "thread_num", "open_log", "log_queue_size", "reactor_num", "sendfile_kb",
+        "wheel_tick_ms", "use_uring", "write_budget_kb", "high_water_kb", "low_water_kb", "backlog",
+        "max_conn", "defer_accept_sec", "fast_open_qlen", "max_body_kb", "body_mem_kb", "cpu_affinity",
+        "access_log_dir", "access_log_segment_mb", "log_block_when_full", nullptr};
+}
+
 // 构造函数：初始化各个成员变量，设置服务器参数
 WebServer::WebServer(
     int port, int trigMode, int timeoutMS, bool OptLinger,
     int sqlPort, const char *sqlUser, const char *sqlPwd,
     const char *dbName, int connPoolNum, int threadNum,
-    bool openLog, int logLevel, int logQueSize) : port_(port), openLinger_(OptLinger), timeoutMS_(timeoutMS), isClose_(false),
-                                                  timer_(new HeapTimer()), threadpool_(new ThreadPool(threadNum)), epoller_(new Epoller())
+    bool openLog, int logLevel, int logQueSize, int reactorNum, int sendfileKB, int wheelTickMS, bool useUring,
+    int writeBudgetKB, int highWaterKB, int lowWaterKB,
+    int backlog, int maxConn, int deferAcceptSec, int fastOpenQlen,
+    int maxBodyKB, int bodyMemKB, const char *cpuAffinity,
+    const char *accessLogDir, int accessLogSegmentMB, bool logBlockWhenFull) : port_(port), openLinger_(OptLinger), timeoutMS_(timeoutMS), isClose_(false),
+                                                                  reactorNum_(reactorNum), wheelTickMS_(wheelTickMS), useUring_(useUring),
+                                                                  backlog_(ListenBacklog_(backlog)), maxConn_(maxConn), deferAcceptSec_(deferAcceptSec), fastOpenQlen_(fastOpenQlen),
+                                                                  readyFd_(-1), drainTimeoutMS_(DEFAULT_DRAIN_TIMEOUT_MS), draining_(false)
 {
+    // 信号交给 Start 中的信号线程同步处理：先屏蔽，之后创建的线程（线程池、数据库线程、Reactor）都继承屏蔽字
+    sigset_t signals = SignalSet_();
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    TakeInheritedFds_();
+    bool cpuListOk = ParseCpuList_(cpuAffinity, &cpus_);
+
     srcDir_ = getcwd(nullptr, 256);
     assert(srcDir_);
     strcat(srcDir_, "/resources/");
     HttpConn::userCount = 0;
     HttpConn::srcDir = srcDir_;
+    HttpConn::metricsPath = METRICS_PATH;
+    HttpResponse::sendfileThreshold = static_cast<size_t>(sendfileKB) * 1024;
+    HttpConn::writeBudget = static_cast<size_t>(std::max(writeBudgetKB, 1)) * 1024;
+    HttpConn::highWater = static_cast<size_t>(std::max(highWaterKB, 1)) * 1024;
+    HttpConn::lowWater = std::min(static_cast<size_t>(std::max(lowWaterKB, 0)) * 1024, HttpConn::highWater);
+    HttpRequest::maxBodySize = static_cast<size_t>(std::max(maxBodyKB, 0)) * 1024;
+    HttpRequest::bodyMemLimit = std::min(static_cast<size_t>(std::max(bodyMemKB, 0)) * 1024, HttpRequest::maxBodySize);
 
     // 初始化操作
     SqlConnPool::Instance()->Init("localhost", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum); // 连接池单例的初始化
+    UserVerifier::Instance()->Init(connPoolNum);   // 登录/注册的数据库线程，每个线程最多占用一个连接
     // 初始化事件和初始化socket(监听)
     InitEventMode_(trigMode);
-    if (!InitSocket_())
+    if (!InitReactors_(threadNum))
     {
         isClose_ = true;
     }
+    bool accessLogOk = !*accessLogDir ||
+                       AccessLog::Instance()->Init(accessLogDir, static_cast<size_t>(std::max(accessLogSegmentMB, 1)) * 1024 * 1024);
+    bool pinOk = !threadpool_ || threadpool_->PinWorkers(cpus_);
+    bool cbpfOk = reactorNum_ > 0 && !cpus_.empty() && !isClose_ && AttachReuseportCbpf_();
+    InitMetrics_();
 
     // 是否打开日志标志
     if (openLog)
     {
-        Log::Instance()->init(logLevel, "./log", ".log", logQueSize);
+        Log::Instance()->init(logLevel, "./log", ".log", logQueSize, logBlockWhenFull);
         if (isClose_)
         {
             LOG_ERROR("========== Server init error!==========");
@@ -39,17 +94,141 @@ WebServer::WebServer(
             LOG_INFO("Listen Mode: %s, OpenConn Mode: %s",
                      (listenEvent_ & EPOLLET ? "ET" : "LT"),
                      (connEvent_ & EPOLLET ? "ET" : "LT"));
-            LOG_INFO("LogSys level: %d", logLevel);
+            LOG_INFO("LogSys level: %d, queue: %d lines, when full: %s",
+                     logLevel, logQueSize, logBlockWhenFull ? "block" : "drop");
             LOG_INFO("srcDir: %s", HttpConn::srcDir);
             LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", connPoolNum, threadNum);
+            LOG_INFO("Reactor Mode: %s, Reactor num: %d",
+                     (reactorNum_ > 0 ? "multi (SO_REUSEPORT)" : "single + threadpool"), reactorNum_);
+            LOG_INFO("Sendfile threshold: %dKB", sendfileKB);
+            LOG_INFO("Listen backlog: %d, max connections: %d (0 = %d), defer accept: %ds, fast open: %d",
+                     backlog_, maxConn_, (int)Reactor::MAX_FD, deferAcceptSec_, fastOpenQlen_);
+            LOG_INFO("Write budget: %dKB, send queue watermarks: %dKB / %dKB",
+                     (int)(HttpConn::writeBudget / 1024), (int)(HttpConn::highWater / 1024), (int)(HttpConn::lowWater / 1024));
+            LOG_INFO("Request body limit: %dKB, in memory up to %dKB",
+                     (int)(HttpRequest::maxBodySize / 1024), (int)(HttpRequest::bodyMemLimit / 1024));
+            if (!cpuListOk)
+            {
+                LOG_WARN("Bad cpu affinity list \"%s\", threads are not pinned", cpuAffinity);
+            }
+            else if (!cpus_.empty())
+            {
+                LOG_INFO("CPU affinity: %s (%d cpus), reuseport CBPF: %s", cpuAffinity, (int)cpus_.size(),
+                         cbpfOk ? "on" : (reactorNum_ > 0 ? "failed" : "off"));
+                if (!pinOk)
+                {
+                    LOG_WARN("Pin ThreadPool workers failed");
+                }
+            }
+            if (!accessLogOk)
+            {
+                LOG_ERROR("Open access log in %s failed", accessLogDir);
+            }
+            else if (*accessLogDir)
+            {
+                LOG_INFO("Access log: %s, segment %dMB", accessLogDir, accessLogSegmentMB);
+            }
+            if (readyFd_ >= 0)
+            {
+                LOG_INFO("Hot restart: took over %d listen socket(s)", (int)inheritedFds_.size());
+            }
+            if (wheelTickMS_ > 0)
+            {
+                LOG_INFO("Timer: TimeWheel, tick %dms", wheelTickMS_);
+            }
+            else
+            {
+                LOG_INFO("Timer: HeapTimer");
+            }
+            if (reactors_[0]->IsUring())
+            {
+                LOG_INFO("Poller: io_uring");
+            }
+            else
+            {
+                if (useUring_)
+                {
+                    LOG_WARN("io_uring unavailable, fall back to epoll");
+                }
+                LOG_INFO("Poller: epoll");
+            }
         }
     }
 }
+
+// 从配置文件构造，键名为参数名的小写下划线形式；未出现的键取 main 原来硬编码的值
+WebServer::WebServer(const Config &config, char *const *argv)
+    : WebServer(config.GetInt("port", 1316), config.GetInt("trig_mode", 3),
+                config.GetInt("timeout_ms", DEFAULT_TIMEOUT_MS), config.GetBool("opt_linger", false),
+                config.GetInt("sql_port", 3306), config.GetString("sql_user", "root").c_str(),
+                config.GetString("sql_password", "200389").c_str(), config.GetString("db_name", "mydb").c_str(),
+                config.GetInt("sql_pool_num", 12), config.GetInt("thread_num", 6),
+                config.GetBool("open_log", true), config.GetInt("log_level", DEFAULT_LOG_LEVEL),
+                config.GetInt("log_queue_size", 1024),
+                config.GetInt("reactor_num", 0), config.GetInt("sendfile_kb", 1024),
+                config.GetInt("wheel_tick_ms", 0), config.GetBool("use_uring", false),
+                config.GetInt("write_budget_kb", 256), config.GetInt("high_water_kb", 256),
+                config.GetInt("low_water_kb", 64),
+                config.GetInt("backlog", 0), config.GetInt("max_conn", 0),
+                config.GetInt("defer_accept_sec", 0), config.GetInt("fast_open_qlen", 0),
+                config.GetInt("max_body_kb", 8192), config.GetInt("body_mem_kb", 64),
+                config.GetString("cpu_affinity", "").c_str(),
+                config.GetString("access_log_dir", "").c_str(), config.GetInt("access_log_segment_mb", 256),
+                config.GetBool("log_block_when_full", false))
+{
+    config_ = config;
+    ApplyReloadable_(config);
+    if (argv && argv[0])
+    {
+        for (char *const *arg = argv; *arg; arg++)
+        {
+            argv_.push_back(*arg);
+        }
+        // 记下路径而不是 inode：替换磁盘上的可执行文件后，热重启会运行新版本
+        char path[PATH_MAX];
+        ssize_t len = readlink("/proc/self/exe", path, sizeof(path) - 1);
+        if (len > 0)
+        {
+            exePath_.assign(path, len);
+        }
+    }
+    if (!config.Path().empty())
+    {
+        LOG_INFO("Config: %s, drain timeout: %dms", config.Path().c_str(), drainTimeoutMS_);
+    }
+}
+
 // 析构函数：关闭监听套接字，释放资源
 WebServer::~WebServer()
 {
-    close(listenFd_);
     isClose_ = true;
+    if (signalThread_.joinable())
+    {
+        signalThread_.join();
+    }
+    for (auto &reactor : reactors_)
+    {
+        reactor->Quit();
+    }
+    for (auto &t : threads_)
+    {
+        if (t.joinable())
+        {
+            t.join();
+        }
+    }
+    if (threadpool_)
+    {
+        threadpool_->Shutdown(); // 排队中的任务引用着 Reactor 与连接，先执行完再销毁 Reactor
+    }
+    UserVerifier::Instance()->Shutdown(); // 完成回调会调用 Reactor::RunInLoop，同样要在销毁 Reactor 之前停止
+    Metrics::Instance()->ClearGauges();   // 回调引用着线程池
+    reactors_.clear();
+    AccessLog::Instance()->Close(); // 写访问日志的线程都已停止
+    for (int fd : listenFds_)
+    {
+        close(fd);
+    }
     free(srcDir_);
     SqlConnPool::Instance()->ClosePool();
 }
@@ -81,203 +260,481 @@ void WebServer::InitEventMode_(int trigMode)
     HttpConn::isET = (connEvent_ & EPOLLET);
 }
 
-// 启动服务器主循环，等待和处理事件
+// 启动服务器：多 Reactor 模式下每个 Reactor 一个线程，第 0 个在当前线程运行
 void WebServer::Start()
 {
-    int timeMS = -1; /* epoll wait timeout == -1 无事件将阻塞 */
-    if (!isClose_)
+    if (isClose_)
     {
-        LOG_INFO("========== Server start ==========");
+        return;
     }
-    while (!isClose_)
+    LOG_INFO("========== Server start ==========");
+    // 先绑核再进入事件循环：连接的 HttpConn 与读写缓冲区都在 Reactor 线程里首次分配，
+    // 按 first-touch 落在该 CPU 所在的 NUMA 节点上
+    for (size_t i = 1; i < reactors_.size(); i++)
+    {
+        Reactor *reactor = reactors_[i].get();
+        int cpu = CpuOf_(i);
+        threads_.emplace_back([reactor, cpu]
+                              {
+                                  PinThread_(cpu);
+                                  reactor->Loop();
+                              });
+    }
+    signalThread_ = std::thread([this]
+                                { SignalLoop_(); });
+    if (readyFd_ >= 0)
+    {
+        // 热重启：告诉旧进程可以开始排空了（Reactor 0 的事件循环马上在本线程开始，监听队列里的连接不会丢）
+        char ready = 1;
+        ssize_t n = ::write(readyFd_, &ready, 1);
+        (void)n;
+        close(readyFd_);
+        readyFd_ = -1;
+    }
+    PinThread_(CpuOf_(0)); // 信号线程已经创建，不继承绑核
+    reactors_[0]->Loop();
+    // 排空时各 Reactor 在自己的连接关闭后分别退出，等其余 Reactor 也排空完
+    for (auto &t : threads_)
     {
-        if (timeoutMS_ > 0)
+        t.join();
+    }
+}
+
+sigset_t WebServer::SignalSet_()
+{
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGUSR2);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    return signals;
+}
+
+// 只接受仍在监听本端口、且与当前模式一致（多 Reactor 模式需要 SO_REUSEPORT）的 socket，其余关闭：
+// 改了端口或在经典/多 Reactor 模式之间切换时新建监听 socket（后者需要完整重启才能 bind）
+void WebServer::TakeInheritedFds_()
+{
+    const char *fds = getenv(LISTEN_FDS_ENV);
+    const char *ready = getenv(READY_FD_ENV);
+    if (ready)
+    {
+        readyFd_ = atoi(ready);
+        fcntl(readyFd_, F_SETFD, FD_CLOEXEC);
+    }
+    while (fds && *fds)
+    {
+        char *end = nullptr;
+        int fd = static_cast<int>(strtol(fds, &end, 10));
+        if (end == fds)
         {
-            timeMS = timer_->GetNextTick(); // 获取下一次的超时等待事件(至少这个时间才会有用户过期，每次关闭超时连接则需要有新的请求进来)
+            break;
         }
-        int eventCnt = epoller_->Wait(timeMS);
-        for (int i = 0; i < eventCnt; i++)
+        fds = *end == ',' ? end + 1 : end;
+        int listening = 0, reusePort = 0;
+        socklen_t len = sizeof(int);
+        struct sockaddr_in addr = {0};
+        socklen_t addrLen = sizeof(addr);
+        if (getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &len) < 0)
         {
-            /* 处理事件 */
-            int fd = epoller_->GetEventFd(i);
-            uint32_t events = epoller_->GetEvents(i);
-            if (fd == listenFd_)
-            {
-                DealListen_();
-            }
-            else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            continue; // 不是 socket，不属于我们
+        }
+        len = sizeof(int);
+        getsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reusePort, &len);
+        bool usable = listening && (reusePort != 0) == (reactorNum_ > 0) &&
+                      getsockname(fd, (struct sockaddr *)&addr, &addrLen) == 0 &&
+                      addr.sin_family == AF_INET && ntohs(addr.sin_port) == port_;
+        if (usable && (reactorNum_ > 0 || inheritedFds_.empty()))
+        {
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+            inheritedFds_.push_back(fd);
+        }
+        else
+        {
+            close(fd);
+        }
+    }
+    unsetenv(LISTEN_FDS_ENV);
+    unsetenv(READY_FD_ENV);
+}
+
+void WebServer::SignalLoop_()
+{
+    sigset_t signals = SignalSet_();
+    struct timespec tick = {0, SIGNAL_TICK_MS * 1000000L};
+    while (!isClose_)
+    {
+        int sig = sigtimedwait(&signals, nullptr, &tick);
+        switch (sig)
+        {
+        case SIGHUP:
+            Reload_();
+            break;
+        case SIGUSR2:
+            if (draining_)
             {
-                assert(users_.count(fd) > 0);
-                CloseConn_(&users_[fd]);
+                LOG_WARN("Hot restart ignored: already draining");
             }
-            else if (events & EPOLLIN)
+            else if (HotRestart_())
             {
-                assert(users_.count(fd) > 0);
-                DealRead_(&users_[fd]);
+                Drain_();
             }
-            else if (events & EPOLLOUT)
+            break;
+        case SIGTERM:
+        case SIGINT:
+            if (draining_)
             {
-                assert(users_.count(fd) > 0);
-                DealWrite_(&users_[fd]);
+                LOG_WARN("Signal %d while draining, quit now", sig);
+                for (auto &reactor : reactors_)
+                {
+                    reactor->Quit();
+                }
             }
             else
             {
-                LOG_ERROR("Unexpected event");
+                Drain_();
             }
+            break;
+        default:
+            break; // 超时（检查 isClose_）或 EINTR
         }
     }
 }
 
-// 发送错误信息并关闭连接
-void WebServer::SendError_(int fd, const char *info)
+void WebServer::Reload_()
 {
-    assert(fd > 0);
-    int ret = send(fd, info, strlen(info), 0);
-    if (ret < 0)
+    if (config_.Path().empty())
     {
-        LOG_WARN("send error to client[%d] error!", fd);
+        LOG_WARN("SIGHUP ignored: started without a config file");
+        return;
     }
-    close(fd);
-}
-
-// 关闭连接，主要逻辑是将该连接从epoller中删除，并关闭该连接的套接字
-void WebServer::CloseConn_(HttpConn *client)
-{
-    assert(client);
-    LOG_INFO("Client[%d] quit!", client->GetFd());
-    epoller_->DelFd(client->GetFd());
-    client->Close();
+    Config config;
+    std::string err;
+    if (!config.Load(config_.Path(), &err))
+    {
+        LOG_ERROR("Reload %s failed: %s", config_.Path().c_str(), err.c_str());
+        return;
+    }
+    for (const char *const *key = RESTART_KEYS; *key; key++)
+    {
+        if (config.GetString(*key, "") != config_.GetString(*key, ""))
+        {
+            LOG_WARN("Config %s changed, takes effect after hot restart (SIGUSR2)", *key);
+        }
+    }
+    ApplyReloadable_(config);
+    config_ = config;
+    LOG_INFO("Config reloaded: %s", config_.Path().c_str());
 }
 
-// 添加新客户端，主要逻辑是初始化HttpConn对象，并将其加入epoller和timer中
-void WebServer::AddClient_(int fd, sockaddr_in addr)
+// 启动时与 SIGHUP 时调用；只改运行中可以安全修改的设置
+void WebServer::ApplyReloadable_(const Config &config)
 {
-    assert(fd > 0);
-    users_[fd].init(fd, addr);
-    if (timeoutMS_ > 0)
+    Log::Instance()->SetLevel(config.GetInt("log_level", DEFAULT_LOG_LEVEL));
+    int timeoutMS = config.GetInt("timeout_ms", DEFAULT_TIMEOUT_MS);
+    if (timeoutMS != timeoutMS_)
+    {
+        if ((timeoutMS > 0) != (timeoutMS_ > 0))
+        {
+            LOG_WARN("timeout_ms %d -> %d: enabling/disabling timeouts needs a hot restart", timeoutMS_, timeoutMS);
+        }
+        else
+        {
+            timeoutMS_ = timeoutMS;
+            for (auto &reactor : reactors_)
+            {
+                reactor->SetTimeout(timeoutMS);
+            }
+        }
+    }
+    size_t cacheBytes = static_cast<size_t>(std::max(config.GetInt("cache_max_mb", DEFAULT_CACHE_MAX_MB), 0)) * 1024 * 1024;
+    size_t cacheFileBytes = static_cast<size_t>(std::max(config.GetInt("cache_max_file_kb", DEFAULT_CACHE_MAX_FILE_KB), 0)) * 1024;
+    FileCache::Instance()->Init(cacheBytes, cacheFileBytes, config.GetInt("cache_check_ms", DEFAULT_CACHE_CHECK_MS));
+    if (FileCache::Instance()->MaxFileBytes() < cacheFileBytes)
     {
-        timer_->add(fd, timeoutMS_, std::bind(&WebServer::CloseConn_, this, &users_[fd]));
+        LOG_WARN("File cache: cache_max_file_kb %dKB exceeds the per-shard budget, using %dKB",
+                 (int)(cacheFileBytes / 1024), (int)(FileCache::Instance()->MaxFileBytes() / 1024));
     }
-    epoller_->AddFd(fd, EPOLLIN | connEvent_);
-    SetFdNonblock(fd);
-    LOG_INFO("Client[%d] in!", users_[fd].GetFd());
+    LOG_INFO("File cache: %dMB, max file %dKB",
+             (int)(cacheBytes / 1024 / 1024), (int)(FileCache::Instance()->MaxFileBytes() / 1024));
+    drainTimeoutMS_ = config.GetInt("drain_timeout_ms", DEFAULT_DRAIN_TIMEOUT_MS);
 }
 
-// 处理监听套接字，主要逻辑是accept新的套接字，并加入timer和epoller中
-void WebServer::DealListen_()
+// fork+exec 自身，监听 socket 以继承的 fd 交给新进程；新进程就绪前旧进程照常服务
+bool WebServer::HotRestart_()
 {
-    struct sockaddr_in addr;
-    socklen_t len = sizeof(addr);
-    do
+    if (exePath_.empty() || argv_.empty())
+    {
+        LOG_WARN("Hot restart unavailable: executable path unknown");
+        return false;
+    }
+    int pipeFds[2];
+    if (pipe2(pipeFds, O_CLOEXEC) < 0)
+    {
+        LOG_ERROR("Hot restart: pipe error %d", errno);
+        return false;
+    }
+    // fork 之后到 exec 之前只能调用 async-signal-safe 的函数：参数、环境变量与要保留的 fd 都先准备好
+    std::string fdList;
+    for (int fd : listenFds_)
+    {
+        fdList += (fdList.empty() ? "" : ",") + std::to_string(fd);
+    }
+    std::vector<std::string> env;
+    for (char **e = environ; *e; e++)
     {
-        int fd = accept(listenFd_, (struct sockaddr *)&addr, &len);
-        if (fd <= 0)
+        if (strncmp(*e, LISTEN_FDS_ENV, strlen(LISTEN_FDS_ENV)) != 0 &&
+            strncmp(*e, READY_FD_ENV, strlen(READY_FD_ENV)) != 0)
         {
-            return;
+            env.push_back(*e);
         }
-        else if (HttpConn::userCount >= MAX_FD)
+    }
+    env.push_back(std::string(LISTEN_FDS_ENV) + "=" + fdList);
+    env.push_back(std::string(READY_FD_ENV) + "=" + std::to_string(pipeFds[1]));
+    std::vector<char *> envp, argv;
+    for (auto &e : env)
+    {
+        envp.push_back(&e[0]);
+    }
+    envp.push_back(nullptr);
+    for (auto &arg : argv_)
+    {
+        argv.push_back(&arg[0]);
+    }
+    argv.push_back(nullptr);
+    std::vector<int> keep(listenFds_);
+    keep.push_back(pipeFds[1]);
+    int maxFd = static_cast<int>(sysconf(_SC_OPEN_MAX));
+    sigset_t signals = SignalSet_();
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        // 子进程：只留下标准输入输出、监听 socket 与就绪管道（去掉 CLOEXEC），数据库连接、日志文件等全部关闭
+        for (int fd = 3; fd < maxFd; fd++)
         {
-            SendError_(fd, "Server busy!");
-            LOG_WARN("Clients is full!");
-            return;
+            if (std::find(keep.begin(), keep.end(), fd) == keep.end())
+            {
+                close(fd);
+            }
+            else
+            {
+                fcntl(fd, F_SETFD, 0);
+            }
         }
-        AddClient_(fd, addr);
-    } while (listenEvent_ & EPOLLET);
+        pthread_sigmask(SIG_UNBLOCK, &signals, nullptr);
+        execve(exePath_.c_str(), argv.data(), envp.data());
+        _exit(127);
+    }
+    close(pipeFds[1]);
+    if (pid < 0)
+    {
+        LOG_ERROR("Hot restart: fork error %d", errno);
+        close(pipeFds[0]);
+        return false;
+    }
+    LOG_INFO("Hot restart: started %s (pid %d)", exePath_.c_str(), (int)pid);
+    // 新进程初始化失败会直接退出（管道 EOF），卡住则超时
+    struct pollfd pfd = {pipeFds[0], POLLIN, 0};
+    int ret;
+    do
+    {
+        ret = poll(&pfd, 1, RESTART_TIMEOUT_MS);
+    } while (ret < 0 && errno == EINTR);
+    char ready = 0;
+    bool ok = ret > 0 && ::read(pipeFds[0], &ready, 1) == 1;
+    close(pipeFds[0]);
+    if (!ok)
+    {
+        LOG_ERROR("Hot restart failed: pid %d not ready, keep serving", (int)pid);
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        return false;
+    }
+    LOG_INFO("Hot restart: pid %d ready", (int)pid);
+    return true;
 }
 
-// 处理读事件，主要逻辑是将OnRead加入线程池的任务队列中
-void WebServer::DealRead_(HttpConn *client)
+void WebServer::Drain_()
 {
-    assert(client);
-    ExtentTime_(client);
-    threadpool_->AddTask(std::bind(&WebServer::OnRead_, this, client)); // 这是一个右值，bind将参数和函数绑定
+    draining_ = true;
+    LOG_INFO("========== Server draining (up to %dms) ==========", drainTimeoutMS_);
+    HttpConn::draining = true;
+    listenFds_.clear(); // 由各 Reactor 在 Drain 中关闭
+    for (auto &reactor : reactors_)
+    {
+        reactor->Drain(drainTimeoutMS_);
+    }
 }
 
-// 处理写事件，主要逻辑是将OnWrite加入线程池的任务队列中
-void WebServer::DealWrite_(HttpConn *client)
+// 瞬时值在请求 /metrics 时读取，热路径上不维护
+void WebServer::InitMetrics_()
 {
-    assert(client);
-    ExtentTime_(client);
-    threadpool_->AddTask(std::bind(&WebServer::OnWrite_, this, client));
+    Metrics *metrics = Metrics::Instance();
+    metrics->AddGauge("http_active_connections", "Open client connections.",
+                      []
+                      { return static_cast<double>(HttpConn::userCount.load()); });
+    if (threadpool_)
+    {
+        ThreadPool *pool = threadpool_.get();
+        metrics->AddGauge("threadpool_queue_depth", "Tasks queued in the ThreadPool (approximate).",
+                          [pool]
+                          { return static_cast<double>(pool->QueueDepth()); });
+    }
+    metrics->AddGauge("sqlpool_free_connections", "Idle connections in SqlConnPool.",
+                      []
+                      { return static_cast<double>(SqlConnPool::Instance()->GetFreeConnCount()); });
 }
 
-void WebServer::ExtentTime_(HttpConn *client)
+// 创建 Reactor：经典模式一个 Reactor + 线程池；多 Reactor 模式每个 Reactor 独立监听同一端口
+bool WebServer::InitReactors_(int threadNum)
 {
-    assert(client);
-    if (timeoutMS_ > 0)
+    int loopNum = reactorNum_ > 0 ? reactorNum_ : 1;
+    if (reactorNum_ > 0 && static_cast<int>(inheritedFds_.size()) > loopNum)
+    {
+        // 继承来的每个 socket 都在内核的 SO_REUSEPORT 组里，关掉一个会丢掉它队列中的连接：每个 socket 一个 Reactor
+        reactorNum_ = loopNum = static_cast<int>(inheritedFds_.size());
+    }
+    if (reactorNum_ <= 0)
     {
-        timer_->adjust(client->GetFd(), timeoutMS_);
+        threadpool_.reset(new ThreadPool(threadNum));
     }
+    for (int i = 0; i < loopNum; i++)
+    {
+        int listenFd = i < static_cast<int>(inheritedFds_.size()) ? inheritedFds_[i] : InitSocket_(reactorNum_ > 0);
+        if (listenFd < 0)
+        {
+            return false;
+        }
+        listenFds_.push_back(listenFd);
+        int cpu = CpuOf_(i);
+        if (reactorNum_ > 0 && cpu >= 0 &&
+            setsockopt(listenFd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) == -1)
+        {
+            LOG_WARN("set SO_INCOMING_CPU error !");
+        }
+        std::unique_ptr<Reactor> reactor(new Reactor(listenFd, listenEvent_, connEvent_,
+                                                     timeoutMS_, threadpool_.get(), wheelTickMS_, useUring_, maxConn_));
+        if (!reactor->Init())
+        {
+            return false;
+        }
+        reactors_.push_back(std::move(reactor));
+    }
+    return true;
 }
 
-void WebServer::OnRead_(HttpConn *client)
+bool WebServer::ParseCpuList_(const char *spec, std::vector<int> *cpus)
 {
-    assert(client);
-    int ret = -1;
-    int readErrno = 0;
-    ret = client->read(&readErrno); // 读取客户端套接字的数据，读到httpconn的读缓存区
-    if (ret <= 0 && readErrno != EAGAIN)
-    { // 读异常就关闭客户端
-        CloseConn_(client);
-        return;
+    cpus->clear();
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        CPU_ZERO(&allowed);
     }
-    // 业务逻辑的处理（先读后处理）
-    OnProcess(client);
+    const char *p = spec ? spec : "";
+    while (*p)
+    {
+        char *end = nullptr;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (end == p || first < 0)
+        {
+            cpus->clear();
+            return false;
+        }
+        if (*end == '-')
+        {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first)
+            {
+                cpus->clear();
+                return false;
+            }
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+        {
+            if (CPU_ISSET(cpu, &allowed))
+            {
+                cpus->push_back(static_cast<int>(cpu));
+            }
+        }
+        p = end;
+        while (*p == ',' || *p == ' ')
+        {
+            p++;
+        }
+    }
+    return true;
 }
 
-/* 处理读（请求）数据的函数 */
-void WebServer::OnProcess(HttpConn *client)
+bool WebServer::PinThread_(int cpu)
 {
-    // 首先调用process()进行逻辑处理
-    if (client->process())
-    {                                                            // 根据返回的信息重新将fd置为EPOLLOUT（写）或EPOLLIN（读）
-                                                                 // 读完事件就跟内核说可以写了
-        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT); // 响应成功，修改监听事件为写,等待OnWrite_()发送
-    }
-    else
+    if (cpu < 0)
     {
-        // 写完事件就跟内核说可以读了
-        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN);
+        return true;
     }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
 }
 
-void WebServer::OnWrite_(HttpConn *client)
+// 程序的返回值是 SO_REUSEPORT 组中 socket 的下标（按加入组的顺序，即 listenFds_ 的顺序）：
+// 绑定了接收 CPU 的 Reactor 直接命中，其余 CPU（网卡中断不在列表内）按 cpu % n 分散
+bool WebServer::AttachReuseportCbpf_()
 {
-    assert(client);
-    int ret = -1;
-    int writeErrno = 0;
-    ret = client->write(&writeErrno);
-    if (client->ToWriteBytes() == 0)
-    {
-        /* 传输完成 */
-        if (client->IsKeepAlive())
+    std::vector<struct sock_filter> code;
+    code.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU))); // A = 当前 CPU
+    std::vector<int> seen;
+    for (size_t i = 0; i < listenFds_.size(); i++)
+    {
+        int cpu = CpuOf_(i);
+        if (std::find(seen.begin(), seen.end(), cpu) != seen.end())
         {
-            // OnProcess(client);
-            epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN); // 回归换成监测读事件
-            return;
+            continue; // 同一 CPU 上有多个 Reactor 时交给第一个
         }
+        seen.push_back(cpu);
+        code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, static_cast<uint32_t>(cpu), 0, 1));
+        code.push_back(BPF_STMT(BPF_RET | BPF_K, static_cast<uint32_t>(i)));
     }
-    else if (ret < 0)
+    code.push_back(BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, static_cast<uint32_t>(listenFds_.size())));
+    code.push_back(BPF_STMT(BPF_RET | BPF_A, 0));
+    struct sock_fprog prog = {static_cast<unsigned short>(code.size()), code.data()};
+    return setsockopt(listenFds_[0], SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == 0;
+}
+
+int WebServer::ListenBacklog_(int configured)
+{
+    int somaxconn = SOMAXCONN;
+    FILE *fp = fopen("/proc/sys/net/core/somaxconn", "r");
+    if (fp)
     {
-        if (writeErrno == EAGAIN)
-        { // 缓冲区满了
-            /* 继续传输 */
-            epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
-            return;
+        if (fscanf(fp, "%d", &somaxconn) != 1 || somaxconn <= 0)
+        {
+            somaxconn = SOMAXCONN;
         }
+        fclose(fp);
+    }
+    if (configured <= 0 || configured > somaxconn)
+    {
+        return somaxconn;
     }
-    CloseConn_(client);
+    return configured;
 }
 
 /* Create listenFd */
-bool WebServer::InitSocket_()
+int WebServer::InitSocket_(bool reusePort)
 {
     int ret;
+    int listenFd;
     struct sockaddr_in addr;
     if (port_ > 65535 || port_ < 1024)
     {
         LOG_ERROR("Port:%d error!", port_);
-        return false;
+        return -1;
     }
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = htonl(INADDR_ANY);
@@ -293,65 +750,74 @@ bool WebServer::InitSocket_()
             optLinger.l_linger = 1;
         }
 
-        listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
-        if (listenFd_ < 0)
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd < 0)
         {
             LOG_ERROR("Create socket error!", port_);
-            return false;
+            return -1;
         }
 
-        ret = setsockopt(listenFd_, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
+        ret = setsockopt(listenFd, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
         if (ret < 0)
         {
-            close(listenFd_);
+            close(listenFd);
             LOG_ERROR("Init linger error!", port_);
-            return false;
+            return -1;
         }
     }
 
     int optval = 1;
     /* 端口复用 */
     /* 只有最后一个套接字会正常接收数据。 */
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, (const void *)&optval, sizeof(int));
+    ret = setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, (const void *)&optval, sizeof(int));
     if (ret == -1)
     {
         LOG_ERROR("set socket setsockopt error !");
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
+    }
+    /* 多 Reactor：多个监听 socket 绑定同一端口，由内核按连接做负载均衡 */
+    if (reusePort)
+    {
+        ret = setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, (const void *)&optval, sizeof(int));
+        if (ret == -1)
+        {
+            LOG_ERROR("set SO_REUSEPORT error !");
+            close(listenFd);
+            return -1;
+        }
+    }
+
+    /* 三次握手完成后不立即唤醒，等第一个请求到达（或超时）再进入 accept 队列 */
+    if (deferAcceptSec_ > 0 &&
+        setsockopt(listenFd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &deferAcceptSec_, sizeof(deferAcceptSec_)) == -1)
+    {
+        LOG_WARN("set TCP_DEFER_ACCEPT error !");
+    }
+    /* 允许客户端在 SYN 中携带请求数据（需要内核 net.ipv4.tcp_fastopen 开启服务端支持） */
+    if (fastOpenQlen_ > 0 &&
+        setsockopt(listenFd, IPPROTO_TCP, TCP_FASTOPEN, &fastOpenQlen_, sizeof(fastOpenQlen_)) == -1)
+    {
+        LOG_WARN("set TCP_FASTOPEN error !");
     }
 
     // 绑定
-    ret = bind(listenFd_, (struct sockaddr *)&addr, sizeof(addr));
+    ret = bind(listenFd, (struct sockaddr *)&addr, sizeof(addr));
     if (ret < 0)
     {
         LOG_ERROR("Bind Port:%d error!", port_);
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
     }
 
     // 监听
-    ret = listen(listenFd_, 6);
+    ret = listen(listenFd, backlog_);
     if (ret < 0)
     {
         LOG_ERROR("Listen port:%d error!", port_);
-        close(listenFd_);
-        return false;
-    }
-    ret = epoller_->AddFd(listenFd_, listenEvent_ | EPOLLIN); // 将监听套接字加入epoller
-    if (ret == 0)
-    {
-        LOG_ERROR("Add listen error!");
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
     }
-    SetFdNonblock(listenFd_);
     LOG_INFO("Server port:%d", port_);
-    return true;
-}
-
-// 设置非阻塞
-int WebServer::SetFdNonblock(int fd)
-{
-    assert(fd > 0);
-    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFD, 0) | O_NONBLOCK);
+    return listenFd;
 }
@@ -2,6 +2,11 @@
 #define WEBSERVER_H
 
 #include <unordered_map>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <signal.h>      // sigtimedwait()
 #include <fcntl.h>       // fcntl()
 #include <unistd.h>      // close()
 #include <assert.h>
@@ -9,19 +14,37 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <netinet/tcp.h> // TCP_DEFER_ACCEPT, TCP_FASTOPEN
+#include <linux/filter.h> // SO_ATTACH_REUSEPORT_CBPF 的 BPF 程序
+#include <pthread.h>
+#include <sched.h>       // cpu_set_t
 
 #include "epoller.h"
+#include "reactor.h"
 #include "../timer/heaptimer.h"
 
 #include "../log/log.h"
+#include "../log/accesslog.h"
 #include "../pool/sqlconnpool.h"
 #include "../pool/threadpool.h"
+#include "../pool/userverifier.h"
+#include "../metrics/metrics.h"
+#include "../config/config.h"
 
 #include "../http/httpconn.h"
 
 /*
- * WebServer 顶层类：负责启动监听、管理 epoll、分发读写、
- * 管理连接超时（timer）、线程池、和数据库连接池等。
+ * WebServer 顶层类：负责启动监听、创建 Reactor（事件循环）、
+ * 线程池、和数据库连接池等。epoll 分发、连接超时与连接表由 Reactor 管理。
+ *
+ * 信号（构造时屏蔽，Start 后由信号线程用 sigtimedwait 同步处理，不在异步信号处理函数里做事）：
+ *  - SIGHUP          : 重新加载配置文件，应用可热加载的项（log_level、timeout_ms、cache_*、drain_timeout_ms），
+ *                      其余项记录警告，在下一次热重启后生效
+ *  - SIGUSR2         : 热重启。fork+exec 当前可执行文件，监听 socket 通过 fd 继承交给新进程（同一个打开的 socket，
+ *                      监听队列不中断、不需要重新 bind）；新进程初始化完成后经管道通知，旧进程随即排空退出。
+ *                      新进程启动失败时旧进程继续服务
+ *  - SIGTERM/SIGINT  : 排空退出：关闭监听 socket，已有连接处理完当前请求后关闭，最多等待 drain_timeout_ms；
+ *                      排空期间再收到一次则立即退出
  */
 class WebServer {
 public:
@@ -33,81 +56,124 @@ public:
     //   OptLinger   : 是否启用 SO_LINGER（优雅关闭选项）
     //   sqlPort/sqlUser/sqlPwd/dbName : MySQL 配置
     //   connPoolNum : 数据库连接池大小
-    //   threadNum   : 线程池大小（用于处理耗时任务）
+    //   threadNum   : 线程池大小（用于处理耗时任务，仅经典模式使用）
     //   openLog/logLevel/logQueSize : 日志相关配置
+    //   reactorNum  : 0 为经典模式（单 epoll + 线程池）；
+    //                 >0 为多 Reactor 模式（reactorNum 个事件循环线程，各自 SO_REUSEPORT 监听，内联处理读写）
+    //   sendfileKB  : 不小于该大小（KB）且不进文件缓存的文件使用 sendfile 零拷贝发送
+    //   wheelTickMS : 0 使用 HeapTimer 管理连接超时；>0 使用 TimeWheel，tick 粒度为 wheelTickMS 毫秒
+    //   useUring    : 事件后端使用 io_uring（内核不支持时退回 epoll）
+    //   writeBudgetKB : 每个连接每次写最多发送的字节数（KB），用完后让出给其他连接
+    //   highWaterKB / lowWaterKB : 发送队列的高/低水位（KB），达到高水位暂停处理流水线请求，降到低水位以下继续
+    //   backlog     : listen 队列长度，0 取内核上限 net.core.somaxconn，大于上限时截断
+    //   maxConn     : 连接数上限，超过后新连接直接回复 503；0 表示 Reactor::MAX_FD
+    //   deferAcceptSec : >0 时设置 TCP_DEFER_ACCEPT，连接上有数据（或等待该秒数）后才 accept
+    //   fastOpenQlen   : >0 时启用 TCP_FASTOPEN，值为未完成 TFO 握手的队列长度
+    //   maxBodyKB   : 请求体上限（KB），超过回复 413
+    //   bodyMemKB   : 请求体在内存中保存的上限（KB），更大的请求体转存到 /tmp 下的临时文件
+    //   cpuAffinity : 绑核的 CPU 列表（如 "0-3,8-11"），空串表示不绑定。第 i 个 Reactor 绑定到列表中第 i % n 个 CPU，
+    //                 经典模式的线程池 worker 同样依次绑定；多 Reactor 模式下各监听 socket 设置 SO_INCOMING_CPU，
+    //                 并挂上按 CPU 选 socket 的 SO_ATTACH_REUSEPORT_CBPF 程序，网卡队列中断所在核收到的连接交给该核上的 Reactor
+    //   accessLogDir / accessLogSegmentMB : 二进制访问日志（AccessLog）的目录与段文件大小（MB），目录为空串时不记录
+    //   logBlockWhenFull : 每线程日志缓冲区满时等待后台线程腾出空间（true）还是丢弃并计数（false）
     WebServer(
         int port, int trigMode, int timeoutMS, bool OptLinger, 
         int sqlPort, const char* sqlUser, const  char* sqlPwd, 
         const char* dbName, int connPoolNum, int threadNum,
-        bool openLog, int logLevel, int logQueSize);
+        bool openLog, int logLevel, int logQueSize,
+        int reactorNum = 0, int sendfileKB = 1024, int wheelTickMS = 0, bool useUring = false,
+        int writeBudgetKB = 256, int highWaterKB = 256, int lowWaterKB = 64,
+        int backlog = 0, int maxConn = 0, int deferAcceptSec = 0, int fastOpenQlen = 0,
+        int maxBodyKB = 8192, int bodyMemKB = 64, const char* cpuAffinity = "",
+        const char* accessLogDir = "", int accessLogSegmentMB = 256, bool logBlockWhenFull = false);
+
+    // 从配置文件构造：键名与上面的参数对应（见 server.conf），文件中没有的键使用默认值。
+    // argv 为 main 的参数，热重启时原样传给新进程（为 nullptr 时不支持热重启）
+    explicit WebServer(const Config& config, char* const* argv = nullptr);
 
     ~WebServer();
 
-    // 启动服务器主循环：初始化资源并进入事件循环
+    // 启动服务器主循环：经典模式在当前线程运行唯一的 Reactor；
+    // 多 Reactor 模式下启动 reactorNum-1 个线程，当前线程运行第 0 个 Reactor
     void Start();
 
 private:
     // ------ 初始化和辅助 ------
-    // 初始化监听 socket（socket()/bind()/listen()）并设置选项
-    bool InitSocket_(); // 初始化套接字
-
-    // 根据 trigMode 设置 listenEvent_ / connEvent_ 的掩码（EPOLLIN/EPOLLET/EPOLLONESHOT 等）
-    void InitEventMode_(int trigMode);
-
-    // 接受新连接后把 client 加入管理（在 users_ 中创建 HttpConn 并注册到 epoll）
-    void AddClient_(int fd, sockaddr_in addr);
-  
-    // ------ 事件分发（主循环中会调用这些） ------
-    // 处理监听 socket 的可读事件（accept 新连接）
-    void DealListen_();
-
-    // 处理写事件：把 write 缓冲写到 socket（可能会短写，需处理）
-    void DealWrite_(HttpConn* client);
-
-    // 处理读事件：从 socket 读入到缓冲并解析请求，或把任务交给线程池
-    void DealRead_(HttpConn* client);
+    // 创建一个监听 socket（socket()/bind()/listen()）并设置选项，失败返回 -1
+    // reusePort 为 true 时设置 SO_REUSEPORT，多个 Reactor 可绑定同一端口由内核分流
+    int InitSocket_(bool reusePort);
 
-    // 向 fd 发送一个简单的错误响应并关闭连接（用于协议错误等）
-    void SendError_(int fd, const char* info);
+    // 实际使用的 listen 队列长度：配置值与 /proc/sys/net/core/somaxconn 取小（配置为 0 时直接用后者）
+    static int ListenBacklog_(int configured);
 
-    // 当客户端有活动时，延长/重置该连接的定时器，避免被超时回收
-    void ExtentTime_(HttpConn* client);
+    // 注册 /metrics 中在输出时求值的瞬时值（活跃连接数、线程池队列深度等）
+    void InitMetrics_();
 
-    // 关闭连接并清理资源（从 epoll 删除、关闭 fd、移除 users_、取消定时器）
-    void CloseConn_(HttpConn* client);
-
-    // 把 I/O 事件封装为线程池要执行的任务（OnRead_/OnWrite_ 通常是提交给线程池的入口）
-    void OnRead_(HttpConn* client);
-    void OnWrite_(HttpConn* client);
-
-    // 真正的业务处理入口：解析请求、生成响应（可能在 worker 线程中执行）
-    void OnProcess(HttpConn* client);
-
-    // 最大支持的文件描述符数量（作为参考或预分配上限）
-    static const int MAX_FD = 65536;
+    // 根据 trigMode 设置 listenEvent_ / connEvent_ 的掩码（EPOLLIN/EPOLLET/EPOLLONESHOT 等）
+    void InitEventMode_(int trigMode);
 
-    // helper：把 fd 设置为非阻塞（ET 模式必须）
-    static int SetFdNonblock(int fd);
+    // 创建所有 Reactor（以及经典模式下的线程池）
+    bool InitReactors_(int threadNum);
+
+    // ------ 绑核 ------
+    // 解析 "0-3,8" 形式的 CPU 列表，去掉本进程不允许使用的 CPU；格式错误返回 false
+    static bool ParseCpuList_(const char* spec, std::vector<int>* cpus);
+    int CpuOf_(size_t index) const {    // 第 index 个线程绑定的 CPU，-1 表示不绑定
+        return cpus_.empty() ? -1 : cpus_[index % cpus_.size()];
+    }
+    static bool PinThread_(int cpu);    // 把当前线程绑定到 cpu（-1 时不做任何事）
+    // 多 Reactor：给 SO_REUSEPORT 组挂上按接收 CPU 选择监听 socket 的 BPF 程序
+    bool AttachReuseportCbpf_();
+
+    // ------ 信号、配置重新加载与热重启 ------
+    static sigset_t SignalSet_();       // 由信号线程处理的信号
+    void TakeInheritedFds_();           // 热重启的新进程：取出旧进程传下来的监听 socket 与就绪管道
+    void SignalLoop_();
+    void Reload_();                     // SIGHUP
+    void ApplyReloadable_(const Config& config);
+    bool HotRestart_();                 // SIGUSR2：启动新进程并等它就绪，成功返回 true
+    void Drain_();                      // 关闭监听 socket，通知各 Reactor 排空连接后退出
+
+    static const char* METRICS_PATH;    // 返回 Prometheus 文本格式指标的路径
+    static const char* LISTEN_FDS_ENV;  // 热重启时传给新进程的监听 fd 列表（逗号分隔）
+    static const char* READY_FD_ENV;    // 新进程初始化完成后写一个字节的管道 fd
+    static const int RESTART_TIMEOUT_MS = 10000;  // 等待新进程就绪的时间，超时则杀掉新进程继续服务
+    static const int SIGNAL_TICK_MS = 200;        // 信号线程检查 isClose_ 的间隔
 
     // ------ 配置状态 ------
     int port_;             // 监听端口
     bool openLinger_;      // 是否启用 SO_LINGER 优雅关闭
     int timeoutMS_;        // 连接超时时间（毫秒）
-    bool isClose_;         // 服务器是否已经关闭标志（Start 的循环使用）
-    int listenFd_;         // 监听 socket 的 fd
+    std::atomic<bool> isClose_;  // 服务器是否已经关闭标志（初始化失败时为 true）
+    int reactorNum_;       // Reactor 数量，0 表示经典模式
+    int wheelTickMS_;      // 时间轮 tick（毫秒），0 表示使用 HeapTimer
+    bool useUring_;        // 是否请求 io_uring 事件后端
+    int backlog_;          // listen 队列长度（已按 somaxconn 截断）
+    int maxConn_;          // 连接数上限
+    int deferAcceptSec_;   // TCP_DEFER_ACCEPT 秒数，0 表示不设置
+    int fastOpenQlen_;     // TCP_FASTOPEN 队列长度，0 表示不启用
     char* srcDir_;         // 静态资源目录（例如网页文件根目录）
+    std::vector<int> cpus_;  // 绑核的 CPU 列表，空表示不绑定
     
     // epoll 上的事件掩码：listen socket 的事件与 client socket 的事件
     uint32_t listenEvent_;  // 监听 socket 要关注的事件掩码（例如 EPOLLIN | EPOLLET）
     uint32_t connEvent_;    // 连接 socket 要关注的事件掩码（例如 EPOLLIN | EPOLLOUT | EPOLLET | EPOLLONESHOT）
    
-    // 核心组件：定时器、线程池、epoll 封装、以及连接表
-    std::unique_ptr<HeapTimer> timer_;        // 管理连接的超时回调
-    std::unique_ptr<ThreadPool> threadpool_;  // 处理耗时任务（如请求解析、DB 操作）
-    std::unique_ptr<Epoller> epoller_;        // epoll 封装，等待/分发事件
-
-    // 连接表：以 fd 为键保存每个连接的 HttpConn 对象（注意：存对象时会有地址稳定性问题）
-    std::unordered_map<int, HttpConn> users_;
+    // 核心组件：线程池（仅经典模式）与各个事件循环
+    std::unique_ptr<ThreadPool> threadpool_;        // 处理耗时任务（如请求解析、DB 操作）
+    std::vector<int> listenFds_;                    // 每个 Reactor 一个监听 fd（经典模式只有一个）
+    std::vector<std::unique_ptr<Reactor>> reactors_;
+    std::vector<std::thread> threads_;              // 除第 0 个以外的 Reactor 线程
+
+    // 以下只在构造函数与信号线程中访问
+    std::thread signalThread_;
+    Config config_;                         // 最近一次加载的配置（Path() 为空表示没有配置文件）
+    std::string exePath_;                   // 热重启时 exec 的可执行文件（启动时的 /proc/self/exe）
+    std::vector<std::string> argv_;         // 热重启时传给新进程的参数
+    std::vector<int> inheritedFds_;         // 从旧进程继承的监听 socket
+    int readyFd_;                           // 就绪管道（不是热重启启动的为 -1）
+    int drainTimeoutMS_;                    // 排空的期限（毫秒）
+    bool draining_;
 };
 
 #endif //WEBSERVER_H
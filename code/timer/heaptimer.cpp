@@ -10,12 +10,11 @@ void HeapTimer::SwapNode_(size_t i, size_t j) {
 
 void HeapTimer::siftup_(size_t i) {
     assert(i >= 0 && i < heap_.size());
-    size_t parent = (i-1) / 2;
-    while(parent >= 0) {
+    while(i > 0) {     // size_t 的 parent 永远 >= 0，到根结点时必须停下
+        size_t parent = (i-1) / 2;
         if(heap_[parent] > heap_[i]) {
             SwapNode_(i, parent);
             i = parent;
-            parent = (i-1)/2;
         } else {
             break;
         }
@@ -96,6 +95,13 @@ void HeapTimer::doWork(int id) {
     node.cb();  // 触发回调函数
     del_(i);
 }
+// 删除指定id，不触发回调
+void HeapTimer::cancel(int id) {
+    if(heap_.empty() || ref_.count(id) == 0) {
+        return;
+    }
+    del_(ref_[id]);
+}
 // 清除超时结点
 void HeapTimer::tick() {
     if(heap_.empty()) {
@@ -0,0 +1,33 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <functional>
+#include <chrono>
+
+typedef std::function<void()> TimeoutCallBack;
+typedef std::chrono::high_resolution_clock Clock;
+typedef std::chrono::milliseconds MS;
+typedef Clock::time_point TimeStamp;
+
+/*
+ * Timer：连接超时定时器的公共接口，id 为连接 fd
+ * 由 Reactor 在自己的线程中使用，实现不需要线程安全。
+ *  - HeapTimer：小根堆，到期时间精确到毫秒，adjust 为 O(log n)
+ *  - TimeWheel：时间轮，add/adjust/cancel 均为 O(1)，到期时间按 tick 粒度取整
+ */
+class Timer {
+public:
+    virtual ~Timer() = default;
+
+    // 添加 id 的定时器（已存在则更新超时时间与回调）
+    virtual void add(int id, int timeOut, const TimeoutCallBack& cb) = 0;
+    // 把 id 的超时时间推迟为从现在起 newExpires 毫秒
+    virtual void adjust(int id, int newExpires) = 0;
+    // 取消 id 的定时器（不触发回调，不存在时忽略）
+    virtual void cancel(int id) = 0;
+    virtual void clear() = 0;
+    // 触发所有已到期的回调，返回距下一次需要检查的毫秒数（没有定时器时返回 -1）
+    virtual int GetNextTick() = 0;
+};
+
+#endif //TIMER_H
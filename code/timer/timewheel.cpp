@@ -0,0 +1,137 @@
+#include "timewheel.h"
+
+TimeWheel::TimeWheel(int tickMS, int slotNum)
+    : tickMS_(tickMS > 0 ? tickMS : 1), slotNum_(slotNum > 0 ? slotNum : 1),
+      start_(Clock::now()), curTick_(0), count_(0), heads_(slotNum_, -1) {}
+
+void TimeWheel::add(int id, int timeOut, const TimeoutCallBack& cb) {
+    assert(id >= 0);
+    if(static_cast<size_t>(id) >= nodes_.size()) {
+        nodes_.resize(std::max(static_cast<size_t>(id) + 1, nodes_.size() * 2));
+    }
+    Unlink_(id);
+    Node& node = nodes_[id];
+    node.cb = cb;
+    node.expireTick = NowTick_() + TicksOf_(timeOut);
+    Link_(id, node.expireTick);
+}
+
+// 只推迟到期 tick；提前到期的情况（超时缩短）才需要换槽
+void TimeWheel::adjust(int id, int newExpires) {
+    assert(static_cast<size_t>(id) < nodes_.size() && nodes_[id].slot >= 0);
+    Node& node = nodes_[id];
+    node.expireTick = NowTick_() + TicksOf_(newExpires);
+    if(node.expireTick < node.linkedTick) {
+        Unlink_(id);
+        Link_(id, node.expireTick);
+    }
+}
+
+void TimeWheel::cancel(int id) {
+    if(id < 0 || static_cast<size_t>(id) >= nodes_.size()) {
+        return;
+    }
+    Unlink_(id);
+    nodes_[id].cb = nullptr;
+}
+
+void TimeWheel::clear() {
+    nodes_.clear();
+    heads_.assign(slotNum_, -1);
+    count_ = 0;
+}
+
+// 转动时间轮到当前 tick，逐槽触发到期回调；落后超过一圈时每个槽只需处理一遍
+int TimeWheel::GetNextTick() {
+    int64_t now = NowTick_();
+    if(now > curTick_) {
+        if(now - curTick_ >= slotNum_) {
+            for(int i = 0; i < slotNum_; i++) {
+                ProcessSlot_(i, now);
+            }
+        } else {
+            for(int64_t t = curTick_ + 1; t <= now; t++) {
+                ProcessSlot_(static_cast<int>(t % slotNum_), now);
+            }
+        }
+        curTick_ = now;
+    }
+    if(count_ == 0) {
+        return -1;
+    }
+    // 下一个 tick 边界
+    int64_t elapsed = std::chrono::duration_cast<MS>(Clock::now() - start_).count();
+    int64_t res = (curTick_ + 1) * tickMS_ - elapsed;
+    return res > 0 ? static_cast<int>(res) : 0;
+}
+
+int64_t TimeWheel::NowTick_() const {
+    return std::chrono::duration_cast<MS>(Clock::now() - start_).count() / tickMS_;
+}
+
+// 向上取整到 tick；当前 tick 已经过去了一部分，再多加一个 tick，保证不会提前超时
+int64_t TimeWheel::TicksOf_(int ms) const {
+    return (ms <= 0 ? 0 : (ms + tickMS_ - 1) / tickMS_) + 1;
+}
+
+void TimeWheel::Link_(int id, int64_t tick) {
+    Node& node = nodes_[id];
+    int slot = static_cast<int>(tick % slotNum_);
+    node.slot = slot;
+    node.linkedTick = tick;
+    node.prev = -1;
+    node.next = heads_[slot];
+    if(node.next >= 0) {
+        nodes_[node.next].prev = id;
+    }
+    heads_[slot] = id;
+    count_++;
+}
+
+void TimeWheel::Unlink_(int id) {
+    Node& node = nodes_[id];
+    if(node.slot < 0) {
+        return;
+    }
+    if(node.prev >= 0) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        heads_[node.slot] = node.next;
+    }
+    if(node.next >= 0) {
+        nodes_[node.next].prev = node.prev;
+    }
+    node.prev = node.next = node.slot = -1;
+    count_--;
+}
+
+// 先把整个槽摘下来再逐个处理：未到期的重新挂入（可能是其他槽），到期的触发回调
+// 回调中可以安全地 add/cancel；到期列表复用 expired_ 的容量，处理期间换到局部变量，回调重入也不会改到它
+void TimeWheel::ProcessSlot_(int slot, int64_t now) {
+    int id = heads_[slot];
+    heads_[slot] = -1;
+    std::vector<int> expired;
+    expired.swap(expired_);
+    while(id >= 0) {
+        Node& node = nodes_[id];
+        int next = node.next;
+        node.prev = node.next = node.slot = -1;
+        count_--;
+        if(node.expireTick > now) {
+            Link_(id, node.expireTick);
+        } else {
+            expired.push_back(id);
+        }
+        id = next;
+    }
+    for(int e : expired) {
+        if(static_cast<size_t>(e) >= nodes_.size() || nodes_[e].slot >= 0 || !nodes_[e].cb) {
+            continue;   // 被前面的回调重新 add 或 cancel 了
+        }
+        TimeoutCallBack cb;
+        cb.swap(nodes_[e].cb);
+        cb();
+    }
+    expired.clear();
+    expired_.swap(expired);
+}
@@ -0,0 +1,55 @@
+#ifndef TIME_WHEEL_H
+#define TIME_WHEEL_H
+
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include <assert.h>
+#include "timer.h"
+
+/*
+ * TimeWheel：哈希时间轮
+ *  - 轮上有 slotNum 个槽，每 tickMS 毫秒转过一个槽；超时超过一圈的结点在槽里等待多圈
+ *  - 结点按 id（fd）直接存放在数组中，槽内用下标组成的双向链表串起来，不需要哈希表
+ *  - add / cancel 只做链表的 O(1) 插入删除；adjust 只改写到期 tick，
+ *    结点转到旧槽时发现未到期再挂到新槽（连接活跃时每次读写只是一次赋值）
+ * 到期时间按 tick 向上取整，超时回调最多晚 tickMS 毫秒触发。
+ */
+class TimeWheel : public Timer {
+public:
+    explicit TimeWheel(int tickMS = 100, int slotNum = 512);
+    ~TimeWheel() { clear(); }
+
+    void add(int id, int timeOut, const TimeoutCallBack& cb) override;
+    void adjust(int id, int newExpires) override;
+    void cancel(int id) override;
+    void clear() override;
+    int GetNextTick() override;
+
+private:
+    struct Node {
+        int prev = -1;
+        int next = -1;
+        int slot = -1;              // 所在槽，-1 表示不在轮上
+        int64_t linkedTick = 0;     // 挂入槽时对应的到期 tick
+        int64_t expireTick = 0;     // 实际到期 tick（adjust 只改这里）
+        TimeoutCallBack cb;
+    };
+
+    int64_t NowTick_() const;
+    int64_t TicksOf_(int ms) const;
+    void Link_(int id, int64_t tick);
+    void Unlink_(int id);
+    void ProcessSlot_(int slot, int64_t now);
+
+    const int tickMS_;
+    const int slotNum_;
+    const TimeStamp start_;
+    int64_t curTick_;               // 已处理到的 tick
+    size_t count_;                  // 轮上的结点数
+    std::vector<int> heads_;        // 每个槽的链表头（结点下标），-1 表示空
+    std::vector<Node> nodes_;       // 以 id 为下标
+    std::vector<int> expired_;      // ProcessSlot_ 的到期列表，清空后复用
+};
+
+#endif //TIME_WHEEL_H
@@ -1,5 +1,16 @@
 #include "../code/log/log.h"
 #include "../code/pool/threadpool.h"
+#include "../code/http/httprequest.h"
+#include "../code/timer/timewheel.h"
+#include "../code/config/config.h"
+#include "../code/log/accesslog.h"
+#include "../code/metrics/metrics.h"
+#include "../code/http/httpconn.h"
+#include <dirent.h>
+#include <set>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
 #include <features.h>
 
 #if __GLIBC__ == 2 && __GLIBC_MINOR__ < 30
@@ -30,6 +41,57 @@ void TestLog() {
     }
 }
 
+// 延迟格式化：同步模式下逐行写入，检查 Decode_ 对常见转换符、类型不符与参数不足的处理
+void TestLogFormat() {
+    const char* dir = "/tmp/tinywebserver_test_logfmt";
+    Log::Instance()->init(0, dir, ".log", 0);
+    short h = 0;
+    const std::string longStr(Log::MAX_RECORD_LEN + 1000, 'x');
+    LOG_INFO("[%.3s]", "abcdef");
+    LOG_INFO("[%-8s]", std::string("ab"));
+    LOG_INFO("[%*d] [%.*s]", 5, 42, 2, "abcdef");
+    LOG_INFO("[%hd]", 70000);
+    LOG_INFO("[%c%c]", 'o', 'k');
+    LOG_INFO("[%s]", 12);
+    LOG_INFO("[%d %d %s]", 1);
+    LOG_INFO("100%");
+    LOG_INFO("%s", longStr);
+    LOG_INFO("[%d]", h);
+
+    const char* expect[] = {"[abc]", "[ab      ]", "[   42] [ab]", "[4464]", "[ok]", "[12]",
+                            "[1 %d %s]", "100%", nullptr, "[0]"};
+    DIR* d = opendir(dir);
+    assert(d);
+    std::string name;
+    while(struct dirent* ent = readdir(d)) {
+        if(ent->d_name[0] != '.') { name = std::string(dir) + "/" + ent->d_name; }
+    }
+    closedir(d);
+    FILE* fp = fopen(name.c_str(), "r");
+    assert(fp);
+    char line[Log::MAX_LINE_LEN + 1];
+    size_t i = 0;
+    while(fgets(line, sizeof(line), fp)) {
+        const char* msg = strstr(line, "] : ");
+        assert(msg && i < sizeof(expect) / sizeof(expect[0]));
+        std::string text(msg + 4);
+        assert(!text.empty() && text.back() == '\n');
+        text.pop_back();
+        if(expect[i]) {
+            assert(text == expect[i]);
+        } else {
+            // 超过一条记录容量的字符串被截断，不越界
+            assert(text.size() < longStr.size() && text.size() > Log::MAX_RECORD_LEN / 2 &&
+                   text.find_first_not_of('x') == std::string::npos);
+        }
+        i++;
+    }
+    fclose(fp);
+    assert(i == sizeof(expect) / sizeof(expect[0]));
+    unlink(name.c_str());
+    rmdir(dir);
+}
+
 void ThreadLogTask(int i, int cnt) {
     for(int j = 0; j < 10000; j++ ){
         LOG_BASE(i,"PID:[%04d]======= %05d ========= ", gettid(), cnt++);
@@ -45,7 +107,310 @@ void TestThreadPool() {
     getchar();
 }
 
+// 请求分多次到达时解析器应保留状态，逐段喂入后得到完整请求
+void TestHttpRequest() {
+    const char* raw = "GET /index HTTP/1.1\r\nHost: a\r\nConnection: keep-alive\r\n\r\n";
+    HttpRequest req;
+    Buffer buff;
+    size_t n = strlen(raw);
+    for(size_t i = 0; i < n; i++) {
+        buff.Append(raw + i, 1);
+        HttpRequest::PARSE_RESULT ret = req.parse(buff);
+        assert(ret == (i + 1 == n ? HttpRequest::PARSE_OK : HttpRequest::PARSE_AGAIN));
+    }
+    assert(req.method() == "GET" && req.path() == "/index.html" && req.version() == "1.1");
+    assert(std::string(req.Target(), req.TargetLen()) == "/index");    // 访问日志记录映射前的请求目标
+    assert(req.IsKeepAlive() && buff.ReadableBytes() == 0);
+    assert(strcmp(req.GetHeader("host"), "a") == 0 && *req.Header(HttpRequest::HEADER_RANGE) == '\0');
+
+    // HTTP/1.1 没有 Connection 头时默认保持连接：流水线上的两个请求依次解析，都不关闭；HTTP/1.0 默认关闭
+    buff.Append("GET /a HTTP/1.1\r\nHost: a\r\n\r\nGET /b HTTP/1.1\r\nHost: a\r\n\r\n");
+    assert(req.parse(buff) == HttpRequest::PARSE_OK && req.path() == "/a" && req.IsKeepAlive());
+    assert(req.parse(buff) == HttpRequest::PARSE_OK && req.path() == "/b" && req.IsKeepAlive());
+    assert(buff.ReadableBytes() == 0);
+    buff.Append("GET /c HTTP/1.1\r\nConnection: Close\r\n\r\nGET /d HTTP/1.0\r\n\r\n");
+    assert(req.parse(buff) == HttpRequest::PARSE_OK && !req.IsKeepAlive());
+    assert(req.parse(buff) == HttpRequest::PARSE_OK && !req.IsKeepAlive());
+
+    // 头部名字不区分大小写；表单做 URL 解码
+    buff.Append("POST /x HTTP/1.1\r\ncontent-length: 17\r\n"
+                "Content-Type: application/x-www-form-urlencoded\r\n\r\nu=a%40b+c&p=1%2A2");
+    assert(req.parse(buff) == HttpRequest::PARSE_OK);
+    assert(req.GetPost("u") == "a@b c" && req.GetPost("p") == "1*2" && req.IsKeepAlive());
+
+    // chunked 请求体逐段到达，解码后的长度不含分块长度行
+    const char* chunked = "POST /x HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                          "5\r\nhello\r\n6;ext=1\r\n world\r\n0\r\n\r\n";
+    n = strlen(chunked);
+    for(size_t i = 0; i < n; i++) {
+        buff.Append(chunked + i, 1);
+        HttpRequest::PARSE_RESULT ret = req.parse(buff);
+        assert(ret == (i + 1 == n ? HttpRequest::PARSE_OK : HttpRequest::PARSE_AGAIN));
+    }
+    assert(req.body() == "hello world" && req.BodyLen() == 11);
+
+    // 超过上限的 Content-Length 不等请求体到达就拒绝
+    buff.Append("POST /x HTTP/1.1\r\nContent-Length: 999999999999\r\n\r\n");
+    assert(req.parse(buff) == HttpRequest::PARSE_ERROR && req.ErrorCode() == 413);
+
+    // Content-Length 只接受十进制数字；重复时必须一致，不一致可能是请求走私，回复 400
+    buff.Append("POST /x HTTP/1.1\r\nContent-Length: 2\r\nContent-Length: 2\r\n\r\nok");
+    assert(req.parse(buff) == HttpRequest::PARSE_OK && req.body() == "ok");
+    const char* badLens[] = {"Content-Length: 2\r\nContent-Length: 3", "Content-Length: +2",
+                             "Content-Length: -1", "Content-Length: 0x2", "Content-Length: 2 2",
+                             "Content-Length: 99999999999999999999999", "Content-Length:"};
+    for(const char* bad : badLens) {
+        buff.RetrieveAll();
+        buff.Append(std::string("POST /x HTTP/1.1\r\n") + bad + "\r\n\r\nok");
+        assert(req.parse(buff) == HttpRequest::PARSE_ERROR && req.ErrorCode() == 400 && !req.IsKeepAlive());
+    }
+    buff.RetrieveAll();
+
+    // 过长的头部行即使一次完整到达也拒绝
+    buff.Append("GET / HTTP/1.1\r\nX-Long: " + std::string(9000, 'a') + "\r\n\r\n");
+    assert(req.parse(buff) == HttpRequest::PARSE_ERROR && req.ErrorCode() == 400 && !req.IsKeepAlive());
+    buff.RetrieveAll();
+
+    buff.Append("BAD\r\n\r\n");
+    assert(req.parse(buff) == HttpRequest::PARSE_ERROR && !req.IsKeepAlive());
+}
+
+// 生成一个响应：返回状态行与头部，*body 为头部之后 Buffer 中的字节数加上各文件分段的长度
+std::string MakeTestResponse(HttpResponse& resp, const char* dir, const char* range, size_t* body,
+                             const char* ifNoneMatch = "", const char* ifModifiedSince = "",
+                             const char* acceptEncoding = "") {
+    Buffer buff;
+    resp.Init(dir, "/a.txt", false, 200);
+    resp.SetRange(range);
+    resp.SetConditional(ifNoneMatch, ifModifiedSince);
+    resp.SetAcceptEncoding(acceptEncoding);
+    resp.MakeResponse(buff);
+    std::string out(buff.Peek(), buff.ReadableBytes());
+    size_t end = out.find("\r\n\r\n");
+    assert(end != std::string::npos);
+    *body = out.size() - end - 4;
+    for(const BodyPart& part : resp.Parts()) {
+        *body += part.len;
+    }
+    resp.UnmapFile();
+    return out.substr(0, end + 2);
+}
+
+bool HasHeader(const std::string& head, const std::string& line) {
+    return head.find("\r\n" + line + "\r\n") != std::string::npos;
+}
+
+// 响应：后缀区间、开放区间、越界区间（416）与多区间（multipart/byteranges，Content-Length 与实际正文一致）；
+// 条件请求（ETag 列表、*、无法解析的 If-Modified-Since）与压缩协商
+void TestHttpResponse() {
+    const char* dir = "/tmp/tinywebserver_test_resp";
+    mkdir(dir, 0755);
+    std::string file = std::string(dir) + "/a.txt";
+    FILE* fp = fopen(file.c_str(), "w");
+    assert(fp);
+    for(int i = 0; i < 1000; i++) { fputc('a' + i % 26, fp); }
+    fclose(fp);
+    chmod(file.c_str(), 0644);
+
+    HttpResponse resp;
+    size_t body = 0;
+    std::string head = MakeTestResponse(resp, dir, "", &body);
+    assert(head.compare(0, 15, "HTTP/1.1 200 OK") == 0 && HasHeader(head, "Content-Length: 1000") && body == 1000);
+
+    head = MakeTestResponse(resp, dir, "bytes=-500", &body);
+    assert(head.compare(0, 12, "HTTP/1.1 206") == 0 && HasHeader(head, "Content-Range: bytes 500-999/1000"));
+    assert(resp.Parts().size() == 1 && resp.Parts()[0].offset == 500 && body == 500);
+
+    head = MakeTestResponse(resp, dir, "bytes=100-", &body);
+    assert(HasHeader(head, "Content-Range: bytes 100-999/1000") && HasHeader(head, "Content-Length: 900") && body == 900);
+
+    head = MakeTestResponse(resp, dir, "bytes=2000-", &body);
+    assert(head.compare(0, 12, "HTTP/1.1 416") == 0 && HasHeader(head, "Content-Range: bytes */1000"));
+
+    head = MakeTestResponse(resp, dir, "bytes=0-9,20-29,-5", &body);
+    assert(head.compare(0, 12, "HTTP/1.1 206") == 0 && resp.Parts().size() == 3);
+    assert(head.find("Content-Type: multipart/byteranges; boundary=") != std::string::npos);
+    assert(HasHeader(head, "Content-Length: " + std::to_string(body)));
+
+    head = MakeTestResponse(resp, dir, "", &body);
+    size_t pos = head.find("\r\nETag: ");
+    assert(pos != std::string::npos);
+    std::string etag = head.substr(pos + 8, head.find("\r\n", pos + 2) - pos - 8);
+    std::string list = "\"other\", W/" + etag;
+    head = MakeTestResponse(resp, dir, "", &body, list.c_str());
+    assert(head.compare(0, 12, "HTTP/1.1 304") == 0 && body == 0);
+    head = MakeTestResponse(resp, dir, "bytes=0-9", &body, "*");
+    assert(head.compare(0, 12, "HTTP/1.1 304") == 0);
+    head = MakeTestResponse(resp, dir, "", &body, "\"other\"");
+    assert(head.compare(0, 12, "HTTP/1.1 200") == 0 && body == 1000);
+    head = MakeTestResponse(resp, dir, "", &body, "", "Fri, 31 Dec 2999 23:59:59 GMT");
+    assert(head.compare(0, 12, "HTTP/1.1 304") == 0);
+    head = MakeTestResponse(resp, dir, "", &body, "", "not a date");   // 无法解析的日期忽略
+    assert(head.compare(0, 12, "HTTP/1.1 200") == 0 && body == 1000);
+
+    // 可压缩的文本：按 Accept-Encoding 选择变体，q=0 表示拒绝
+    head = MakeTestResponse(resp, dir, "", &body, "", "", "gzip;q=0.5, br;q=0");
+    assert(HasHeader(head, "Content-Encoding: gzip") && HasHeader(head, "Vary: Accept-Encoding") && body < 1000);
+    head = MakeTestResponse(resp, dir, "", &body, "", "", "identity");
+    assert(head.find("Content-Encoding") == std::string::npos && body == 1000);
+
+    unlink(file.c_str());
+    rmdir(dir);
+}
+
+// 缓冲区：扩容时保留未读数据，Shrink 后内存块回到本线程的块池并被下一次写入复用
+void TestBuffer() {
+    Buffer buff;
+    assert(buff.Capacity() == 0);
+    std::string data(5000, 'x');
+    buff.Append("head");
+    buff.Retrieve(2);
+    buff.Append(data);
+    assert(buff.ReadableBytes() == 2 + data.size() && buff.Capacity() == 8192);
+    assert(std::string(buff.Peek(), 2) == "ad" && buff.Peek()[2 + data.size() - 1] == 'x');
+
+    size_t cached = BufferPool::CachedBytes();
+    buff.Shrink();
+    assert(buff.Capacity() == 8192);    // 还有可读数据时不归还
+    buff.RetrieveAll();
+    buff.Shrink();
+    assert(buff.Capacity() == 0 && BufferPool::CachedBytes() == cached + 8192);
+    buff.Append(data);
+    assert(BufferPool::CachedBytes() == cached && buff.ReadableBytes() == data.size());
+}
+
+// 时间轮：到期触发、取消不触发、adjust 推迟到期；超时超过一圈也能按时触发
+void TestTimeWheel() {
+    TimeWheel wheel(10, 4);
+    int fired[3] = {0};
+    wheel.add(0, 50, [&fired] { fired[0]++; });
+    wheel.add(1, 50, [&fired] { fired[1]++; });
+    wheel.add(2, 50, [&fired] { fired[2]++; });
+    wheel.cancel(1);
+    for(int i = 0; i < 10; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        wheel.GetNextTick();
+        if(i < 5) { wheel.adjust(2, 100); }
+    }
+    assert(fired[0] == 1 && fired[1] == 0 && fired[2] == 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    wheel.GetNextTick();
+    assert(fired[2] == 1 && wheel.GetNextTick() == -1);
+}
+
+// 配置文件：注释与空白、重复键取最后一个、缺省与非法值取默认值；格式错误时保留原内容
+void TestConfig() {
+    const char* path = "/tmp/tinywebserver_test.conf";
+    FILE* fp = fopen(path, "w");
+    assert(fp);
+    fputs("# comment\n\nport = 1316\n  timeout_ms=100 # inline\nport = 8080\n"
+          "use_uring = on\nsql_user = root \nbad_int = 12x\n", fp);
+    fclose(fp);
+    Config config;
+    std::string err;
+    assert(config.Load(path, &err) && config.Path() == path);
+    assert(config.GetInt("port", 0) == 8080 && config.GetInt("timeout_ms", 0) == 100);
+    assert(config.GetBool("use_uring", false) && !config.GetBool("open_log", false));
+    assert(config.GetString("sql_user", "") == "root" && config.GetInt("bad_int", 7) == 7);
+    assert(!config.Has("reactor_num") && config.GetInt("reactor_num", 4) == 4);
+
+    fp = fopen(path, "w");
+    fputs("port = 1\nnot a pair\n", fp);
+    fclose(fp);
+    assert(!config.Load(path, &err) && err.find("line 2") != std::string::npos);
+    assert(config.GetInt("port", 0) == 8080);
+    unlink(path);
+}
+
+// 访问日志：多个线程并发写，连续换段（换下的段在写者离开后才解除映射）；
+// 每个段中的请求记录都能在同一段里找到路径字典
+void TestAccessLog() {
+    const char* dir = "/tmp/tinywebserver_test_access";
+    AccessLog* log = AccessLog::Instance();
+    assert(log->Init(dir, AccessLog::MIN_SEGMENT_BYTES) && log->IsOpen());
+    const char* paths[] = {"/index.html", "/login", "/picture.html"};
+    auto writer = [&](int id) {
+        for(int i = 0; i < 3000; i++) {
+            AccessRecord rec = {};
+            rec.status = 200;
+            rec.fd = id;
+            log->Append(rec, Metrics::Now(), paths[i % 3], strlen(paths[i % 3]));
+        }
+    };
+    std::vector<std::thread> writers;
+    for(int id = 0; id < 6; id++) {
+        writers.emplace_back(writer, id);
+    }
+    for(std::thread& t : writers) {
+        t.join();
+    }
+    log->Close();
+    assert(!log->IsOpen());
+
+    size_t requests = 0;
+    int files = 0;
+    DIR* d = opendir(dir);
+    assert(d);
+    while(struct dirent* ent = readdir(d)) {
+        if(ent->d_name[0] == '.') { continue; }
+        std::string name = std::string(dir) + "/" + ent->d_name;
+        FILE* fp = fopen(name.c_str(), "rb");
+        AccessLogHeader header;
+        assert(fp && fread(&header, sizeof(header), 1, fp) == 1);
+        assert(!memcmp(header.magic, ACCESS_LOG_MAGIC, sizeof(header.magic)) && header.recordSize == ACCESS_RECORD_SIZE);
+        std::set<uint32_t> known, used;
+        AccessRecord rec;
+        while(fread(&rec, sizeof(rec), 1, fp) == 1) {
+            if(rec.type == ACCESS_RECORD_PATH) {
+                known.insert(reinterpret_cast<AccessPathRecord*>(&rec)->pathId);
+            } else if(rec.type == ACCESS_RECORD_REQUEST) {
+                used.insert(rec.pathId);
+                requests++;
+            }
+        }
+        for(uint32_t id : used) { assert(known.count(id)); }
+        fclose(fp);
+        unlink(name.c_str());
+        files++;
+    }
+    closedir(d);
+    rmdir(dir);
+    assert(requests == 18000 && files > 1);
+}
+
+// 经典模式的连接所有权：旧任务晚到的 EndTask 不能清掉新任务的标记；关闭后的读写被拒绝
+void TestConnTask() {
+    int fds[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    sockaddr_in addr = {};
+    HttpConn conn;
+    conn.init(fds[0], addr);
+    assert(!conn.InTask());
+    uint32_t first = conn.BeginTask();
+    uint32_t second = conn.BeginTask();     // 第一个任务重新注册事件后、返回前，第二个任务已经开始
+    conn.EndTask(first);
+    assert(conn.InTask());
+    conn.EndTask(second);
+    assert(!conn.InTask());
+
+    conn.Close();
+    int err = 0;
+    assert(conn.IsClosed() && conn.read(&err) == -1 && err == EBADF);
+    assert(!conn.process());
+    conn.init(fds[1], addr);                // 对象被同一 fd 的新连接复用
+    assert(!conn.IsClosed() && !conn.InTask());
+    conn.Close();
+}
+
 int main() {
+    TestConfig();
+    TestConnTask();
+    TestAccessLog();
+    TestBuffer();
+    TestHttpRequest();
+    TestHttpResponse();
+    TestTimeWheel();
+    TestLogFormat();
     TestLog();
     TestThreadPool();
 }
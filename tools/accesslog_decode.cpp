@@ -0,0 +1,169 @@
+/*
+ * accesslog_decode：把 AccessLog 的二进制段文件解码成文本或 CSV
+ *
+ *  - 每个文件单独解码：先扫一遍收集路径字典（ACCESS_RECORD_PATH），再按文件中的顺序输出请求记录
+ *  - type 为 0 的记录（预分配的空白、进程崩溃时没写完的记录）跳过
+ *  - 多个线程并发写同一个段，记录只在每个线程内按时间有序；需要全局有序时用 -c 输出后按 time 列排序
+ *
+ * 用法示例：
+ *   accesslog_decode log/access/access-1.bin              每行一个请求
+ *   accesslog_decode -c log/access/access-*.bin > a.csv  CSV（带表头）
+ *   accesslog_decode -s 500 access-*.bin                  只输出状态码 >= 500 的请求
+ */
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <string>
+#include <unordered_map>
+
+#include "../code/log/accesslog.h"
+
+namespace {
+
+struct Options {
+    bool csv = false;
+    int minStatus = 0;
+};
+
+void FormatTime(int64_t ns, char* buf, size_t len) {
+    time_t sec = static_cast<time_t>(ns / 1000000000);
+    struct tm t;
+    localtime_r(&sec, &t);
+    size_t n = strftime(buf, len, "%Y-%m-%d %H:%M:%S", &t);
+    snprintf(buf + n, len - n, ".%06d", static_cast<int>(ns % 1000000000 / 1000));
+}
+
+// CSV 字段：含逗号、引号或换行时加引号
+std::string CsvField(const std::string& s) {
+    if (s.find_first_of(",\"\r\n") == std::string::npos) {
+        return s;
+    }
+    std::string out = "\"";
+    for (char c : s) {
+        out += c;
+        if (c == '"') { out += '"'; }
+    }
+    return out + "\"";
+}
+
+bool DecodeFile(const char* name, const Options& opt, size_t* count) {
+    int fd = open(name, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        fprintf(stderr, "%s: %s\n", name, strerror(errno));
+        if (fd >= 0) { close(fd); }
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size < sizeof(AccessLogHeader)) {
+        fprintf(stderr, "%s: too short\n", name);
+        close(fd);
+        return false;
+    }
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        fprintf(stderr, "%s: mmap: %s\n", name, strerror(errno));
+        return false;
+    }
+    const char* base = static_cast<const char*>(addr);
+    AccessLogHeader header;
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, ACCESS_LOG_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != ACCESS_LOG_VERSION || header.recordSize != ACCESS_RECORD_SIZE) {
+        fprintf(stderr, "%s: not an access log (or unsupported version %u)\n", name, header.version);
+        munmap(addr, size);
+        return false;
+    }
+    size_t end = size / ACCESS_RECORD_SIZE * ACCESS_RECORD_SIZE;
+
+    std::unordered_map<uint32_t, std::string> paths;
+    for (size_t off = ACCESS_RECORD_SIZE; off < end; off += ACCESS_RECORD_SIZE) {
+        if (static_cast<uint8_t>(base[off]) == ACCESS_RECORD_PATH) {
+            AccessPathRecord rec;
+            memcpy(&rec, base + off, sizeof(rec));
+            paths[rec.pathId].assign(rec.path, std::min<size_t>(rec.len, AccessPathRecord::PATH_MAX_LEN));
+        }
+    }
+
+    char timeBuf[64];
+    char ip[INET_ADDRSTRLEN];
+    for (size_t off = ACCESS_RECORD_SIZE; off < end; off += ACCESS_RECORD_SIZE) {
+        if (static_cast<uint8_t>(base[off]) != ACCESS_RECORD_REQUEST) {
+            continue;
+        }
+        AccessRecord rec;
+        memcpy(&rec, base + off, sizeof(rec));
+        if (rec.status < opt.minStatus) {
+            continue;
+        }
+        FormatTime(rec.timeNs, timeBuf, sizeof(timeBuf));
+        struct in_addr in;
+        in.s_addr = rec.peerAddr;
+        inet_ntop(AF_INET, &in, ip, sizeof(ip));
+        auto it = paths.find(rec.pathId);
+        char unknown[16];
+        snprintf(unknown, sizeof(unknown), "#%08x", rec.pathId);
+        std::string path = it == paths.end() ? unknown : it->second;
+        bool keepAlive = rec.flags & ACCESS_FLAG_KEEP_ALIVE;
+        if (opt.csv) {
+            printf("%s,%s,%u,%d,%s,%s,%u,%llu,%llu,%u,%d\n", timeBuf, ip, rec.peerPort, rec.fd,
+                   AccessLog::MethodName(rec.method), CsvField(path).c_str(), rec.status,
+                   (unsigned long long)rec.bytes, (unsigned long long)rec.bodyBytes, rec.latencyUs, keepAlive ? 1 : 0);
+        } else {
+            printf("%s %s:%u fd=%d %s %s %u %lluB body=%lluB %uus%s\n", timeBuf, ip, rec.peerPort, rec.fd,
+                   AccessLog::MethodName(rec.method), path.c_str(), rec.status,
+                   (unsigned long long)rec.bytes, (unsigned long long)rec.bodyBytes, rec.latencyUs,
+                   keepAlive ? " keep-alive" : "");
+        }
+        (*count)++;
+    }
+    munmap(addr, size);
+    return true;
+}
+
+void Usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [-c] [-s minStatus] file...\n"
+            "  -c            CSV output with header\n"
+            "  -s minStatus  only requests with status >= minStatus\n", prog);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    int ch;
+    while ((ch = getopt(argc, argv, "cs:h")) != -1) {
+        switch (ch) {
+            case 'c': opt.csv = true; break;
+            case 's': opt.minStatus = atoi(optarg); break;
+            default: Usage(argv[0]); return ch == 'h' ? 0 : 1;
+        }
+    }
+    if (optind >= argc) {
+        Usage(argv[0]);
+        return 1;
+    }
+    if (opt.csv) {
+        printf("time,peer,port,fd,method,path,status,bytes,body_bytes,latency_us,keep_alive\n");
+    }
+    size_t count = 0;
+    int failed = 0;
+    for (int i = optind; i < argc; i++) {
+        if (!DecodeFile(argv[i], opt, &count)) {
+            failed++;
+        }
+    }
+    fprintf(stderr, "%zu requests from %d file(s)\n", count, argc - optind - failed);
+    return failed ? 1 : 0;
+}